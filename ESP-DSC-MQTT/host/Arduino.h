@@ -0,0 +1,147 @@
+/*
+  Arduino.h - Host (Linux) build of the parts of the Arduino/ESP8266 core
+  used by the libraries in lib/, so they build and run unchanged off the
+  device: in the tests under test/ and the tools under tools/
+
+  Time is simulated, per thread: micros()/millis() return what the thread
+  last set with hostSetMicros(), so a test (or a gateway thread per bus)
+  replays the keybus with the exact timing it wants. Pins are levels set
+  with hostSetPin(), which calls the ISR attached to the pin on a matching
+  edge, as the hardware would. With ESP8266 defined, timer1 fires its ISR
+  when hostSetMicros() passes its due time.
+
+  Build with -DARDUINO=10800 -DARDUINO_HOST (see host.mk), so every
+  header takes the same path as on the device.
+
+  Released into the public domain.
+
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#ifndef ARDUINO_HOST
+#error "Build host code with -DARDUINO=10800 -DARDUINO_HOST (see host/host.mk)"
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// ----- Flash strings, plain strings on a host -----
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define F(s) (s)
+typedef char __FlashStringHelper;
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define memcpy_P memcpy
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ----- Time -----
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+
+// ----- Pins and interrupts -----
+#define HOST_PINS 64
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts(void);
+void interrupts(void);
+
+#if defined(ESP8266)
+// ----- ESP8266 GPIO registers and timer1 -----
+extern std::atomic<uint8_t> hostPinLevels[HOST_PINS];
+#define GPIP(p) (hostPinLevels[(p) & (HOST_PINS - 1)] != 0)
+#define GP16I (hostPinLevels[16])
+
+#define TIM_DIV1 0
+#define TIM_DIV16 1
+#define TIM_DIV256 3
+#define TIM_EDGE 0
+#define TIM_LEVEL 1
+#define TIM_SINGLE 0
+#define TIM_LOOP 1
+void timer1_isr_init(void);
+void timer1_attachInterrupt(void (*handler)(void));
+void timer1_detachInterrupt(void);
+void timer1_enable(uint8_t divider, uint8_t intType, uint8_t reload);
+void timer1_disable(void);
+void timer1_write(uint32_t ticks);    // TIM_DIV16: 5 ticks per us
+#endif
+
+// ----- Host only -----
+// Sets this thread's micros(), firing timer1 (ESP8266) on the way if it falls due
+void hostSetMicros(unsigned long us);
+void hostAdvance(unsigned long us);
+
+// Sets a pin's level, calling the ISR attached to it on a matching edge
+void hostSetPin(uint8_t pin, int level);
+
+#include "WString.h"
+#include "Print.h"
+
+// Serial writes to stdout, unless quiet
+class HardwareSerial : public Print
+{
+  public:
+    HardwareSerial(void) : quiet(false) {}
+    void begin(unsigned long baud) { (void)baud; }
+    void end(void) {}
+    int available(void) { return 0; }
+    int read(void) { return -1; }
+    virtual int availableForWrite(void) { return 256; }
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    using Print::write;
+    operator bool() { return true; }
+
+    bool quiet;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,109 @@
+/*
+  HostCore.cpp - Host build of the Arduino core: time, pins, interrupts,
+  timer1 and Serial, see Arduino.h
+
+  Released into the public domain.
+
+*/
+
+#include "Arduino.h"
+#include <mutex>
+
+// ----- Time -----
+// Simulated and per thread, so each thread replays its own keybus
+static thread_local unsigned long hostMicros = 0;
+
+#if defined(ESP8266)
+static void (*timer1Handler)(void) = NULL;
+static thread_local bool timer1Armed = false;
+static thread_local unsigned long timer1Due = 0;
+#endif
+
+unsigned long micros(void) { return hostMicros; }
+unsigned long millis(void) { return hostMicros / 1000; }
+
+void hostSetMicros(unsigned long us)
+  {
+#if defined(ESP8266)
+    // timer1 fires on the way to "us", as it would have in real time
+    while (timer1Armed && (long)(us - timer1Due) >= 0) {
+      timer1Armed = false;
+      hostMicros = timer1Due;
+      if (timer1Handler) timer1Handler();
+    }
+#endif
+    hostMicros = us;
+  }
+
+void hostAdvance(unsigned long us) { hostSetMicros(hostMicros + us); }
+void delay(unsigned long ms) { hostAdvance(ms * 1000); }
+void delayMicroseconds(unsigned int us) { hostAdvance(us); }
+void yield(void) {}
+
+// ----- Pins and interrupts -----
+std::atomic<uint8_t> hostPinLevels[HOST_PINS];   // Shared, as the GPIO registers
+
+static void (*pinHandlers[HOST_PINS])(void);
+static int pinModes[HOST_PINS];
+static std::recursive_mutex interruptLock;      // noInterrupts(), for the threads sharing a bus
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+void digitalWrite(uint8_t pin, uint8_t val) { hostSetPin(pin, val); }
+int digitalRead(uint8_t pin) { return hostPinLevels[pin & (HOST_PINS - 1)] ? HIGH : LOW; }
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode)
+  {
+    pin &= HOST_PINS - 1;
+    pinModes[pin] = mode;
+    pinHandlers[pin] = handler;
+  }
+
+void detachInterrupt(uint8_t pin)
+  {
+    pinHandlers[pin & (HOST_PINS - 1)] = NULL;
+  }
+
+void noInterrupts(void) { interruptLock.lock(); }
+void interrupts(void) { interruptLock.unlock(); }
+
+void hostSetPin(uint8_t pin, int level)
+  {
+    pin &= HOST_PINS - 1;
+    uint8_t was = hostPinLevels[pin].exchange(level ? 1 : 0);
+    if (was == (level ? 1 : 0)) return;
+
+    void (*handler)(void) = pinHandlers[pin];
+    if (!handler) return;
+    int mode = pinModes[pin];
+    if (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level)) handler();
+  }
+
+#if defined(ESP8266)
+// ----- timer1 -----
+void timer1_isr_init(void) {}
+void timer1_attachInterrupt(void (*handler)(void)) { timer1Handler = handler; }
+void timer1_detachInterrupt(void) { timer1Handler = NULL; timer1Armed = false; }
+void timer1_enable(uint8_t divider, uint8_t intType, uint8_t reload) { (void)divider; (void)intType; (void)reload; }
+void timer1_disable(void) { timer1Armed = false; }
+
+void timer1_write(uint32_t ticks)
+  {
+    timer1Armed = true;
+    timer1Due = hostMicros + ticks / 5;
+  }
+#endif
+
+// ----- Serial -----
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c)
+  {
+    if (!quiet) fputc(c, stdout);
+    return 1;
+  }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+  {
+    if (!quiet) fwrite(buffer, 1, size, stdout);
+    return size;
+  }
@@ -0,0 +1,61 @@
+/*
+  Print.cpp - Host build of the Arduino Print class
+
+  Released into the public domain.
+
+*/
+
+#include "Arduino.h"
+#include <stdarg.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--) {
+      if (!write(*buffer++)) break;
+      n++;
+    }
+    return n;
+  }
+
+size_t Print::print(long n, int base)
+  {
+    if (base == DEC && n < 0) {
+      size_t t = print('-');
+      return t + print(-(unsigned long)n, base);
+    }
+    return print((unsigned long)n, base);
+  }
+
+size_t Print::print(unsigned long n, int base)
+  {
+    char b[8 * sizeof(long) + 1];
+    char *p = b + sizeof(b) - 1;
+    *p = 0;
+    if (base < 2) base = 10;
+    do {
+      byte d = n % base;
+      *--p = d < 10 ? '0' + d : 'A' + d - 10;
+      n /= base;
+    } while (n);
+    return write(p);
+  }
+
+size_t Print::print(double n, int digits)
+  {
+    char b[64];
+    snprintf(b, sizeof(b), "%.*f", digits, n);
+    return write(b);
+  }
+
+size_t Print::printf(const char *format, ...)
+  {
+    char b[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(b, sizeof(b), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if (len >= (int)sizeof(b)) len = sizeof(b) - 1;
+    return write((const uint8_t *)b, len);
+  }
@@ -0,0 +1,377 @@
+/*
+  WString.cpp - Host build of the Arduino String class
+
+  Released into the public domain.
+
+*/
+
+#include "Arduino.h"
+#include <ctype.h>
+#include <stdlib.h>
+
+void String::init(void)
+  {
+    buf = sso;
+    len = 0;
+    cap = SSO_LEN;
+    sso[0] = 0;
+  }
+
+void String::release(void)
+  {
+    if (buf != sso) free(buf);
+    init();
+  }
+
+unsigned char String::grow(unsigned int size)
+  {
+    // Exactly "size" characters, as the ESP8266 core's changeBuffer()
+    if (size <= cap) return 1;
+    char *b;
+    if (buf == sso) {
+      b = (char *)malloc(size + 1);
+      if (b) memcpy(b, sso, len + 1);
+    }
+    else b = (char *)realloc(buf, size + 1);
+    if (!b) return 0;
+    buf = b;
+    cap = size;
+    return 1;
+  }
+
+unsigned char String::reserve(unsigned int size)
+  {
+    return grow(size);
+  }
+
+String &String::copy(const char *cstr, unsigned int length)
+  {
+    if (!grow(length)) {
+      release();
+      return *this;
+    }
+    memmove(buf, cstr, length);
+    len = length;
+    buf[len] = 0;
+    return *this;
+  }
+
+String::String(const char *cstr)
+  {
+    init();
+    if (cstr) copy(cstr, strlen(cstr));
+  }
+
+String::String(const String &str)
+  {
+    init();
+    copy(str.buf, str.len);
+  }
+
+String::String(String &&str)
+  {
+    init();
+    *this = (String &&)str;
+  }
+
+String::String(char c)
+  {
+    init();
+    copy(&c, 1);
+  }
+
+static void toBase(char *out, unsigned long value, unsigned char base)
+  {
+    char tmp[8 * sizeof(long) + 1];
+    char *p = tmp + sizeof(tmp) - 1;
+    *p = 0;
+    if (base < 2) base = 10;
+    do {
+      byte d = value % base;
+      *--p = d < 10 ? '0' + d : 'a' + d - 10;
+      value /= base;
+    } while (value);
+    strcpy(out, p);
+  }
+
+String::String(unsigned char value, unsigned char base)
+  {
+    init();
+    char b[8 * sizeof(long) + 2];
+    toBase(b, value, base);
+    copy(b, strlen(b));
+  }
+
+String::String(int value, unsigned char base)
+  {
+    init();
+    char b[8 * sizeof(long) + 2];
+    if (base == 10 && value < 0) {
+      b[0] = '-';
+      toBase(b + 1, -(long)value, 10);
+    }
+    else toBase(b, (unsigned int)value, base);
+    copy(b, strlen(b));
+  }
+
+String::String(unsigned int value, unsigned char base)
+  {
+    init();
+    char b[8 * sizeof(long) + 2];
+    toBase(b, value, base);
+    copy(b, strlen(b));
+  }
+
+String::String(long value, unsigned char base)
+  {
+    init();
+    char b[8 * sizeof(long) + 2];
+    if (base == 10 && value < 0) {
+      b[0] = '-';
+      toBase(b + 1, -(unsigned long)value, 10);
+    }
+    else toBase(b, (unsigned long)value, base);
+    copy(b, strlen(b));
+  }
+
+String::String(unsigned long value, unsigned char base)
+  {
+    init();
+    char b[8 * sizeof(long) + 2];
+    toBase(b, value, base);
+    copy(b, strlen(b));
+  }
+
+String::String(float value, unsigned char decimals)
+  {
+    init();
+    char b[64];
+    snprintf(b, sizeof(b), "%.*f", decimals, (double)value);
+    copy(b, strlen(b));
+  }
+
+String::String(double value, unsigned char decimals)
+  {
+    init();
+    char b[64];
+    snprintf(b, sizeof(b), "%.*f", decimals, value);
+    copy(b, strlen(b));
+  }
+
+String::~String(void)
+  {
+    if (buf != sso) free(buf);
+  }
+
+String &String::operator=(const String &rhs)
+  {
+    if (this == &rhs) return *this;
+    return copy(rhs.buf, rhs.len);
+  }
+
+String &String::operator=(String &&rhs)
+  {
+    if (this == &rhs) return *this;
+    if (rhs.buf == rhs.sso || (buf != sso && cap >= rhs.len)) {
+      // Nothing to steal, or the buffer held is already large enough
+      copy(rhs.buf, rhs.len);
+      return *this;
+    }
+    if (buf != sso) free(buf);
+    buf = rhs.buf;
+    len = rhs.len;
+    cap = rhs.cap;
+    rhs.init();
+    return *this;
+  }
+
+String &String::operator=(const char *cstr)
+  {
+    if (!cstr) {
+      release();
+      return *this;
+    }
+    return copy(cstr, strlen(cstr));
+  }
+
+String &String::operator=(char c)
+  {
+    return copy(&c, 1);
+  }
+
+unsigned char String::concat(const char *cstr, unsigned int length)
+  {
+    if (!cstr) return 0;
+    if (!length) return 1;
+    if (cstr >= buf && cstr < buf + len) {
+      // Appending part of itself, which grow() may move
+      unsigned int offset = cstr - buf;
+      if (!grow(len + length)) return 0;
+      cstr = buf + offset;
+    }
+    else if (!grow(len + length)) return 0;
+    memmove(buf + len, cstr, length);
+    len += length;
+    buf[len] = 0;
+    return 1;
+  }
+
+unsigned char String::concat(const String &str) { return concat(str.buf, str.len); }
+unsigned char String::concat(const char *cstr) { return cstr ? concat(cstr, strlen(cstr)) : 0; }
+unsigned char String::concat(char c) { return concat(&c, 1); }
+
+unsigned char String::concat(unsigned char num)
+  {
+    char b[4];
+    toBase(b, num, 10);
+    return concat(b, strlen(b));
+  }
+
+unsigned char String::concat(int num) { return concat((long)num); }
+unsigned char String::concat(unsigned int num) { return concat((unsigned long)num); }
+
+unsigned char String::concat(long num)
+  {
+    char b[8 * sizeof(long) + 2];
+    if (num < 0) {
+      b[0] = '-';
+      toBase(b + 1, -(unsigned long)num, 10);
+    }
+    else toBase(b, num, 10);
+    return concat(b, strlen(b));
+  }
+
+unsigned char String::concat(unsigned long num)
+  {
+    char b[8 * sizeof(long) + 2];
+    toBase(b, num, 10);
+    return concat(b, strlen(b));
+  }
+
+unsigned char String::concat(float num) { return concat((double)num); }
+
+unsigned char String::concat(double num)
+  {
+    char b[64];
+    snprintf(b, sizeof(b), "%.2f", num);
+    return concat(b, strlen(b));
+  }
+
+int String::compareTo(const String &s) const
+  {
+    return strcmp(buf, s.buf);
+  }
+
+unsigned char String::equals(const char *cstr) const
+  {
+    return strcmp(buf, cstr ? cstr : "") == 0;
+  }
+
+unsigned char String::startsWith(const String &prefix) const
+  {
+    return prefix.len <= len && strncmp(buf, prefix.buf, prefix.len) == 0;
+  }
+
+unsigned char String::endsWith(const String &suffix) const
+  {
+    return suffix.len <= len && strcmp(buf + len - suffix.len, suffix.buf) == 0;
+  }
+
+char &String::operator[](unsigned int index)
+  {
+    static char dummy;
+    if (index >= len) {
+      dummy = 0;
+      return dummy;
+    }
+    return buf[index];
+  }
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+  {
+    if (fromIndex >= len) return -1;
+    const char *p = strchr(buf + fromIndex, ch);
+    return p ? p - buf : -1;
+  }
+
+int String::indexOf(const char *str, unsigned int fromIndex) const
+  {
+    if (fromIndex >= len) return -1;
+    const char *p = strstr(buf + fromIndex, str);
+    return p ? p - buf : -1;
+  }
+
+int String::lastIndexOf(char ch) const
+  {
+    const char *p = strrchr(buf, ch);
+    return p ? p - buf : -1;
+  }
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+  {
+    if (beginIndex > endIndex) {
+      unsigned int t = beginIndex;
+      beginIndex = endIndex;
+      endIndex = t;
+    }
+    String out;
+    if (beginIndex >= len) return out;
+    if (endIndex > len) endIndex = len;
+    out.copy(buf + beginIndex, endIndex - beginIndex);
+    return out;
+  }
+
+void String::remove(unsigned int index, unsigned int count)
+  {
+    if (index >= len) return;
+    if (count > len - index) count = len - index;
+    memmove(buf + index, buf + index + count, len - index - count + 1);
+    len -= count;
+  }
+
+void String::toUpperCase(void)
+  {
+    for (unsigned int i=0;i<len;i++) buf[i] = toupper((unsigned char)buf[i]);
+  }
+
+void String::toLowerCase(void)
+  {
+    for (unsigned int i=0;i<len;i++) buf[i] = tolower((unsigned char)buf[i]);
+  }
+
+void String::trim(void)
+  {
+    unsigned int b = 0, e = len;
+    while (b < e && isspace((unsigned char)buf[b])) b++;
+    while (e > b && isspace((unsigned char)buf[e - 1])) e--;
+    memmove(buf, buf + b, e - b);
+    len = e - b;
+    buf[len] = 0;
+  }
+
+long String::toInt(void) const
+  {
+    return atol(buf);
+  }
+
+float String::toFloat(void) const
+  {
+    return atof(buf);
+  }
+
+// ----- Sums, which like the core's StringSumHelper build on the left String -----
+
+String operator+(const String &lhs, const String &rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, const char *rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const char *lhs, const String &rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, char rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, unsigned char rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, unsigned int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, unsigned long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, float rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, double rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(String &&lhs, const String &rhs) { lhs.concat(rhs); return (String &&)lhs; }
+String operator+(String &&lhs, const char *rhs) { lhs.concat(rhs); return (String &&)lhs; }
+String operator+(String &&lhs, char rhs) { lhs.concat(rhs); return (String &&)lhs; }
@@ -0,0 +1,123 @@
+/*
+  WString.h - Host build of the Arduino String class
+
+  Behaves like the ESP8266 core's String where it matters to the code in
+  lib/: short strings (up to SSO_LEN characters) are held inside the
+  object, longer ones on the heap through malloc()/realloc()/free(), and
+  the buffer grows to exactly the length needed (so an append to a String
+  that has not been reserve()d allocates, as on the device). Assigning to
+  a String that has the capacity reuses its buffer.
+
+  Released into the public domain.
+
+*/
+
+#ifndef WString_h
+#define WString_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+class String
+{
+  public:
+    static const unsigned int SSO_LEN = 10;   // Characters held without the heap (11 bytes)
+
+    String(const char *cstr = "");
+    String(const String &str);
+    String(String &&str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimals = 2);
+    explicit String(double value, unsigned char decimals = 2);
+    ~String(void);
+
+    // Allocates room for "size" characters, returns 0 if it fails
+    unsigned char reserve(unsigned int size);
+    unsigned int length(void) const { return len; }
+    const char *c_str(void) const { return buf; }
+
+    String &operator=(const String &rhs);
+    String &operator=(String &&rhs);
+    String &operator=(const char *cstr);
+    String &operator=(char c);
+
+    // Appends, returns 0 if it fails (the String is then unchanged)
+    unsigned char concat(const String &str);
+    unsigned char concat(const char *cstr);
+    unsigned char concat(const char *cstr, unsigned int length);
+    unsigned char concat(char c);
+    unsigned char concat(unsigned char num);
+    unsigned char concat(int num);
+    unsigned char concat(unsigned int num);
+    unsigned char concat(long num);
+    unsigned char concat(unsigned long num);
+    unsigned char concat(float num);
+    unsigned char concat(double num);
+
+    template <typename T> String &operator+=(const T &rhs) { concat(rhs); return *this; }
+    String &operator+=(const char *cstr) { concat(cstr); return *this; }
+
+    int compareTo(const String &s) const;
+    unsigned char equals(const String &s) const { return compareTo(s) == 0; }
+    unsigned char equals(const char *cstr) const;
+    unsigned char operator==(const String &rhs) const { return equals(rhs); }
+    unsigned char operator==(const char *cstr) const { return equals(cstr); }
+    unsigned char operator!=(const String &rhs) const { return !equals(rhs); }
+    unsigned char operator!=(const char *cstr) const { return !equals(cstr); }
+    unsigned char operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+    unsigned char startsWith(const String &prefix) const;
+    unsigned char endsWith(const String &suffix) const;
+
+    char charAt(unsigned int index) const { return index < len ? buf[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if (index < len) buf[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index);
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const char *str, unsigned int fromIndex = 0) const;
+    int indexOf(const String &str, unsigned int fromIndex = 0) const { return indexOf(str.buf, fromIndex); }
+    int lastIndexOf(char ch) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, len); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+    void toUpperCase(void);
+    void toLowerCase(void);
+    void trim(void);
+
+    long toInt(void) const;
+    float toFloat(void) const;
+
+  private:
+    char *buf;                      // sso, or the heap buffer
+    unsigned int len;               // Characters held
+    unsigned int cap;               // Characters that fit in buf
+    char sso[SSO_LEN + 1];
+
+    void init(void);
+    void release(void);
+    unsigned char grow(unsigned int size);
+    String &copy(const char *cstr, unsigned int length);
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+String operator+(const String &lhs, unsigned char rhs);
+String operator+(const String &lhs, int rhs);
+String operator+(const String &lhs, unsigned int rhs);
+String operator+(const String &lhs, long rhs);
+String operator+(const String &lhs, unsigned long rhs);
+String operator+(const String &lhs, float rhs);
+String operator+(const String &lhs, double rhs);
+String operator+(String &&lhs, const String &rhs);
+String operator+(String &&lhs, const char *rhs);
+String operator+(String &&lhs, char rhs);
+
+#endif
@@ -0,0 +1,37 @@
+# host.mk - builds the libraries in lib/ on a PC, against the host build of
+# the Arduino core in this directory (see Arduino.h)
+#
+# Include it from a Makefile after setting:
+#   ROOT        the ESP-DSC-MQTT directory
+#   HOST_BUILD  the directory for the objects
+#   HOST_DEFS   extra defines, e.g. -DESP8266 to build the ESP8266 code paths
+#
+# It provides HOST_CXXFLAGS (use them for your own sources too) and
+# $(HOST_LIB), an archive of the core and every library, to link against.
+
+HOST_DIR := $(ROOT)/host
+LIB_DIR := $(ROOT)/lib
+
+CXX ?= g++
+# -fpermissive as the Arduino builds, some of lib/ relies on it
+HOST_LIBS := $(patsubst %/,%,$(sort $(dir $(wildcard $(LIB_DIR)/*/*.cpp))))
+HOST_CXXFLAGS := -std=gnu++17 -g -O2 -Wall -Wno-unused-variable -Wno-unused-but-set-variable -Wno-sign-compare -Wno-strict-aliasing -fpermissive \
+	-DARDUINO=10800 -DARDUINO_HOST $(HOST_DEFS) \
+	-I$(HOST_DIR) $(addprefix -I,$(HOST_LIBS)) -pthread
+
+HOST_SRC := $(wildcard $(HOST_DIR)/*.cpp) $(foreach d,$(HOST_LIBS),$(wildcard $(d)/*.cpp))
+HOST_OBJ := $(addprefix $(HOST_BUILD)/,$(notdir $(HOST_SRC:.cpp=.o)))
+HOST_LIB := $(HOST_BUILD)/libhost.a
+
+vpath %.cpp $(HOST_DIR) $(HOST_LIBS)
+
+$(HOST_BUILD)/%.o: %.cpp | $(HOST_BUILD)
+	$(CXX) $(HOST_CXXFLAGS) -MMD -MP -c $< -o $@
+
+$(HOST_LIB): $(HOST_OBJ)
+	$(AR) rcs $@ $^
+
+$(HOST_BUILD):
+	mkdir -p $@
+
+-include $(HOST_OBJ:.o=.d)
@@ -0,0 +1,138 @@
+#include "BitCorrelator.h"
+#include <string.h>
+#include <math.h>
+
+BitCorrelator::BitCorrelator()
+  {
+    clear();
+  }
+
+void BitCorrelator::clear()
+  {
+    memset(slots, 0, sizeof(slots));
+    used = 0;
+    other = 0;
+  }
+
+BitCorrelator::slot_t* BitCorrelator::find(uint8_t cmd, bool claim)
+  {
+    for (uint8_t i=0;i<used;i++) {
+      if (slots[i].cmd == cmd) return &slots[i];
+    }
+    if (!claim || used >= CORR_SLOTS) return NULL;
+    slot_t *s = &slots[used++];
+    s->cmd = cmd;
+    return s;
+  }
+
+void BitCorrelator::count(counter_t &c, const uint64_t *lanes)
+  {
+    // Adds 1 to the counter of every set bit: a ripple-carry add done on all
+    // 64 positions of a lane at once, plane by plane
+    for (uint8_t l=0;l<CORR_LANES;l++) {
+      uint64_t carry = lanes[l];
+      for (uint8_t p=0;p<CORR_PLANES && carry;p++) {
+        uint64_t next = c.planes[p][l] & carry;
+        c.planes[p][l] ^= carry;
+        carry = next;
+      }
+    }
+    c.words++;
+    if (++c.pending == 255) flush(c);   // the planes hold counts up to 255
+  }
+
+void BitCorrelator::flush(counter_t &c)
+  {
+    // Moves the counts held in the planes into the 32-bit totals
+    if (!c.pending) return;
+    for (uint8_t l=0;l<CORR_LANES;l++) {
+      for (uint8_t p=0;p<CORR_PLANES;p++) {
+        uint64_t plane = c.planes[p][l];
+        while (plane) {
+          uint8_t bit = __builtin_ctzll(plane);
+          c.totals[l * 64 + (63 - bit)] += (uint32_t)1 << p;
+          plane &= plane - 1;
+        }
+        c.planes[p][l] = 0;
+      }
+    }
+    c.pending = 0;
+  }
+
+int BitCorrelator::add(const uint8_t *data, uint8_t bits, uint32_t labels)
+  {
+    if (!bits) return 0;
+    slot_t *s = find(data[0], true);
+    if (!s) {
+      other++;
+      return 0;                               // return failure, table full
+    }
+
+    // Packs the word into lanes, bit 0 of the word is the MSB of lane 0
+    uint64_t lanes[CORR_LANES];
+    memset(lanes, 0, sizeof(lanes));
+    uint8_t bytes = (bits > CORR_BITS ? CORR_BITS : bits + 7) / 8;
+    for (uint8_t i=0;i<bytes;i++) {
+      lanes[i / 8] |= (uint64_t)data[i] << (56 - (i % 8) * 8);
+    }
+    if (bits < CORR_BITS) {
+      // Clear what follows the last bit
+      uint8_t l = bits / 64;
+      if (bits % 64) lanes[l++] &= ~(uint64_t)0 << (64 - bits % 64);
+      for (;l<CORR_LANES;l++) lanes[l] = 0;
+    }
+
+    count(s->all, lanes);
+    for (uint8_t n=0;n<CORR_LABELS;n++) {
+      if (labels & ((uint32_t)1 << n)) count(s->labelled[n], lanes);
+    }
+    return 1;                                 // return success
+  }
+
+uint32_t BitCorrelator::frames(uint8_t cmd)
+  {
+    slot_t *s = find(cmd, false);
+    return s ? s->all.words : 0;
+  }
+
+uint32_t BitCorrelator::frames(uint8_t cmd, uint8_t label)
+  {
+    slot_t *s = find(cmd, false);
+    if (!s || label >= CORR_LABELS) return 0;
+    return s->labelled[label].words;
+  }
+
+size_t BitCorrelator::candidates(uint8_t cmd, uint8_t label, corrCandidate_t *out, size_t max)
+  {
+    slot_t *s = find(cmd, false);
+    if (!s || label >= CORR_LABELS || !max) return 0;
+    flush(s->all);
+    flush(s->labelled[label]);
+
+    // phi = (n*b - a*L) / sqrt(a*(n-a)*L*(n-L)), with n words, a of them with
+    // the bit set, L of them labelled and b both
+    double n = s->all.words;
+    double L = s->labelled[label].words;
+    size_t found = 0;
+    for (uint8_t bit=0;bit<CORR_BITS;bit++) {
+      double a = s->all.totals[bit];
+      double b = s->labelled[label].totals[bit];
+      double den = a * (n - a) * L * (n - L);
+      if (den <= 0) continue;
+
+      corrCandidate_t c;
+      c.bit = bit;
+      c.phi = (float)((n * b - a * L) / sqrt(den));
+      c.ones = s->all.totals[bit];
+      c.onesLabelled = s->labelled[label].totals[bit];
+
+      // Insertion into the list kept sorted by |phi|, largest first
+      size_t i = found < max ? found++ : max;
+      while (i > 0 && fabs(out[i - 1].phi) < fabs(c.phi)) {
+        if (i < max) out[i] = out[i - 1];
+        i--;
+      }
+      if (i < max) out[i] = c;
+    }
+    return found;
+  }
@@ -0,0 +1,114 @@
+/*
+  BitCorrelator.h - Library for finding which bits of the keybus words
+  follow labelled external events
+
+  Every word fed in is counted per command byte: how often each bit
+  position is set, overall and while each label (an external event such
+  as "mains off" or "zone 3 open", numbered 0 to CORR_LABELS-1) was
+  active. From those counts candidates() ranks the bit positions of a
+  command byte by their phi coefficient with a label: +1 the bit is set
+  exactly when the label is active, -1 exactly when it is not, 0 no
+  relation.
+
+  The counting is bit-parallel: a word is held as 64-bit lanes and added
+  to bit-sliced (vertical) counters, one plane per counter bit, so all
+  64 positions of a lane are counted in a handful of instructions. The
+  planes are flushed into the 32-bit totals every 255 words.
+
+  Released into the public domain.
+
+*/
+
+#ifndef BitCorrelator_h
+#define BitCorrelator_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#elif defined(ARDUINO)
+#include "WProgram.h"
+#else
+#include <stdint.h>
+#include <stddef.h>
+#endif
+
+// ----- Correlator Constants -----
+#ifndef CORR_SLOTS
+#define CORR_SLOTS 16                 // Command bytes tracked
+#endif
+#ifndef CORR_LABELS
+#define CORR_LABELS 8                 // External event labels (max 32)
+#endif
+#define CORR_BITS 128                 // Bit positions counted per word
+#define CORR_LANES (CORR_BITS / 64)   // 64-bit lanes per word
+#define CORR_PLANES 8                 // Bits per vertical counter, flushed at 255
+
+// A candidate bit for a label
+typedef struct
+{
+  uint8_t bit;                        // Bit position in the word (0 = MSB of the command byte)
+  float phi;                          // Correlation with the label, -1 to +1
+  uint32_t ones;                      // Words with the bit set
+  uint32_t onesLabelled;              // ... of which while the label was active
+}
+corrCandidate_t;
+
+class BitCorrelator
+{
+  public:
+
+    // In general, functions will return the following:
+    //    If failure, return int 0
+    //    If success, return int 1, or the count of what was returned
+
+    BitCorrelator();
+
+    // Counts one word of "bits" bits, packed MSB first (as journalEvent_t::data),
+    // whose first byte is the command byte. "labels" has bit n set if label n
+    // was active when the word was sent. Returns 0 if all slots are taken by
+    // other command bytes
+    int add(const uint8_t *data, uint8_t bits, uint32_t labels);
+
+    // Zeros all of the counters and frees all of the slots
+    void clear();
+
+    // Returns the number of words counted for command byte "cmd", and of those
+    // while "label" was active
+    uint32_t frames(uint8_t cmd);
+    uint32_t frames(uint8_t cmd, uint8_t label);
+
+    // Copies up to "max" bit positions of command byte "cmd" into "out", the
+    // most correlated with "label" (largest |phi|) first. Bits that never or
+    // always change, and labels that never or always apply, have no phi and
+    // are left out. Returns the number copied
+    size_t candidates(uint8_t cmd, uint8_t label, corrCandidate_t *out, size_t max);
+
+    unsigned long other;              // Words of command bytes without a slot
+
+  private:
+    // Bit-sliced counter of CORR_BITS positions, with the 32-bit totals
+    typedef struct
+    {
+      uint64_t planes[CORR_PLANES][CORR_LANES];
+      uint8_t pending;                // Words in the planes, not yet in totals
+      uint32_t words;                 // Words counted in total
+      uint32_t totals[CORR_BITS];
+    }
+    counter_t;
+
+    typedef struct
+    {
+      uint8_t cmd;
+      counter_t all;                  // Every word of this command byte
+      counter_t labelled[CORR_LABELS];// Words while each label was active
+    }
+    slot_t;
+
+    slot_t* find(uint8_t cmd, bool claim);
+    static void count(counter_t &c, const uint64_t *lanes);
+    static void flush(counter_t &c);
+
+    slot_t slots[CORR_SLOTS];
+    uint8_t used;
+};
+
+#endif
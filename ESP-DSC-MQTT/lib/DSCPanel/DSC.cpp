@@ -6,44 +6,76 @@
 
 /// ----- GLOBAL VARIABLES -----
 /*
- * The existence of global variables are "declared" in DSC_Global.h, so that each 
- * source file that includes the header knows about them. The variables must then be
- * “defined” once in one of the source files (this one).
-
- * The following structure contains all of the global variables used by the ISR to 
- * communicate with the DSC.clkCalled() object. You cannot pass parameters to an 
- * ISR so these values must be global. The fields are defined in DSC_Globals.h
+ * Each DSC object holds its own keybus state (DSC::state, see DSC_Globals.h). You 
+ * cannot pass parameters to an ISR, so every attached instance is given a slot in 
+ * the table below, and a small static trampoline per slot routes the interrupt to
+ * the DSC.clkCalled() of the instance occupying it.
  */
-dscGlobal_t dscGlobal;
+static DSC* dscInstances[MAX_BUSES];
 
-// ----- Input/Output Pins (Global) -----
-byte CLK;         // Keybus Yellow (Clock Line)
-byte DTA_IN;      // Keybus Green (Data Line via V divider)
-byte DTA_OUT;     // Keybus Green Output (Data Line through driver)
-byte LED;         // LED pin on the arduino
+static void DSC_IRAM clkCalled_Handler0() { dscInstances[0]->clkCalled(); }
+static void DSC_IRAM clkCalled_Handler1() { dscInstances[1]->clkCalled(); }
+static void DSC_IRAM clkCalled_Handler2() { dscInstances[2]->clkCalled(); }
+static void DSC_IRAM clkCalled_Handler3() { dscInstances[3]->clkCalled(); }
 
-void clkCalled_Handler(); // Prototype for interrupt handler, called on clock line change
+static void (* const clkCalled_Handlers[MAX_BUSES])() = {
+  clkCalled_Handler0, clkCalled_Handler1, clkCalled_Handler2, clkCalled_Handler3
+};
 
-TextBuffer tempByte(12);        // Initialize TextBuffer.h for temp byte buffer 
-TextBuffer pInfo(WORD_BITS);    // Initialize TextBuffer.h for panel info
-TextBuffer kInfo(WORD_BITS);    // Initialize TextBuffer.h for keypad info
+#if defined(ESP8266)
+static void sampleTimer_Handler();  // Prototype for the data line sampling timer handler
+#endif
 
 /// --- END GLOBAL VARIABLES ---
 
 DSC::DSC(void)
+  : tempByte(MAX_BITS + 2),   // Temp byte buffer (a whole word plus terminator)
+    pInfo(INFO_LEN),          // Panel info buffer
+    kInfo(INFO_LEN)           // Keypad info buffer
   {
+    slot = -1;                // Not attached to the ISR table until begin()
+    isrHandler = NULL;        // Use the slot's trampoline
+    dataReader = NULL;        // and DSCGpio for the sampling timer's reads
+    kKnown = false;
+
     // ----- Time Variables -----
     // Volatile variables, modified within ISR, based on micros()
-    dscGlobal.intervalTimer = 0;   
-    dscGlobal.clockChange = 0;
-    dscGlobal.lastChange = 0;      
-    dscGlobal.lastRise = 0;         // NOT USED YET
-    dscGlobal.lastFall = 0;         // NOT USED YET
-    dscGlobal.newWord = false;      // NOT USED YET
+    state.intervalTimer = 0;   
+    state.clockChange = 0;
+    state.lastChange = 0;      
+    state.lastRise = 0;         // NOT USED YET
+    state.lastFall = 0;         // NOT USED YET
+    state.newWord = false;      // NOT USED YET
+    state.frameEnd = 0;
+    state.pickup = 0;
+    state.pExpect = 0;
+    state.pSkip = true;         // Wait for the first new word gap
+    state.pFrame = NULL;
+    state.kLen = 0;
+    state.overruns = 0;
+    state.edges = 0;
+    state.bitsSeen = 0;
+    state.onesSeen = 0;
+    state.framingErrors = 0;
+    state.frameCount = 0;
+    state.frameSeq = 0;
+    state.decoded = 0;
+    memset(&state.snap, 0, sizeof(state.snap));
+    state.sampleLeft = 0;
+
+    // ----- Data Line Sampling (DEFAULTS) ------
+    //   Read 3 times, 20 us apart, 120 us after a rising edge (panel data) and
+    //   200 us after a falling edge (keypad data), majority-voted. Can be 
+    //   changed prior to DSC.begin() using setSampling()
+#if defined(ESP8266)
+    setSampling(120, 200, 3, 20);
+#else
+    setSampling(0, 0, 1, 0);    // No sampling timer, read on the clock edge
+#endif
     
     // Time variables, based on millis()
-    dscGlobal.lastStatus = 0;
-    dscGlobal.lastData = 0;
+    state.lastStatus = 0;
+    state.lastData = 0;
 
     // Class level variables to hold time elements
     int yy = 0, mm = 0, dd = 0, HH = 0, MM = 0, SS = 0;
@@ -58,23 +90,40 @@ DSC::DSC(void)
     LED      = 13;   // LED pin on the arduino
 
     // ----- Keybus Word String Vars -----
-    dscGlobal.pBuild="", dscGlobal.pWord="";
-    dscGlobal.oldPWord="", dscGlobal.pMsg="";
-    dscGlobal.kBuild="", dscGlobal.kWord="";
-    dscGlobal.oldKWord="", dscGlobal.kMsg="";
-    dscGlobal.pCmd = 0, dscGlobal.kCmd = 0;
+    state.pWord="";
+    state.oldPWord="", state.pMsg="";
+    state.kWord="";
+    state.oldKWord="", state.kMsg="";
+    state.pCmd = 0, state.kCmd = 0;
+
+    // ----- Decoded Panel State -----
+    for (int i=0;i<ZONE_GROUPS;i++) state.zones[i] = 0;
+    state.armed = 0xff;           // Unknown until the first 0x05 word
+    state.armUser = 0;
 
     // ----- Byte Array Variables -----
-    //dscGlobal.pBytes[ARR_SIZE] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0};    // NOT USED
-    //dscGlobal.kBytes[ARR_SIZE] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0};    // NOT USED
+    //state.pBytes[ARR_SIZE] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0};    // NOT USED
+    //state.kBytes[ARR_SIZE] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0};    // NOT USED
   }
 
 int DSC::addSerial(void)
   {
   }
 
-void DSC::begin(void)
+int DSC::begin(void)
   {
+    // Claim a free slot in the ISR trampoline table
+    if (slot < 0) {
+      for (int i=0;i<MAX_BUSES;i++) {
+        if (!dscInstances[i]) {
+          slot = i;
+          break;
+        }
+      }
+      if (slot < 0) return 0;   // Return failure, all slots are in use
+    }
+    dscInstances[slot] = this;
+
     pinMode(CLK, INPUT);
     pinMode(DTA_IN, INPUT);
     pinMode(DTA_OUT, OUTPUT);
@@ -87,59 +136,225 @@ void DSC::begin(void)
     // Set the interrupt pin
     intrNum = digitalPinToInterrupt(CLK);
 
+#if defined(ESP8266)
+    // Set up the data line sampling timer (shared by all instances)
+    if (sampleCount > 1) {
+      timer1_isr_init();
+      timer1_attachInterrupt(sampleTimer_Handler);
+      timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+    }
+#endif
+
     // Attach interrupt on the CLK pin
-    attachInterrupt(intrNum, clkCalled_Handler, CHANGE);  
+    attachInterrupt(intrNum, isrHandler ? isrHandler : clkCalled_Handlers[slot], CHANGE);  
     //   Changed from RISING to CHANGE to read both panel and keypad data
+    return 1;                 // Return success
+  }
+
+void DSC::end(void)
+  {
+    if (slot < 0) return;     // Not attached
+    detachInterrupt(intrNum);
+    dscInstances[slot] = NULL;
+    slot = -1;
   }
 
 /* This is the interrupt handler used by this class. It is called every time the input
  * pin changes from high to low or from low to high.
  *
- * The function is not a member of the DSC class, it must be in the global scope in order 
- * to be called by attachInterrupt() from within the DSC class.
+ * attachInterrupt() cannot call a member function, so the static trampoline of the
+ * slot this instance occupies (see the top of this file) calls it on its behalf.
  */
-void clkCalled_Handler()
+void DSC_IRAM DSC::clkCalled(void)
   {
-    dscGlobal.clockChange = micros();                   // Save the current clock change time
-    dscGlobal.intervalTimer = 
-        (dscGlobal.clockChange - dscGlobal.lastChange); // Determine interval since last clock change
+    // If clock line is going HIGH, this is PANEL data, otherwise it's going LOW, 
+    // this is KEYPAD data
+    bool panel = DSCGpio::read(CLK);
+    clockEdge(panel, micros());
+    if (deferSample(panel)) return;
+    addBit(panel, DSCGpio::read(DTA_IN));
+  }
+
+bool DSC_IRAM DSC::deferSample(bool panel)
+  {
+#if defined(ESP8266)
+    if (sampleCount > 1) {
+      // Let the data line settle, the bit is read and majority-voted by the timer
+      state.samplePanel = panel;
+      state.sampleOnes = 0;
+      state.sampleLeft = sampleCount;
+      state.sampleDue = state.clockChange + (panel ? sampleDelay[0] : sampleDelay[1]);
+      scheduleSamples();
+      return true;
+    }
+#endif
+    return false;
+  }
+
+void DSC_IRAM DSC::clockEdge(bool panel, unsigned long now)
+  {
+    state.clockChange = now;                      // Save the current clock change time
+    state.edges++;
+    state.intervalTimer = 
+        (state.clockChange - state.lastChange);   // Determine interval since last clock change
+
+    // A sample still pending from the previous edge is resolved with what it has
+    if (state.sampleLeft) takeSample(true);
 
     // If the interval is longer than the required amount (NEW_WORD_INTV - 200 us)
-    if (dscGlobal.intervalTimer > (NEW_WORD_INTV - 200)) {
-      dscGlobal.kWord = dscGlobal.kBuild;               // Save the complete keypad raw data bytes sentence
-      dscGlobal.kBuild = "";                            // Reset the raw data bytes keypad word being built
+    if (state.intervalTimer > (NEW_WORD_INTV - 200)) {
+      commitFrame();                              // Close a panel word of unknown length
+      state.kLen = 0;                             // then start the next keypad word
+      state.pSkip = false;                        // Resync, build the next panel word
     }
-    dscGlobal.lastChange = dscGlobal.clockChange;       // Re-save the current change time as last change time
-
-    // If clock line is going HIGH, this is PANEL data
-    if (digitalRead(CLK)) {                
-      dscGlobal.lastRise = dscGlobal.lastChange;        // Set the lastRise time
-      if (dscGlobal.pBuild.length() <= MAX_BITS) {      // Limit the string size to something manageable
-        //delayMicroseconds(120);           // Delay for 120 us to get a valid data line read
-        if (digitalRead(DTA_IN)) dscGlobal.pBuild += "1"; 
-        else dscGlobal.pBuild += "0";
+    state.lastChange = state.clockChange;         // Re-save the current change time as last change time
+
+    if (panel) state.lastRise = state.lastChange; // Set the lastRise time
+    else state.lastFall = state.lastChange;       // Set the lastFall time
+  }
+
+void DSC_IRAM DSC::takeSample(bool resolve)
+  {
+    // Reads the data line once for the pending bit, and adds the bit once all
+    // of its samples are in (or now, if "resolve" is set)
+    if (dataReader ? dataReader() : DSCGpio::read(DTA_IN)) state.sampleOnes++;
+    byte taken = sampleCount - (--state.sampleLeft);
+    state.sampleDue += sampleSpacing;
+    if (resolve || !state.sampleLeft) {
+      state.sampleLeft = 0;
+      addBit(state.samplePanel, (state.sampleOnes * 2) > taken);
+    }
+  }
+
+void DSC_IRAM DSC::addBit(bool panel, bool bit)
+  {
+    if (panel) {
+      state.bitsSeen++;                           // Counted for the stuck data check
+      if (bit) state.onesSeen++;
+
+      // Bits after the end of a complete word are ignored until the next new word gap
+      if (state.pSkip) return;
+
+      // Build the word in place in the next free queue slot
+      dscFrame_t *f = state.pFrame;
+      if (!f) {
+        f = state.frames.reserve();
+        if (!f) {
+          state.overruns++;                       // process() is behind, drop this word
+          state.pSkip = true;
+          return;
+        }
+        f->pLen = 0;
+        state.pFrame = f;
+      }
+      if (f->pLen > MAX_BITS) return;             // Limit the word size to something manageable
+      f->pBits[f->pLen++] = bit ? '1' : '0';
+      f->end = state.lastChange;                  // Time of the latest panel bit
+
+      // Once the command byte is in, look up how long the word should be, and
+      // close the word as soon as its last bit arrives rather than at the gap
+      if (f->pLen == 8) {
+        byte cmd = 0;
+        for (byte i=0;i<8;i++) cmd = (cmd << 1) | (f->pBits[i] == '1');
+        state.pExpect = frameBits(cmd);
+      }
+      else if (f->pLen < 8) state.pExpect = 0;
+      if (state.pExpect && f->pLen >= state.pExpect) {
+        commitFrame();
+        state.pSkip = true;
       }
     }
-    // Otherwise, it's going LOW, this is KEYPAD data
     else {                                  
-      dscGlobal.lastFall = dscGlobal.lastChange;          // Set the lastFall time
-      if (dscGlobal.kBuild.length() <= MAX_BITS) {        // Limit the string size to something manageable 
-        //delayMicroseconds(200);           // Delay for 300 us to get a valid data line read
-        if (digitalRead(DTA_IN)) dscGlobal.kBuild += "1"; 
-        else dscGlobal.kBuild += "0";
-      }
+      if (state.kLen <= MAX_BITS)                 // Limit the word size to something manageable 
+        state.kBuild[state.kLen++] = bit ? '1' : '0';
+    }
+  }
+
+void DSC_IRAM DSC::commitFrame(void)
+  {
+    // Hands the panel word being built over to process(), along with the keypad
+    // bits sent in the same word. Each keypad bit comes on the falling edge before
+    // the panel bit of its clock cycle, so a word closed at its last panel bit has
+    // the keypad bits of all of its cycles. Words shorter than a command byte are
+    // dropped and their slot is reused
+    dscFrame_t *f = state.pFrame;
+    if (!f) return;
+    state.pFrame = NULL;
+    if (f->pLen < 8 || (state.pExpect && f->pLen < state.pExpect)) state.framingErrors++;
+    if (f->pLen < 8) return;
+    f->pBits[f->pLen] = 0;
+    memcpy(f->kBits, state.kBuild, state.kLen);
+    f->kBits[state.kLen] = 0;
+    f->kLen = state.kLen;
+    f->seq = ++state.frameCount;
+    state.frames.push();
+  }
+
+#if defined(ESP8266)
+/* Data line sampling timer. timer1 is shared by all of the instances: each clock
+ * edge sets its instance's next sample time (sampleDue), and the timer is armed
+ * for the earliest one. When it fires, every instance whose sample is due reads
+ * its data line, then the timer is re-armed for the next sample due, if any.
+ */
+static void DSC_IRAM sampleTimer_Handler()
+  {
+    unsigned long now = micros();
+    for (byte i=0;i<MAX_BUSES;i++) {
+      DSC *d = dscInstances[i];
+      if (d && d->state.sampleLeft && (long)(now - d->state.sampleDue) >= -2)
+        d->takeSample(false);
+    }
+    DSC::scheduleSamples();
+  }
+
+void DSC_IRAM DSC::scheduleSamples(void)
+  {
+    // Arms timer1 for the earliest sample due on any instance
+    unsigned long now = micros();
+    long wait = 0x7fffffff;
+    for (byte i=0;i<MAX_BUSES;i++) {
+      DSC *d = dscInstances[i];
+      if (!d || !d->state.sampleLeft) continue;
+      long w = (long)(d->state.sampleDue - now);
+      if (w < wait) wait = w;
+    }
+    if (wait == 0x7fffffff) return;           // Nothing pending
+    if (wait < 2) wait = 2;                   // Too close (or late), fire as soon as possible
+    timer1_write(wait * 5);                   // TIM_DIV16: 5 ticks per us at 80 MHz
+  }
+#endif
+
+void DSC::setSampling(unsigned int panelDelay, unsigned int keypadDelay, byte count, unsigned int spacing)
+  {
+    // Sets when the data line is read after a clock edge, must be called prior to begin()
+    sampleDelay[0] = panelDelay;
+    sampleDelay[1] = keypadDelay;
+    sampleCount = count ? count : 1;
+    sampleSpacing = spacing;
+  }
+
+byte DSC_IRAM DSC::frameBits(byte cmd)
+  {
+    // Returns the expected length in bits of a panel word with command byte "cmd",
+    // or 0 if it is not known (the word is then closed by the new word gap)
+    for (byte i=0;i<sizeof(FRAME_BITS)/sizeof(FRAME_BITS[0]);i++) {
+      if (FRAME_BITS[i][0] == cmd) return FRAME_BITS[i][1];
     }
+    return 0;
   }
 
 int DSC::process(void)
   {
     // ------------ Get/process incoming data -------------
-    dscGlobal.pCmd = 0, 
-    dscGlobal.kCmd = 0; 
+    state.pCmd = 0, 
+    state.kCmd = 0; 
     timeAvailable = false;      // Set the time element status to invalid
+    zoneFilter.service(millis()); // Pass on zone changes that have now been held long enough
+    keySequence.service(millis());  // End a key sequence that has timed out
+    health.service(state, micros()); // Bus faults, see DSC_Health.h
     
     // ----------------- Turn on/off LED ------------------
-    if ((millis() - dscGlobal.lastChange) > 500)
+    if ((millis() - state.lastChange) > 500)
       digitalWrite(LED, 0);     // Turn LED OFF (no recent status command [0x05])
     else
       digitalWrite(LED, 1);     // Turn LED ON  (recent status command [0x05])
@@ -147,272 +362,451 @@ int DSC::process(void)
     /*
      * The normal clock frequency is 1 Hz or one cycle every ms (1000 us) 
      * The new word marker is clock high for about 15 ms (15000 us)
-     * If the interval is longer than the required amount (NEW_WORD_INTV + 200 us), 
-     * and the panel word in progress (pBuild) is more than 8 characters long,
-     * process the panel and keypad words, otherwise return failure (0).
+     * The ISR queues a panel word once it has seen its last bit (words of known
+     * length) or the new word gap after it (NEW_WORD_INTV), if it is at least 8
+     * bits long. Process the oldest queued word, otherwise return failure (0).
+     * Words queued while the loop was busy are picked up on the next calls.
      */
-    if ((dscGlobal.intervalTimer < (NEW_WORD_INTV + 200)) || 
-            (dscGlobal.pBuild.length() < 8)) return 0;  // Return failure
+    dscFrame_t *f = state.frames.front();
+    if (!f) return 0;                 // Return failure
 
-    dscGlobal.pWord = dscGlobal.pBuild;   // Save the complete panel raw data bytes sentence
-    dscGlobal.pBuild = "";                // Reset the raw data panel word being built
-    dscGlobal.pMsg = "";                  // Initialize panel message for output
-    //dscGlobal.pCmd = 0;
+    state.pWord = f->pBits;           // Save the complete panel raw data bytes sentence
+    state.kWord = f->kBits;           // and the keypad word sent with it
+    state.frameEnd = f->end;
+    state.frameSeq = f->seq;
+    state.frames.pop();               // Let the ISR reuse the slot
+    state.pickup = micros();          // Time the word was picked up, see frameEnd
+    state.pMsg = "";                  // Initialize panel message for output
+    //state.pCmd = 0;
     
-    dscGlobal.kMsg = "";                  // Initialize keypad message for output 
-    //dscGlobal.kCmd = 0;
+    state.kMsg = "";                  // Initialize keypad message for output 
+    //state.kCmd = 0;
     
-    dscGlobal.pCmd = decodePanel();       // Decode the panel binary, return command byte, or 0
-    dscGlobal.kCmd = decodeKeypad();      // Decode the keypad binary, return command byte, or 0
+    state.pCmd = decodePanel();       // Decode the panel binary, return command byte, or 0
+    state.kCmd = decodeKeypad();      // Decode the keypad binary, return command byte, or 0
+    state.decoded = micros();         // Time decoding was done, see frameEnd/pickup
+    if (state.kCmd) keySequence.feed(state.kCmd, binToInt(state.kWord,8,8), millis());
+    if (state.pCmd) keepWord(state.pCmd);
+
+    // ----------------- Traffic census -------------------
+    // A repeat is not decoded again but still counts as decoded, and a word
+    // without a checksum byte never counts as a checksum failure
+    byte cmd = binToInt(state.pWord,0,8);
+    pStats.record(cmd, state.pWord.length(), pnlKnown(cmd),
+                  !pnlHasChkSum(cmd) || pnlChkSum(state.pWord));
+    if (state.kWord.length() >= 8)
+      kStats.record(binToInt(state.kWord,0,8), state.kWord.length(), kKnown, true);
     
-    if (dscGlobal.pCmd && dscGlobal.kCmd) return 3;  // Return 3 if both were decoded
-    else if (dscGlobal.kCmd) return 2;    // Return 2 if keypad word was decoded
-    else if (dscGlobal.pCmd) return 1;    // Return 1 if panel word was decoded
-    else return 0;                        // Return failure if none were decoded
+    if (state.pCmd && state.kCmd) return 3;  // Return 3 if both were decoded
+    else if (state.kCmd) return 2;    // Return 2 if keypad word was decoded
+    else if (state.pCmd) return 1;    // Return 1 if panel word was decoded
+    else return 0;                    // Return failure if none were decoded
   }
 
 byte DSC::decodePanel(void) 
   {
     // ------------- Process the Panel Data Word ---------------
-    byte cmd = binToInt(dscGlobal.pWord,0,8);   // Get the panel pCmd (data word type/command)
+    byte cmd = binToInt(state.pWord,0,8);   // Get the panel pCmd (data word type/command)
     
-    if (dscGlobal.pWord == dscGlobal.oldPWord || cmd == 0x00) {
+    if (state.pWord == state.oldPWord || cmd == 0x00) {
       // Skip this word if the data hasn't changed, or pCmd is empty (0x00)
       return 0;     // Return failure
     }
     else {     
       // This seems to be a valid word, try to process it  
-      dscGlobal.lastData = millis();            // Record the time (last data word was received)
-      dscGlobal.oldPWord = dscGlobal.pWord;     // This is a new/good word, save it
+      state.lastData = millis();            // Record the time (last data word was received)
+      state.oldPWord = state.pWord;     // This is a new/good word, save it
      
       // Interpret the data
       if (cmd == 0x05) 
       {
-        dscGlobal.lastStatus = millis();        // Record the time for LED logic
-        dscGlobal.pMsg += F("{\"Status\":[");
-        if (binToInt(dscGlobal.pWord,16,1)) {
-          dscGlobal.pMsg += F("\"Ready\"");
+        state.lastStatus = millis();        // Record the time for LED logic
+        byte lights = pnlLights();
+        state.armed = (lights & LIGHT_ARMED) ? 1 : 0;   // Lit for as long as the panel is armed
+        state.pMsg += F("{\"Status\":[");
+        if (lights & LIGHT_READY) {
+          state.pMsg += F("\"Ready\"");
         }
         else {
-          dscGlobal.pMsg += F("\"Not Ready\"");
+          state.pMsg += F("\"Not Ready\"");
         }
-        if (binToInt(dscGlobal.pWord,12,1)) dscGlobal.pMsg += F(",\"Error\"");
-        if (binToInt(dscGlobal.pWord,13,1)) dscGlobal.pMsg += F(",\"Bypass\"");
-        if (binToInt(dscGlobal.pWord,14,1)) dscGlobal.pMsg += F(",\"Memory\"");
-        if (binToInt(dscGlobal.pWord,15,1)) dscGlobal.pMsg += F(",\"Armed\"");
-        if (binToInt(dscGlobal.pWord,17,1)) dscGlobal.pMsg += F(",\"Program\"");
-        if (binToInt(dscGlobal.pWord,29,1)) dscGlobal.pMsg += F(",\"Power Fail\"");   // ??? - maybe 28 or 20?
-        dscGlobal.pMsg += F("]}");
+        if (lights & LIGHT_ERROR) state.pMsg += F(",\"Error\"");
+        if (lights & LIGHT_BYPASS) state.pMsg += F(",\"Bypass\"");
+        if (lights & LIGHT_MEMORY) state.pMsg += F(",\"Memory\"");
+        if (lights & LIGHT_ARMED) state.pMsg += F(",\"Armed\"");
+        if (lights & LIGHT_PROGRAM) state.pMsg += F(",\"Program\"");
+        if (binToInt(state.pWord,29,1)) state.pMsg += F(",\"Power Fail\"");   // ??? - maybe 28 or 20?
+        state.pMsg += F("]}");
       }    
       else if (cmd == 0xa5)
       {
-        dscGlobal.pMsg += F("{\"PanelDateTime\":\"");
-        int y3 = binToInt(dscGlobal.pWord,9,4);
-        int y4 = binToInt(dscGlobal.pWord,13,4);
-        yy = (String(y3) + String(y4)).toInt();
-        mm = binToInt(dscGlobal.pWord,19,4);
-        dd = binToInt(dscGlobal.pWord,23,5);
-        HH = binToInt(dscGlobal.pWord,28,5);
-        MM = binToInt(dscGlobal.pWord,33,6);     
+        state.pMsg += F("{\"PanelDateTime\":\"");
+        int y3 = binToInt(state.pWord,9,4);
+        int y4 = binToInt(state.pWord,13,4);
+        yy = y3 * (y4 < 10 ? 10 : 100) + y4;   // The two digits side by side
+        mm = binToInt(state.pWord,19,4);
+        dd = binToInt(state.pWord,23,5);
+        HH = binToInt(state.pWord,28,5);
+        MM = binToInt(state.pWord,33,6);     
 
         timeAvailable = true;      // Set the time element status to valid
-        dscGlobal.pMsg += "20" + String(yy) + "/" + String(mm) + "/" + String(dd) + 
-                          " " + String(HH) + ":" + String(MM) + "\"";
+        // Appended a piece at a time, so no temporary String is allocated
+        state.pMsg += F("20");
+        state.pMsg += yy;
+        state.pMsg += '/';
+        state.pMsg += mm;
+        state.pMsg += '/';
+        state.pMsg += dd;
+        state.pMsg += ' ';
+        state.pMsg += HH;
+        state.pMsg += ':';
+        state.pMsg += MM;
+        state.pMsg += '"';
 
-        dscGlobal.pMsg += ",\"Armed\":";
-        byte arm = binToInt(dscGlobal.pWord,41,2);
-        byte master = binToInt(dscGlobal.pWord,43,1);
-        byte user = binToInt(dscGlobal.pWord,43,6); // 0-36
+        // The arm field of a time word is 0 in the periodic ones, whatever the
+        // panel's state, so state.armed is left to the 0x05 Armed light
+        state.pMsg += ",\"Armed\":";
+        byte arm = binToInt(state.pWord,41,2);
+        byte master = binToInt(state.pWord,43,1);
+        byte user = binToInt(state.pWord,43,6); // 0-36
         if (arm == 0x02) {
-          dscGlobal.pMsg += F("1");
+          state.pMsg += F("1");
           user = user - 0x19;
         }
         if ((arm == 0x03) || (arm == 0)) { //MC: Assuming 0 is also disarmed
-          dscGlobal.pMsg += F("0");
+          state.pMsg += F("0");
         }
+        state.armUser = 0;
         if (arm > 0) {
-          if (master) dscGlobal.pMsg += F(",\"MasterCode\":"); 
-          else dscGlobal.pMsg += F(",\"UserCode\":");
+          if (master) state.pMsg += F(",\"MasterCode\":"); 
+          else state.pMsg += F(",\"UserCode\":");
           user += 1; // shift to 1-32, 33, 34
           if (user > 34) user += 5; // convert to system code 40, 41, 42
-          dscGlobal.pMsg += "\"" + String(user) + "\"";
+          state.pMsg += '"';
+          state.pMsg += user;
+          state.pMsg += '"';
+          state.armUser = user;
         }
-        dscGlobal.pMsg += "}";
+        state.pMsg += "}";
       }      
       else if (cmd == 0x27)
       {
-        dscGlobal.pMsg += F("{\"ZonesA\":[");
-        int zones = binToInt(dscGlobal.pWord,8+1+8+8+8+8,8);
-        dscGlobal.pMsg += String((zones & 1) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 2) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 4) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 8) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 16) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 32) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 64) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 128) != 0) + F("]}");
-        //if (zones == 0) dscGlobal.pMsg += "Ready ";
+        state.pMsg += F("{\"ZonesA\":[");
+        int zones = binToInt(state.pWord,8+1+8+8+8+8,8);
+        state.zones[0] = zones;               // Zones 1-8
+        zoneFilter.update(0, zones, millis());
+        state.pMsg += String((zones & 1) != 0) + F(",");
+        state.pMsg += String((zones & 2) != 0) + F(",");
+        state.pMsg += String((zones & 4) != 0) + F(",");
+        state.pMsg += String((zones & 8) != 0) + F(",");
+        state.pMsg += String((zones & 16) != 0) + F(",");
+        state.pMsg += String((zones & 32) != 0) + F(",");
+        state.pMsg += String((zones & 64) != 0) + F(",");
+        state.pMsg += String((zones & 128) != 0) + F("]}");
+        //if (zones == 0) state.pMsg += "Ready ";
       }
       
       if (cmd == 0x2d)
       {
-        dscGlobal.pMsg += F("{\"ZonesB\":[");
-        int zones = binToInt(dscGlobal.pWord,8+1+8+8+8+8,8);
-        dscGlobal.pMsg += String((zones & 1) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 2) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 4) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 8) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 16) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 32) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 64) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 128) != 0) + F("]}");
-        //if (zones == 0) dscGlobal.pMsg += "Ready ";
+        state.pMsg += F("{\"ZonesB\":[");
+        int zones = binToInt(state.pWord,8+1+8+8+8+8,8);
+        state.zones[1] = zones;               // Zones 9-16
+        zoneFilter.update(1, zones, millis());
+        state.pMsg += String((zones & 1) != 0) + F(",");
+        state.pMsg += String((zones & 2) != 0) + F(",");
+        state.pMsg += String((zones & 4) != 0) + F(",");
+        state.pMsg += String((zones & 8) != 0) + F(",");
+        state.pMsg += String((zones & 16) != 0) + F(",");
+        state.pMsg += String((zones & 32) != 0) + F(",");
+        state.pMsg += String((zones & 64) != 0) + F(",");
+        state.pMsg += String((zones & 128) != 0) + F("]}");
+        //if (zones == 0) state.pMsg += "Ready ";
       }
       
       if (cmd == 0x34)
       {
-        dscGlobal.pMsg += F("{\"ZonesC\":[");
-        int zones = binToInt(dscGlobal.pWord,8+1+8+8+8+8,8);
-        dscGlobal.pMsg += String((zones & 1) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 2) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 4) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 8) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 16) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 32) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 64) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 128) != 0) + F("]}");
-        //if (zones == 0) dscGlobal.pMsg += "Ready ";
+        state.pMsg += F("{\"ZonesC\":[");
+        int zones = binToInt(state.pWord,8+1+8+8+8+8,8);
+        state.zones[2] = zones;               // Zones 17-24
+        zoneFilter.update(2, zones, millis());
+        state.pMsg += String((zones & 1) != 0) + F(",");
+        state.pMsg += String((zones & 2) != 0) + F(",");
+        state.pMsg += String((zones & 4) != 0) + F(",");
+        state.pMsg += String((zones & 8) != 0) + F(",");
+        state.pMsg += String((zones & 16) != 0) + F(",");
+        state.pMsg += String((zones & 32) != 0) + F(",");
+        state.pMsg += String((zones & 64) != 0) + F(",");
+        state.pMsg += String((zones & 128) != 0) + F("]}");
+        //if (zones == 0) state.pMsg += "Ready ";
       }
       
       if (cmd == 0x3e)
       {
-        dscGlobal.pMsg += F("{\"ZonesD\":[");
-        int zones = binToInt(dscGlobal.pWord,8+1+8+8+8+8,8);
-        dscGlobal.pMsg += String((zones & 1) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 2) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 4) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 8) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 16) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 32) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 64) != 0) + F(",");
-        dscGlobal.pMsg += String((zones & 128) != 0) + F("]}");
-        //if (zones == 0) dscGlobal.pMsg += "Ready ";
+        state.pMsg += F("{\"ZonesD\":[");
+        int zones = binToInt(state.pWord,8+1+8+8+8+8,8);
+        state.zones[3] = zones;               // Zones 25-32
+        zoneFilter.update(3, zones, millis());
+        state.pMsg += String((zones & 1) != 0) + F(",");
+        state.pMsg += String((zones & 2) != 0) + F(",");
+        state.pMsg += String((zones & 4) != 0) + F(",");
+        state.pMsg += String((zones & 8) != 0) + F(",");
+        state.pMsg += String((zones & 16) != 0) + F(",");
+        state.pMsg += String((zones & 32) != 0) + F(",");
+        state.pMsg += String((zones & 64) != 0) + F(",");
+        state.pMsg += String((zones & 128) != 0) + F("]}");
+        //if (zones == 0) state.pMsg += "Ready ";
       }
       // --- The other 32 zones for a 1864 panel need to be added after this ---
       else if (cmd == 0x11) {
-        dscGlobal.pMsg += F("{\"KeypadQuery\":\"");
-        dscGlobal.pMsg += String(binToChar(dscGlobal.pWord, 0, dscGlobal.pWord.length()));
-        dscGlobal.pMsg += F("\"}");
+        // Keypad slot query, the keypads answer on the keypad line
+        state.pMsg += F("{\"KeypadQuery\":\"");
+        appendHex(1);
+        state.pMsg += F("\"}");
       }
       else if (cmd == 0x0a) {
-        dscGlobal.pMsg += F("{\"PanelProgramMode\":\"");
-        dscGlobal.pMsg += String(binToChar(dscGlobal.pWord, 0, dscGlobal.pWord.length()));
-        dscGlobal.pMsg += F("\"}");
+        // Status while in programming: lights, program status code, zone lights
+        state.pMsg += F("{\"PanelProgramMode\":{\"Lights\":");
+        appendLights();
+        state.pMsg += F(",\"Status\":\"");
+        state.pMsg += hex[pnlByte(2) >> 4];
+        state.pMsg += hex[pnlByte(2) & 0x0f];
+        state.pMsg += F("\",\"Zones\":");
+        appendZones(3, 4);
+        state.pMsg += F("}}");
       } 
-      else if (cmd == 0x5d) {
-        dscGlobal.pMsg += F("{\"AlarmMemoryGroup1\":\"");
-        dscGlobal.pMsg += String(binToChar(dscGlobal.pWord, 0, dscGlobal.pWord.length()));
-        dscGlobal.pMsg += F("\"}");
+      else if (cmd == 0x5d || cmd == 0x63) {
+        // Flashing lights and alarm memory zones 1-32
+        if (cmd == 0x5d) state.pMsg += F("{\"AlarmMemoryGroup1\":{\"Lights\":");
+        else state.pMsg += F("{\"AlarmMemoryGroup2\":{\"Lights\":");
+        appendLights();
+        state.pMsg += F(",\"Zones\":");
+        appendZones(2, 4);
+        state.pMsg += F("}}");
       } 
-      else if (cmd == 0x63) {
-        dscGlobal.pMsg += F("{\"AlarmMemoryGroup2\":\"");
-        dscGlobal.pMsg += String(binToChar(dscGlobal.pWord, 0, dscGlobal.pWord.length()));
-        dscGlobal.pMsg += F("\"}");
-      } 
-      else if (cmd == 0x64) {
-        dscGlobal.pMsg += F("{\"BeepCommandGroup1\":\"");
-        dscGlobal.pMsg += String(binToChar(dscGlobal.pWord, 0, dscGlobal.pWord.length()));
-        dscGlobal.pMsg += F("\"}");
-      } 
-      else if (cmd == 0x69) {
-        dscGlobal.pMsg += F("{\"BeepCommandGroup2\":\"");
-        dscGlobal.pMsg += String(binToChar(dscGlobal.pWord, 0, dscGlobal.pWord.length()));
-        dscGlobal.pMsg += F("\"}");
+      else if (cmd == 0x64 || cmd == 0x69) {
+        // Keypad beeps: an even code 0x02-0x0e is a number of short beeps
+        byte code = pnlByte(1);
+        if (cmd == 0x64) state.pMsg += F("{\"BeepCommandGroup1\":{");
+        else state.pMsg += F("{\"BeepCommandGroup2\":{");
+        if (code >= 0x02 && code <= 0x0e && !(code & 1)) {
+          state.pMsg += F("\"Beeps\":");
+          state.pMsg += String(code / 2);
+        }
+        else {
+          state.pMsg += F("\"Code\":\"");
+          state.pMsg += hex[code >> 4];
+          state.pMsg += hex[code & 0x0f];
+          state.pMsg += F("\"");
+        }
+        state.pMsg += F("}}");
       } 
       else if (cmd == 0x39) {
-        dscGlobal.pMsg += F("{\"Undefined\":\"");
-        dscGlobal.pMsg += String(binToChar(dscGlobal.pWord, 0, dscGlobal.pWord.length()));
-        dscGlobal.pMsg += F("\"}");
+        state.pMsg += F("{\"Undefined\":\"");
+        appendHex(1);
+        state.pMsg += F("\"}");
       } 
       else if (cmd == 0xb1) {
-        dscGlobal.pMsg += F("{\"ZoneConfiguration\":\"");
-        dscGlobal.pMsg += String(binToChar(dscGlobal.pWord, 0, dscGlobal.pWord.length()));
-        dscGlobal.pMsg += F("\"}");
+        // Zones enabled (configured) in each partition, zones 1-32
+        state.pMsg += F("{\"ZoneConfiguration\":{\"Partition1\":");
+        appendZones(1, 4);
+        state.pMsg += F(",\"Partition2\":");
+        appendZones(5, 4);
+        state.pMsg += F("}}");
       }
     return cmd;     // Return success
     }
   }
 
+void DSC::keepWord(byte cmd)
+  {
+    // Packs the panel word into the snapshot, if its command byte is kept
+    for (byte i=0;i<SNAP_WORDS;i++) {
+      if (SNAP_CMDS[i] != cmd) continue;
+      byte bits = state.pWord.length() > SNAP_BYTES * 8 ? SNAP_BYTES * 8 : state.pWord.length();
+      memset(state.snap.words[i], 0, SNAP_BYTES);
+      for (byte j=0;j<bits;j++) {
+        if (state.pWord[j] == '1') state.snap.words[i][j >> 3] |= 0x80 >> (j & 7);
+      }
+      state.snap.bits[i] = bits;
+      return;
+    }
+  }
+
+void DSC::saveState(dscSnapshot_t &snap)
+  {
+    memcpy(state.snap.zones, zoneFilter.zones, ZONE_GROUPS);
+    state.snap.frameCount = state.frameCount;
+    snap = state.snap;
+  }
+
+void DSC::restoreState(const dscSnapshot_t &snap)
+  {
+    state.snap = snap;
+    state.frameCount = snap.frameCount;
+    zoneFilter.preset(snap.zones);
+  }
+
+byte DSC::restoreWord(byte i)
+  {
+    state.pCmd = 0;
+    state.pMsg = "";
+    if (i >= SNAP_WORDS || !state.snap.bits[i]) return 0;   // Return failure
+
+    state.pWord = "";
+    for (byte j=0;j<state.snap.bits[i];j++) {
+      state.pWord += (state.snap.words[i][j >> 3] & (0x80 >> (j & 7))) ? '1' : '0';
+    }
+    state.oldPWord = "";              // Not a repeat, decode it whatever came before
+    state.pCmd = decodePanel();
+    return state.pCmd;
+  }
+
+byte DSC::pnlByte(byte n)
+  {
+    // Returns data byte "n" of the panel word, 0 if the word is too short
+    return binToInt(state.pWord, 9 + (n - 1) * 8, 8);
+  }
+
+byte DSC::pnlLights(void)
+  {
+    // The first data byte, with Program taken from the second as the 0x05
+    // status decoder has always read it
+    byte lights = pnlByte(1) & ~LIGHT_PROGRAM;
+    if (binToInt(state.pWord,17,1)) lights |= LIGHT_PROGRAM;
+    return lights;
+  }
+
+void DSC::appendLights(void)
+  {
+    // Appends the names of the keypad lights of the word (see pnlLights()) as
+    // a JSON list
+    static const char* const names[8] = {
+      "Ready", "Armed", "Memory", "Bypass", "Error", "Program", "Fire", "Backlight"
+    };
+    byte lights = pnlLights();
+    bool first = true;
+    state.pMsg += "[";
+    for (byte i=0;i<8;i++) {
+      if (!(lights & (1 << i))) continue;
+      if (!first) state.pMsg += ",";
+      state.pMsg += "\"";
+      state.pMsg += names[i];
+      state.pMsg += "\"";
+      first = false;
+    }
+    state.pMsg += "]";
+  }
+
+void DSC::appendZones(byte firstByte, byte count)
+  {
+    // Appends the zone numbers set in "count" data bytes from "firstByte" as a
+    // JSON list, e.g. [3,17]. Bit 0 of the first byte is zone 1
+    bool first = true;
+    state.pMsg += "[";
+    for (byte b=0;b<count;b++) {
+      byte bits = pnlByte(firstByte + b);
+      for (byte i=0;i<8;i++) {
+        if (!(bits & (1 << i))) continue;
+        if (!first) state.pMsg += ",";
+        state.pMsg += String(b * 8 + i + 1);
+        first = false;
+      }
+    }
+    state.pMsg += "]";
+  }
+
+void DSC::appendHex(byte firstByte)
+  {
+    // Appends the whole data bytes from "firstByte" on as a hex string
+    int bytes = ((int)state.pWord.length() - 9) / 8;
+    for (int n=firstByte;n<=bytes;n++) {
+      byte b = pnlByte(n);
+      state.pMsg += hex[b >> 4];
+      state.pMsg += hex[b & 0x0f];
+    }
+  }
+
 byte DSC::decodeKeypad(void) 
   {
     // ------------- Process the Keypad Data Word ---------------
-    byte cmd = binToInt(dscGlobal.kWord,0,8);     // Get the keypad pCmd (data word type/command)
-    String btnStr = F("[Button] ");
+    byte cmd = binToInt(state.kWord,0,8);     // Get the keypad pCmd (data word type/command)
+    const char *key = NULL;                   // The name of the key pressed, after "[Button] "
+    kKnown = false;                           // Set when the word maps to a known key
 
-    if (dscGlobal.kWord.indexOf("0") == -1) {  
+    if (state.kWord.indexOf("0") == -1) {  
       // Skip this word if kWord is all 1's
       return 0;     // Return failure
     }
     else { 
       // This seems to be a valid word, try to process it
-      dscGlobal.lastData = millis();              // Record the time (last data word was received)
-      dscGlobal.oldKWord = dscGlobal.kWord;                 // This is a new/good word, save it
+      state.lastData = millis();              // Record the time (last data word was received)
+      state.oldKWord = state.kWord;                 // This is a new/good word, save it
 
-      byte kByte2 = binToInt(dscGlobal.kWord,8,8); 
+      byte kByte2 = binToInt(state.kWord,8,8); 
      
       // Interpret the data
       if (cmd == kOut) {
+        kKnown = true;
         if (kByte2 == one)
-          dscGlobal.kMsg += btnStr + "1";
+          key = "1";
         else if (kByte2 == two)
-          dscGlobal.kMsg += btnStr + "2";
+          key = "2";
         else if (kByte2 == three)
-          dscGlobal.kMsg += btnStr + "3";
+          key = "3";
         else if (kByte2 == four)
-          dscGlobal.kMsg += btnStr + "4";
+          key = "4";
         else if (kByte2 == five)
-          dscGlobal.kMsg += btnStr + "5";
+          key = "5";
         else if (kByte2 == six)
-          dscGlobal.kMsg += btnStr + "6";
+          key = "6";
         else if (kByte2 == seven)
-          dscGlobal.kMsg += btnStr + "7";
+          key = "7";
         else if (kByte2 == eight)
-          dscGlobal.kMsg += btnStr + "8";
+          key = "8";
         else if (kByte2 == nine)
-          dscGlobal.kMsg += btnStr + "9";
+          key = "9";
         else if (kByte2 == aster)
-          dscGlobal.kMsg += btnStr + "*";
+          key = "*";
         else if (kByte2 == zero)
-          dscGlobal.kMsg += btnStr + "0";
+          key = "0";
         else if (kByte2 == pound)
-          dscGlobal.kMsg += btnStr + "#";
+          key = "#";
         else if (kByte2 == stay)
-          dscGlobal.kMsg += btnStr + F("Stay");
+          key = "Stay";
         else if (kByte2 == away)
-          dscGlobal.kMsg += btnStr + F("Away");
+          key = "Away";
         else if (kByte2 == chime)
-          dscGlobal.kMsg += btnStr + F("Chime");
+          key = "Chime";
         else if (kByte2 == reset)
-          dscGlobal.kMsg += btnStr + F("Reset");
+          key = "Reset";
         else if (kByte2 == kExit)
-          dscGlobal.kMsg += btnStr + F("Exit");
+          key = "Exit";
         else if (kByte2 == lArrow)  // These arrow commands don't work every time
-          dscGlobal.kMsg += btnStr + F("<");
+          key = "<";
         else if (kByte2 == rArrow)  // They are often reverse for unknown reasons
-          dscGlobal.kMsg += btnStr + F(">");
+          key = ">";
         else if (kByte2 == kOut)
-          dscGlobal.kMsg += F("[Keypad Response]");
+          state.kMsg += F("[Keypad Response]");
         else {
-          dscGlobal.kMsg += "[Keypad] 0x" + String(kByte2, HEX) + " (Unknown)";
+          state.kMsg += F("[Keypad] 0x");
+          state.kMsg += String(kByte2, HEX);
+          state.kMsg += F(" (Unknown)");
+          kKnown = false;
         }
       }
 
       if (cmd == fire)
-        dscGlobal.kMsg += btnStr + F("Fire");
+        key = "Fire";
       if (cmd == aux)
-        dscGlobal.kMsg += btnStr + F("Auxillary");
+        key = "Auxillary";
       if (cmd == panic)
-        dscGlobal.kMsg += btnStr + F("Panic");
+        key = "Panic";
+      if (cmd == fire || cmd == aux || cmd == panic) kKnown = true;
+      if (key) {
+        // Appended a piece at a time, so no temporary String is allocated
+        state.kMsg += F("[Button] ");
+        state.kMsg += key;
+      }
       
       return cmd;     // Return success
     }
@@ -420,58 +814,58 @@ byte DSC::decodeKeypad(void)
 
 const char* DSC::pnlFormat(void)
   {
-    if (!dscGlobal.pCmd) return NULL;       // return failure
+    if (!state.pCmd) return NULL;       // return failure
     // Formats the panel binary string into bytes of binary data in the form:
     // 8 1 8 8 8 8 8 etc, and returns a pointer to the buffer 
     pInfo.clear();
     pInfo.print("[Panel]  ");
 
-    if (dscGlobal.pWord.length() > 8) {
-      pInfo.print(binToChar(dscGlobal.pWord, 0, 8));
+    if (state.pWord.length() > 8) {
+      pInfo.print(binToChar(state.pWord, 0, 8));
       pInfo.print(" ");
-      pInfo.print(binToChar(dscGlobal.pWord, 8, 9));
+      pInfo.print(binToChar(state.pWord, 8, 9));
       pInfo.print(" ");
-      int grps = (dscGlobal.pWord.length() - 9) / 8;
+      int grps = (state.pWord.length() - 9) / 8;
       for(int i=0;i<grps;i++) {
-        pInfo.print(binToChar(dscGlobal.pWord, 9+(i*8),9+(i+1)*8));
+        pInfo.print(binToChar(state.pWord, 9+(i*8),9+(i+1)*8));
         pInfo.print(" ");
       }
-      if (dscGlobal.pWord.length() > ((grps*8)+9))
-        pInfo.print(binToChar(dscGlobal.pWord, (grps*8)+9, dscGlobal.pWord.length()));
+      if (state.pWord.length() > ((grps*8)+9))
+        pInfo.print(binToChar(state.pWord, (grps*8)+9, state.pWord.length()));
     }
     else
-      pInfo.print(binToChar(dscGlobal.pWord, 0, dscGlobal.pWord.length()));
+      pInfo.print(binToChar(state.pWord, 0, state.pWord.length()));
 
-    if (pnlChkSum(dscGlobal.pWord)) pInfo.print(" (OK)");
+    if (pnlChkSum(state.pWord)) pInfo.print(" (OK)");
 
     return pInfo.getBuffer();               // return the pointer
   }
 
 const char* DSC::pnlRaw(void)
   {
-    if (!dscGlobal.pCmd) return NULL;       // return failure
+    if (!state.pCmd) return NULL;       // return failure
     // Puts the raw word into a buffer and returns a pointer to the buffer
     pInfo.clear();
     pInfo.print("");
     
-    for(int i=0;i<dscGlobal.pWord.length();i++) {
-      pInfo.print(dscGlobal.pWord[i]);
+    for(int i=0;i<state.pWord.length();i++) {
+      pInfo.print(state.pWord[i]);
     }
     
-    if (pnlChkSum(dscGlobal.pWord)) pInfo.print(" (OK)");
+    if (pnlChkSum(state.pWord)) pInfo.print(" (OK)");
     
     return pInfo.getBuffer();               // return the pointer
   }
 
 const char* DSC::kpdRaw(void)
   {
-    if (!dscGlobal.kCmd) return NULL;       // return failure
+    if (!state.kCmd) return NULL;       // return failure
     // Puts the raw word into a buffer and returns a pointer to the buffer
     kInfo.clear();
     kInfo.print("");
     
-    for(int i=0;i<dscGlobal.kWord.length();i++) {
-      kInfo.print(dscGlobal.kWord[i]);
+    for(int i=0;i<state.kWord.length();i++) {
+      kInfo.print(state.kWord[i]);
     }
     
     return kInfo.getBuffer();               // return the pointer
@@ -479,27 +873,43 @@ const char* DSC::kpdRaw(void)
 
 const char* DSC::kpdFormat(void)
   {
-    if (!dscGlobal.kCmd) return NULL;       // return failure
+    if (!state.kCmd) return NULL;       // return failure
     // Formats the referenced string into bytes of binary data in the form:
     // 8 8 8 8 8 8 etc, and returns a pointer to the buffer 
     kInfo.clear();
     kInfo.print("[Keypad] ");
     
-    if (dscGlobal.kWord.length() > 8) {
-      int grps = dscGlobal.kWord.length() / 8;
+    if (state.kWord.length() > 8) {
+      int grps = state.kWord.length() / 8;
       for(int i=0;i<grps;i++) {
-        kInfo.print(binToChar(dscGlobal.kWord, i*8,(i+1)*8));
+        kInfo.print(binToChar(state.kWord, i*8,(i+1)*8));
         kInfo.print(" ");
       }
-      if (dscGlobal.kWord.length() > (grps*8))
-        kInfo.print(binToChar(dscGlobal.kWord, (grps*8),dscGlobal.kWord.length()));
+      if (state.kWord.length() > (grps*8))
+        kInfo.print(binToChar(state.kWord, (grps*8),state.kWord.length()));
     }
     else
-      kInfo.print(binToChar(dscGlobal.kWord, 0, dscGlobal.kWord.length()));
+      kInfo.print(binToChar(state.kWord, 0, state.kWord.length()));
 
     return kInfo.getBuffer();               // return the pointer
   }
 
+bool DSC::pnlKnown(byte cmd)
+  {
+    for (byte i=0;i<sizeof(PANEL_CMDS)/sizeof(PANEL_CMDS[0]);i++) {
+      if (PANEL_CMDS[i][0] == cmd) return true;
+    }
+    return false;
+  }
+
+bool DSC::pnlHasChkSum(byte cmd)
+  {
+    for (byte i=0;i<sizeof(PANEL_CMDS)/sizeof(PANEL_CMDS[0]);i++) {
+      if (PANEL_CMDS[i][0] == cmd) return PANEL_CMDS[i][1];
+    }
+    return false;
+  }
+
 int DSC::pnlChkSum(String &dataStr)
   {
     // Sums all but the last full byte (minus padding) and compares to last byte
@@ -531,10 +941,12 @@ int DSC::pnlChkSum(String &dataStr)
 unsigned int DSC::binToInt(String &dataStr, int offset, int dataLen)
   {
     // Returns the value of the binary data in the String from "offset" to "dataLen" as an int
+    // Bits past the end of the String (short or truncated words) are read as 0
     int iBuf = 0;
+    int len = dataStr.length();
     for(int j=0;j<dataLen;j++) {
       iBuf <<= 1;
-      if (dataStr[offset+j] == '1') iBuf |= 1;
+      if ((offset+j) >= 0 && (offset+j) < len && dataStr[offset+j] == '1') iBuf |= 1;
     }
     return iBuf;
   }
@@ -543,9 +955,11 @@ const char* DSC::binToChar(String &dataStr, int offset, int endData)
   {   
     tempByte.clear();
     // Returns a char array of the binary data in the String from "offset" to "endData"
-    tempByte.print(dataStr[offset]);
-    for(int j=1;j<(endData-offset);j++) {
-      tempByte.print(dataStr[offset+j]);
+    // The range is clipped to the String, an empty range returns an empty buffer
+    if (offset < 0) offset = 0;
+    if (endData > (int)dataStr.length()) endData = dataStr.length();
+    for(int j=offset;j<endData;j++) {
+      tempByte.print(dataStr[j]);
     }
     return tempByte.getBuffer();
   }
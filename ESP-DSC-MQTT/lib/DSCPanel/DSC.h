@@ -21,6 +21,15 @@ DSC.h (
 #define DSC_h
 #include "DSC_Globals.h"
 #include "DSC_Constants.h"
+#include "DSC_Stats.h"
+#include "DSC_Zones.h"
+#include "DSC_Keys.h"
+#include "DSC_Health.h"
+#include "DSC_Batch.h"
+#include "DSC_Rules.h"
+#include "DSC_Trace.h"
+#include "DSC_Gpio.h"
+#include <TextBuffer.h>
 
 #if defined(ARDUINO) && ARDUINO >= 100
 #include "Arduino.h"
@@ -33,6 +42,7 @@ class DSC : public Print  // Initialize DSC as an extension of the print class
   public:
     // Class to call to initialize the DSC Class
     // for example...  DSC dsc;
+    // Several instances may exist, one per keybus (up to MAX_BUSES attached)
     DSC(void);
     
     // Used to add the serial instance to the DSC Class
@@ -40,7 +50,11 @@ class DSC : public Print  // Initialize DSC as an extension of the print class
     
     // Included in the setup function of the user's sketch
     // Begins the the class, sets the pin modes, attaches the interrupt
-    void begin(void);
+    // Returns:   1 for success, 0 if MAX_BUSES instances are already attached
+    int begin(void);
+    
+    // Detaches the interrupt and frees this instance's slot in the ISR table
+    void end(void);
     
     // Included in the main loop of user's sketch, checks and processes 
     // the current panel and keypad words if able
@@ -52,9 +66,6 @@ class DSC : public Print  // Initialize DSC as an extension of the print class
     byte decodePanel(void);
     byte decodeKeypad(void);
     
-    // Ends, or de-constructs the class - NOT USED  
-    //int end();
-    
     // Returns the panel and keypad word in formatted binary (returns NULL if failure)
     const char* pnlFormat(void);
     const char* kpdFormat(void);
@@ -63,8 +74,33 @@ class DSC : public Print  // Initialize DSC as an extension of the print class
     const char* pnlRaw(void);
     const char* kpdRaw(void);
     
+    // ----- Warm Restart -----
+    // Copies the decoded state kept across a restart (see dscSnapshot_t) into "snap"
+    void saveState(dscSnapshot_t &snap);
+
+    // Restores a snapshot saved before a restart, prior to begin(). restoreWord()
+    // then re-decodes saved word "i" (0 to SNAP_WORDS-1) as if it had just been
+    // received, setting pWord, pCmd, pMsg and the decoded state, so the sketch can
+    // rebuild its own state from it. Returns the command byte, 0 if none was saved
+    void restoreState(const dscSnapshot_t &snap);
+    byte restoreWord(byte i);
+
+    // Returns the expected length in bits of a panel word, 0 if not known
+    byte frameBits(byte cmd);
+
+    // Returns 1 if decodePanel() decodes command byte "cmd", 0 if not
+    bool pnlKnown(byte cmd);
+
+    // Returns 1 if the words of command byte "cmd" end with a checksum byte, 0 if
+    // not (or if the command is not known)
+    bool pnlHasChkSum(byte cmd);
+
     // Returns 1 if there is a valid checksum, 0 if not
     int pnlChkSum(String &dataStr);
+
+    // Returns the keypad lights of the panel word (0x05, 0x0a, 0x5d, 0x63) as a
+    // bitmap of LIGHT_* (see DSC_Constants.h)
+    byte pnlLights(void);
     
     unsigned int binToInt(String &dataStr, int offset, int dataLen);
     const char* binToChar(String &dataStr, int offset, int endData);    
@@ -75,18 +111,130 @@ class DSC : public Print  // Initialize DSC as an extension of the print class
     void setDTA_IN(int p);
     void setDTA_OUT(int p);
     void setLED(int p);
+
+    // Sets when the data line is read after a clock edge: "panelDelay" us after a
+    // rising edge, "keypadDelay" us after a falling edge, "count" reads "spacing"
+    // us apart, majority-voted. A count of 1 reads on the clock edge itself.
+    // Deferred reads use timer1 (ESP8266 only), so analogWrite(), tone() and
+    // Servo cannot be used alongside them. Must be called prior to begin()
+    void setSampling(unsigned int panelDelay, unsigned int keypadDelay, 
+                     byte count = 3, unsigned int spacing = 20);
    
     // ----- Print class extension variables -----
     virtual size_t write(uint8_t);
     virtual size_t write(const char *str);
     virtual size_t write(const uint8_t *buffer, size_t size);
 
+    // Called by the ISR trampolines on every clock line change, not by user code
+    void clkCalled(void);
+
+    // Called by the sampling timer ISR, not by user code
+    void takeSample(bool resolve);
+    static void scheduleSamples(void);
+
     // Class level variables to hold time elements
     int yy, mm, dd, HH, MM, SS;
     bool timeAvailable;
 
+    // Keybus words, messages and ISR timing for this instance (see DSC_Globals.h)
+    dscState_t state;
+
+    // Traffic census per panel and keypad command byte (see DSC_Stats.h)
+    DSCStats pStats, kStats;
+
+    // Debounced zone states and chatter flags (see DSC_Zones.h), fed by decodePanel()
+    DSCZoneFilter zoneFilter;
+
+    // Keypad words grouped into actions, codes masked (see DSC_Keys.h), fed by process()
+    DSCKeySequence keySequence;
+
+    // Keybus faults (clock lost, data stuck, edge rate, framing), see DSC_Health.h
+    DSCHealth health;
+
+  protected:
+    // The steps of the clock ISR, shared with DSCBus below: clockEdge() times the
+    // edge, deferSample() hands the data read to the sampling timer (returns true
+    // if it did), otherwise addBit() adds the bit read on the edge
+    void clockEdge(bool panel, unsigned long now);
+    bool deferSample(bool panel);
+    void addBit(bool panel, bool bit);
+
+    // ISR attached by begin() instead of the slot's trampoline, if set
+    void (*isrHandler)(void);
+
+    // Reads the data line for the sampling timer (takeSample()) instead of
+    // DSCGpio::read(DTA_IN), if set, so a DSCBus reads it with its own policy
+    bool (*dataReader)(void);
+
   private:
+    void commitFrame(void);
+    void keepWord(byte cmd);
+
+    // Field helpers for decodePanel(): data byte "n" (1 = the byte after the
+    // separator bit) of the panel word, and JSON lists appended to pMsg
+    byte pnlByte(byte n);
+    void appendLights(void);
+    void appendZones(byte firstByte, byte count);
+    void appendHex(byte firstByte);
+
     uint8_t intrNum;
+    int8_t slot;      // Index in the ISR trampoline table, -1 when not attached
+    bool kKnown;      // Last keypad word decoded to a known key
+
+    // ----- Input/Output Pins -----
+    byte CLK;         // Keybus Yellow (Clock Line)
+    byte DTA_IN;      // Keybus Green (Data Line via V divider)
+    byte DTA_OUT;     // Keybus Green Output (Data Line through driver)
+    byte LED;         // LED pin on the arduino
+
+    // ----- Data Line Sampling -----
+    unsigned int sampleDelay[2];  // Settle time after a rising [0] and falling [1] edge, us
+    unsigned int sampleSpacing;   // Time between reads, us
+    byte sampleCount;             // Reads per bit, 1 reads on the edge
+
+    TextBuffer tempByte;    // Temp byte buffer for binToChar()
+    TextBuffer pInfo;       // Panel info buffer for pnlFormat()/pnlRaw()
+    TextBuffer kInfo;       // Keypad info buffer for kpdFormat()/kpdRaw()
+};
+
+/* A DSC with its clock and data pins fixed at compile time, for example...
+ *     DSCBus<4, 5> dsc;
+ * Its clock ISR and the sampling timer's data reads are specialised for those
+ * pins and the GPIO policy (DSC_Gpio.h), so each line read is a single register
+ * load, and they run from IRAM. Use it
+ * like a DSC, without setCLK()/setDTA_IN(). One instance per pin pair
+ */
+template <byte ClockPin, byte DataPin, class GpioPolicy = DSCGpio>
+class DSCBus : public DSC
+{
+  public:
+    DSCBus(void)
+      {
+        setCLK(ClockPin);
+        setDTA_IN(DataPin);
+        bus = this;
+        isrHandler = clkCalled_Fast;
+        dataReader = readData_Fast;
+      }
+
+  private:
+    static void DSC_IRAM clkCalled_Fast(void)
+      {
+        bool panel = GpioPolicy::read(ClockPin);
+        bus->clockEdge(panel, micros());
+        if (bus->deferSample(panel)) return;
+        bus->addBit(panel, GpioPolicy::read(DataPin));
+      }
+
+    static bool DSC_IRAM readData_Fast(void)
+      {
+        return GpioPolicy::read(DataPin);
+      }
+
+    static DSCBus *bus;
 };
 
+template <byte ClockPin, byte DataPin, class GpioPolicy>
+DSCBus<ClockPin, DataPin, GpioPolicy>* DSCBus<ClockPin, DataPin, GpioPolicy>::bus = NULL;
+
 #endif
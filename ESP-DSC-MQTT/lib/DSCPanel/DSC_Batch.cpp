@@ -0,0 +1,130 @@
+#include "Arduino.h"
+#include "DSC_Batch.h"
+#include <TimeLib.h>
+
+static inline byte field(const byte *word, byte offset, byte len)
+  {
+    // Returns "len" (1-8) bits of a packed word from bit "offset", as binToInt()
+    unsigned int v = (word[offset >> 3] << 8) | word[(offset >> 3) + 1];
+    return (v >> (16 - (offset & 7) - len)) & ((1 << len) - 1);
+  }
+
+static inline byte dataByte(const byte *word, byte n)
+  {
+    // Data byte "n" (1 = the byte after the command byte and separator bit)
+    return field(word, 9 + (n - 1) * 8, 8);
+  }
+
+static inline byte zoneGroup(byte cmd)
+  {
+    // Zone group of a zone word (0 = zones 1-8, 0x27), BATCH_NONE otherwise
+    // (sums of compares, which stay byte wide, rather than a chain of ||)
+    byte isZone = (cmd == 0x27) + (cmd == 0x2d) + (cmd == 0x34) + (cmd == 0x3e);
+    byte group = (cmd == 0x2d) + (cmd == 0x34) * 2 + (cmd == 0x3e) * 3;
+    return group | (byte)(isZone - 1);
+  }
+
+byte DSCBatch::pack(const char *bits, byte *word)
+  {
+    memset(word, 0, BATCH_BYTES);
+    byte len = 0;
+    for (;len<MAX_BITS && bits[len];len++) {
+      if (bits[len] == '1') word[len >> 3] |= 0x80 >> (len & 7);
+    }
+    return len;
+  }
+
+void DSCBatch::decode(const dscBatch_t &in, const dscColumns_t &out, size_t first, size_t count)
+  {
+    size_t end = first + count;
+    if (end > in.count) end = in.count;
+
+    // Local copies: a store through a byte pointer could change "in" or
+    // "out", and they would be read again for every frame
+    const byte *cmd = in.cmd;
+    const byte *bits = in.bits;
+    const byte (*words)[BATCH_BYTES] = in.words;
+
+    // Every field is read whatever the command byte, then kept or cleared
+    // with a mask, so the loops have no branches to stop them vectorising
+    if (out.valid) {
+      // Sums every data byte before the last full one and compares it to the
+      // last one, over all the bytes a word can have
+      byte *valid = out.valid;
+      for (size_t i=first;i<end;i++) {
+        const byte *w = words[i];
+        byte grps = ((byte)(bits[i] - 9) / 8) & -(byte)(bits[i] > 8);
+        byte sum = cmd[i], last = 0;
+        for (byte n=1;n<BATCH_BYTES - 1;n++) {
+          byte b = dataByte(w, n);
+          sum += b & -(byte)(n < grps);
+          last |= b & -(byte)(n == grps);
+        }
+        valid[i] = (grps > 0) & (sum == last);
+      }
+    }
+
+    if (out.lights) {
+      byte *lights = out.lights;
+      for (size_t i=first;i<end;i++) {
+        // Program is the top bit of the second data byte, see LIGHT_PROGRAM
+        byte l = (dataByte(words[i], 1) & ~LIGHT_PROGRAM) | ((dataByte(words[i], 2) >> 2) & LIGHT_PROGRAM);
+        lights[i] = l & -(byte)(cmd[i] == 0x05);
+      }
+    }
+
+    if (out.group) {
+      byte *group = out.group;
+      for (size_t i=first;i<end;i++) {
+        group[i] = zoneGroup(cmd[i]);
+      }
+    }
+
+    if (out.zones) {
+      byte *zones = out.zones;
+      for (size_t i=first;i<end;i++) {
+        zones[i] = dataByte(words[i], 5) & -(byte)(zoneGroup(cmd[i]) != BATCH_NONE);
+      }
+    }
+
+    if (out.armed) {
+      byte *armed = out.armed;
+      for (size_t i=first;i<end;i++) {
+        byte arm = (dataByte(words[i], 1) & LIGHT_ARMED) != 0;
+        armed[i] = cmd[i] == 0x05 ? arm : BATCH_NONE;
+      }
+    }
+
+    if (out.user) {
+      byte *user = out.user;
+      for (size_t i=first;i<end;i++) {
+        const byte *w = words[i];
+        byte arm = field(w, 41, 2);
+        byte code = field(w, 43, 6) - (0x19 & -(byte)(arm == 0x02)) + 1;   // 1-32, 33, 34
+        code += 5 & -(byte)(code > 34);                                    // System codes 40-42
+        code &= -(byte)(arm != 0);
+        user[i] = cmd[i] == 0xa5 ? code : BATCH_NONE;
+      }
+    }
+
+    if (out.panelTime) {
+      unsigned long *panelTime = out.panelTime;
+      for (size_t i=first;i<end;i++) {
+        const byte *w = words[i];
+        byte y3 = field(w, 9, 4);
+        byte y4 = field(w, 13, 4);
+        byte mm = field(w, 19, 4);
+        byte dd = field(w, 23, 5);
+        byte HH = field(w, 28, 5);
+        byte MM = field(w, 33, 6);
+        bool ok = (cmd[i] == 0xa5) & (y3 <= 9) & (y4 <= 9) & (mm >= 1) & (mm <= 12) & (dd >= 1) & (HH < 24) & (MM < 60);
+        unsigned long t = ((daysFromCivil(2000 + y3 * 10 + y4, mm, dd) * 24UL + HH) * 60 + MM) * 60;
+        panelTime[i] = ok ? t : 0;
+      }
+    }
+  }
+
+void DSCBatch::decode(const dscBatch_t &in, const dscColumns_t &out)
+  {
+    decode(in, out, 0, in.count);
+  }
@@ -0,0 +1,75 @@
+/* DSC_Batch.h
+ * Part of DSC Library
+ * See COPYRIGHT.txt and LICENSE.txt for more information.
+ *
+ * It contains the batch decoder, for frames decoded offline (traces, the
+ * journal, captures replayed on a PC) rather than one at a time by process().
+ * Frames are passed as a structure of arrays, one array per field, and the
+ * decoded fields come back the same way, one column per field:
+ *
+ *   In   cmd[i], bits[i], words[i][BATCH_BYTES]
+ *   Out  valid[i], lights[i], group[i], zones[i], armed[i], user[i], panelTime[i]
+ *
+ * Each column is filled by its own pass over the frames, with fixed bit
+ * offsets and no branches in the loop body, so a compiler can vectorise it.
+ * decode() only touches frames first to first+count-1 of every column, so a
+ * large batch can be split into ranges and decoded on several threads (or
+ * cores) at once, without any locking.
+ */
+
+#ifndef DSC_Batch_h
+#define DSC_Batch_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "DSC_Constants.h"
+
+const byte BATCH_BYTES = MAX_BITS / 8;  // Packed bytes per frame (128 bits)
+const byte BATCH_NONE = 0xff;           // group/armed/user of frames without that field
+
+/* A batch of panel frames. Each word is packed MSB first like dscSnapshot_t
+ * (bit 0 of the word is the top bit of byte 0), with the bits past its length
+ * set to 0, see DSCBatch::pack()
+ */
+typedef struct
+{
+  size_t count;                           // Frames in the batch
+  const byte *cmd;                        // Command byte of each frame
+  const byte *bits;                       // Length of each frame in bits
+  const byte (*words)[BATCH_BYTES];       // Packed frames
+}
+dscBatch_t;
+
+/* The decoded columns, one entry per frame. Any column left NULL is skipped
+ */
+typedef struct
+{
+  byte *valid;                            // 1 if the checksum matches (as pnlChkSum())
+  byte *lights;                           // Keypad lights of 0x05 (LIGHT_*, as pnlLights()), 0 otherwise
+  byte *group;                            // Zone group of 0x27/0x2d/0x34/0x3e (0 = zones 1-8)
+  byte *zones;                            // Open zones of that group (bit 0 = lowest zone)
+  byte *armed;                            // 1 armed, 0 disarmed, from the 0x05 Armed light (as state.armed)
+  byte *user;                             // Code that armed/disarmed, from 0xa5 (as armUser)
+  unsigned long *panelTime;               // Panel clock of 0xa5 in seconds since 1970, 0 otherwise
+}
+dscColumns_t;
+
+class DSCBatch
+{
+  public:
+    // Packs a word of '0'/'1' characters (e.g. dscFrame_t::pBits) into "word"
+    // (BATCH_BYTES bytes), returns its length in bits (at most MAX_BITS)
+    static byte pack(const char *bits, byte *word);
+
+    // Decodes frames "first" to "first" + "count" - 1 of "in" into the same
+    // entries of each column of "out"
+    static void decode(const dscBatch_t &in, const dscColumns_t &out, size_t first, size_t count);
+
+    // Decodes the whole batch
+    static void decode(const dscBatch_t &in, const dscColumns_t &out);
+};
+
+#endif
@@ -16,7 +16,72 @@
 const byte MAX_BITS = 128;        // The length at which to overflow (max 255)
 const byte WORD_BITS = 108;       // The expected length of a word (max 255)
 const int NEW_WORD_INTV = 5200;   // New word indicator interval in us (Microseconds)
+const byte INFO_LEN = 168;        // Formatted word buffer: prefix, bits, spaces, " (OK)"
 const byte ARR_SIZE = 12;         // (max 255)   // NOT USED
+const byte ZONE_GROUPS = 4;       // Zone bitmap bytes decoded, 0x27/0x2d/0x34/0x3e
+const byte MAX_BUSES = 4;         // Max DSC instances (keybuses) attached at once
+const byte FRAME_QUEUE = 4;       // Word queue slots between the ISR and process() (holds 3)
+
+// ----- Keypad Lights -----
+// Bits of the lights bitmap of DSC::pnlLights() and the batch lights column, in
+// the layout the 0x05 status decoder reads them: the first data byte, but for
+// Program, which is the top bit of the second
+const byte LIGHT_READY = 0x01;
+const byte LIGHT_ARMED = 0x02;
+const byte LIGHT_MEMORY = 0x04;
+const byte LIGHT_BYPASS = 0x08;
+const byte LIGHT_ERROR = 0x10;
+const byte LIGHT_PROGRAM = 0x20;  // Data byte 2, bit 7
+const byte LIGHT_FIRE = 0x40;
+const byte LIGHT_BACKLIGHT = 0x80;
+
+// ----- Panel Word Lengths -----
+// Expected length in bits of the panel words whose length is known: the command
+// byte, a 1 bit separator, then the data bytes (including the checksum, if any).
+// Words of other commands are closed by the new word gap (NEW_WORD_INTV). The
+// traffic census (DSC_Stats.h) reports min/max bits to check these against.
+const byte FRAME_BITS[][2] = {
+  {0x05, 41},   // Status: 4 data bytes, no checksum
+  {0x27, 57},   // Zones 1-8: 5 data bytes + checksum
+  {0x2d, 57},   // Zones 9-16
+  {0x34, 57},   // Zones 17-24
+  {0x3e, 57},   // Zones 25-32
+  {0x5d, 57},   // Alarm memory group 1: 5 data bytes + checksum
+  {0x63, 57},   // Alarm memory group 2
+  {0x64, 25},   // Beep command group 1: 2 data bytes + checksum
+  {0x69, 25},   // Beep command group 2
+  {0xa5, 65},   // Date/time/arm: 6 data bytes + checksum
+  {0xb1, 81},   // Zone configuration: 8 data bytes + checksum
+};
+
+// ----- Panel Commands -----
+// Command bytes decodePanel() decodes, and whether their words end with a
+// checksum byte (see pnlChkSum()). The traffic census counts a word as decoded
+// if its command is listed here, repeats included, and counts a checksum
+// failure only for the commands that carry one.
+const byte PANEL_CMDS[][2] = {
+  {0x05, 0},    // Status
+  {0x0a, 1},    // Status in programming
+  {0x11, 0},    // Keypad slot query
+  {0x27, 1},    // Zones 1-8
+  {0x2d, 1},    // Zones 9-16
+  {0x34, 1},    // Zones 17-24
+  {0x3e, 1},    // Zones 25-32
+  {0x39, 1},    // Undefined, passed on as hex
+  {0x5d, 1},    // Alarm memory group 1
+  {0x63, 1},    // Alarm memory group 2
+  {0x64, 1},    // Beep command group 1
+  {0x69, 1},    // Beep command group 2
+  {0xa5, 1},    // Date/time/arm
+  {0xb1, 1},    // Zone configuration
+};
+
+// ----- Warm Restart Snapshot -----
+// Command bytes whose last word is kept in the snapshot (see dscSnapshot_t), 
+// enough to rebuild the status, arm state, time and zones after a restart
+const byte SNAP_CMDS[] = {0x05, 0xa5, 0x27, 0x2d, 0x34, 0x3e};
+const byte SNAP_WORDS = sizeof(SNAP_CMDS);
+const byte SNAP_BYTES = 9;        // Packed bytes kept per word (72 bits)
 
 // ------ HEX LOOK-UP ARRAY ------
 const char hex[] = "0123456789abcdef";  // HEX alphanumerics look-up array
@@ -2,15 +2,18 @@
  * Part of DSC Library 
  * See COPYRIGHT.txt and LICENSE.txt for more information.
  *
- * It contains definition of global items which are used by the DSC class.
- * They have to be declared global in scope because they are accessed by
- * the ISR and you cannot pass parameters nor objects to an ISR routine.
+ * It contains the definition of the state shared between a DSC object and
+ * its ISR. Each DSC instance owns one of these; because you cannot pass
+ * parameters nor objects to an ISR routine, the ISR finds its instance
+ * through a small static trampoline table (see DSC.cpp).
  * 
  * In general, applications would not include this file. 
  */
 #ifndef DSC_Globals_h
 #define DSC_Globals_h
 #include <Arduino.h>
+#include "DSC_Constants.h"
+#include "DSC_Queue.h"
 
 /* Timing data is stored in a buffer by the receiver object. It is an array of
  * uint16_t that should be at least 100 entries as defined by this default below.
@@ -33,12 +36,6 @@
 #endif
  */
 
-// ----- Input/Output Pins -----
-extern byte CLK;         // Keybus Yellow (Clock Line)
-extern byte DTA_IN;      // Keybus Green (Data Line via V divider)
-extern byte DTA_OUT;     // Keybus Green Output (Data Line through driver)
-extern byte LED;         // LED pin on the arduino
-
 /*
 // Receiver states. This previously was enum but changed it to uint8_t
 // to guarantee it was a single atomic 8-bit value.
@@ -51,17 +48,65 @@ extern byte LED;         // LED pin on the arduino
 typedef uint8_t  currentState_t;
 */
 
-/* The structure contains information used by the ISR routine. Because we cannot
- * pass parameters to an ISR, vars must be global. Values which can be changed by
- * the ISR but are accessed outside the ISR must be volatile (for the most part)
+/* A complete keybus word as handed from the ISR to process(): the panel word and
+ * the keypad word sent during the same clock cycles, as '0'/'1' characters (a word
+ * of known length is closed at its last panel bit, so keypad bits clocked after
+ * it, before the gap, are not kept). The ISR builds the panel word in place in a
+ * queue slot, so nothing is copied or allocated while the clock line is serviced.
+ */
+typedef struct
+{
+  char pBits[MAX_BITS + 2];               // Panel word, null terminated
+  char kBits[MAX_BITS + 2];               // Keypad word, null terminated
+  byte pLen, kLen;                        // Lengths in bits
+  unsigned long end;                      // micros() of the last panel bit
+  unsigned long seq;                      // Frame sequence number, gaps are drops
+}
+dscFrame_t;
+
+/* The decoded state kept across a restart (e.g. in RTC memory): the last word
+ * of each command byte in SNAP_CMDS, packed MSB first, and the debounced zones.
+ * Its size is a multiple of 4 bytes, as RTC memory is written in 32-bit words.
+ */
+typedef struct
+{
+  byte bits[SNAP_WORDS];                  // Length of each word, 0 if none yet
+  byte words[SNAP_WORDS][SNAP_BYTES];
+  byte zones[ZONE_GROUPS];                // DSCZoneFilter::zones
+  unsigned long frameCount;               // Frames queued before the restart
+}
+dscSnapshot_t;
+
+/* The structure contains information used by the ISR routine. There is one per
+ * DSC instance (DSC::state), so several keybuses can be monitored at once. Values 
+ * which can be changed by the ISR but are accessed outside the ISR must be volatile
+ * (for the most part)
  */
  
 typedef struct 
 {  
   // ----- Keybus Word String Vars -----
-  String pBuild, pWord, oldPWord, pMsg;
-  String kBuild, kWord, oldKWord, kMsg;
+  String pWord, oldPWord, pMsg;
+  String kWord, oldKWord, kMsg;
   byte pCmd, kCmd;
+
+  // ----- Words in flight, modified within ISR -----
+  DSCQueue<dscFrame_t, FRAME_QUEUE> frames; // Complete words waiting for process()
+  dscFrame_t *pFrame;                     // Queue slot of the panel word being built, or NULL
+  char kBuild[MAX_BITS + 2];              // Keypad word being built
+  byte kLen;
+  volatile unsigned long overruns;        // Panel words dropped, the queue was full
+  volatile unsigned long edges;           // Clock edges seen, for DSCHealth
+  volatile unsigned long bitsSeen;        // Panel data bits seen, and how many were 1
+  volatile unsigned long onesSeen;
+  volatile unsigned long framingErrors;   // Panel words shorter than 8 bits or than their command's length
+  unsigned long frameCount;               // Frames queued so far, the next frame's seq
+  dscSnapshot_t snap;                     // Last words kept for a warm restart
+
+  // ----- Decoded Panel State -----
+  byte zones[ZONE_GROUPS];  // Open zone bitmaps of ZonesA-D (bit 0 = lowest zone)
+  byte armed;               // 1 armed, 0 disarmed, 0xff not yet known (0x05 Armed light)
+  byte armUser;             // User/system code of the last arm change, 0 if none (from 0xa5)
   
   // ----- Time Variables -----
   unsigned long lastStatus;
@@ -74,12 +119,21 @@ typedef struct
   volatile unsigned long lastFall;        // NOT USED
   
   volatile bool newWord;                  // NOT USED
-  
-  // ----- Byte Arrays -----
-  byte pBytes[];  // NOT USED
-  byte kBytes[];  // NOT USED
+
+  // ----- Framing, modified within ISR -----
+  volatile byte pExpect;                  // Expected bits of the word being built, 0 if unknown
+  volatile bool pSkip;                    // Ignore panel bits until the next new word gap
+  unsigned long frameEnd;                 // micros() of the last bit of pWord
+  unsigned long pickup;                   // micros() when process() picked the word up
+  unsigned long decoded;                  // micros() when process() finished decoding it
+  unsigned long frameSeq;                 // Sequence number of pWord (see dscFrame_t)
+
+  // ----- Data Line Sampling, modified within ISR -----
+  volatile byte sampleLeft;               // Reads still to take for the pending bit
+  volatile byte sampleOnes;               // Reads of the pending bit that were high
+  volatile bool samplePanel;              // The pending bit is panel (else keypad) data
+  volatile unsigned long sampleDue;       // micros() of the next read
 } 
-dscGlobal_t;
-extern  dscGlobal_t dscGlobal;  //declared in DSC.cpp
+dscState_t;
 
 #endif
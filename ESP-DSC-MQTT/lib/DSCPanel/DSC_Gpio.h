@@ -0,0 +1,67 @@
+/* DSC_Gpio.h
+ * Part of DSC Library
+ * See COPYRIGHT.txt and LICENSE.txt for more information.
+ *
+ * It contains the GPIO access policies used by the ISR to read the clock and
+ * data lines. A policy is a struct with a static read(pin) function:
+ *
+ *   DSCGpioArduino   digitalRead(), any Arduino core
+ *   DSCGpioEsp8266   a single load of the GPIO input register (GPI)
+ *   DSCGpioMock      pin levels set by the caller, for host builds and replays
+ *
+ * DSCGpio is the one used by default on the platform being built. With a pin
+ * known at compile time (see DSCBus in DSC.h) a read comes down to a register
+ * load and a mask.
+ *
+ * In general, applications would not include this file.
+ */
+
+#ifndef DSC_Gpio_h
+#define DSC_Gpio_h
+#include <Arduino.h>
+
+// Code called from the ISRs is kept in IRAM on the ESP8266, so a flash cache
+// miss (while WiFi is busy) cannot stall it
+#if defined(ESP8266)
+#define DSC_IRAM ICACHE_RAM_ATTR
+#else
+#define DSC_IRAM
+#endif
+
+struct DSCGpioArduino
+{
+  static inline bool read(byte pin) { return digitalRead(pin); }
+};
+
+#if defined(ESP8266)
+struct DSCGpioEsp8266
+{
+  // GPIO0-15 are in GPI, GPIO16 (RTC) has a register of its own
+  static inline bool read(byte pin) __attribute__((always_inline))
+    {
+      return (pin < 16) ? GPIP(pin) : (GP16I & 0x01);
+    }
+};
+#endif
+
+struct DSCGpioMock
+{
+  // Level of each pin, set by the test or replay driving the keybus
+  static inline bool &level(byte pin)
+    {
+      static bool levels[32];
+      return levels[pin & 31];
+    }
+
+  static inline bool read(byte pin) { return level(pin); }
+};
+
+#if defined(ESP8266)
+typedef DSCGpioEsp8266 DSCGpio;
+#elif defined(ARDUINO)
+typedef DSCGpioArduino DSCGpio;
+#else
+typedef DSCGpioMock DSCGpio;
+#endif
+
+#endif
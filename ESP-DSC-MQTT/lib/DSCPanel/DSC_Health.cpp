@@ -0,0 +1,111 @@
+#include "Arduino.h"
+#include "DSC_Health.h"
+
+DSCHealth::DSCHealth(void)
+  {
+    memset(edges, 0, sizeof(edges));
+    memset(bits, 0, sizeof(bits));
+    memset(ones, 0, sizeof(ones));
+    memset(framing, 0, sizeof(framing));
+    slot = 0;
+    filled = 0;
+    lastEdges = lastBits = lastOnes = lastFraming = 0;
+    tickAt = 0;
+    faults = 0;
+    stuckLevel = 0;
+    version = 0;
+    raised = 0;
+    edgeRate = 0;
+    framingRate = 0;
+    // A 1 kHz clock with a 15 ms gap between words gives ~1500-2000 edges/s
+    setLimits(50, 500, 4000, 5);
+  }
+
+void DSCHealth::setLimits(unsigned int clockMs, unsigned int minEdges, unsigned int maxEdges, unsigned int maxFraming)
+  {
+    clockUs = clockMs * 1000UL;
+    this->minEdges = minEdges;
+    this->maxEdges = maxEdges;
+    this->maxFraming = maxFraming;
+  }
+
+void DSCHealth::tick(const dscState_t &state)
+  {
+    // Counts since the last tick into the next slot, from copies of the ISR
+    // counters (each read once)
+    unsigned long e = state.edges, b = state.bitsSeen, o = state.onesSeen, f = state.framingErrors;
+    slot = (slot + 1) % HEALTH_SLOTS;
+    edges[slot] = min(e - lastEdges, 0xffffUL);
+    bits[slot] = min(b - lastBits, 255UL);
+    ones[slot] = min(o - lastOnes, (unsigned long)bits[slot]);
+    framing[slot] = min(f - lastFraming, 255UL);
+    lastEdges = e;
+    lastBits = b;
+    lastOnes = o;
+    lastFraming = f;
+    if (filled < HEALTH_SLOTS) filled++;
+  }
+
+bool DSCHealth::service(const dscState_t &state, unsigned long nowUs)
+  {
+    bool ticked = false;
+    while (nowUs - tickAt >= HEALTH_TICK_MS * 1000UL) {
+      tickAt += HEALTH_TICK_MS * 1000UL;
+      if (nowUs - tickAt >= HEALTH_TICK_MS * 1000UL * HEALTH_SLOTS) tickAt = nowUs;  // Loop stalled
+      tick(state);
+      ticked = true;
+    }
+
+    // Clock lost is checked on every call, the others on each tick
+    byte now = ticked ? 0 : (faults & ~HEALTH_CLOCK_LOST);
+    if ((long)(nowUs - state.lastChange) > (long)clockUs) now |= HEALTH_CLOCK_LOST;
+
+    if (ticked) {
+      // Fast window: enough panel bits, all of them the same
+      unsigned int b = 0, o = 0;
+      for (byte i=0;i<HEALTH_FAST;i++) {
+        byte s = (slot + HEALTH_SLOTS - i) % HEALTH_SLOTS;
+        b += bits[s];
+        o += ones[s];
+      }
+      if (b >= 32 && (o == 0 || o == b)) {
+        now |= HEALTH_DATA_STUCK;
+        stuckLevel = o ? 1 : 0;
+      }
+
+      // Slow window, once it is full
+      unsigned long e = 0, f = 0;
+      for (byte i=0;i<HEALTH_SLOTS;i++) {
+        e += edges[i];
+        f += framing[i];
+      }
+      edgeRate = e * 1000UL / (HEALTH_TICK_MS * HEALTH_SLOTS);
+      framingRate = f * 1000UL / (HEALTH_TICK_MS * HEALTH_SLOTS);
+      if (filled == HEALTH_SLOTS) {
+        if (!(now & HEALTH_CLOCK_LOST) && (edgeRate < minEdges || edgeRate > maxEdges)) now |= HEALTH_EDGE_RATE;
+        if (framingRate > maxFraming) now |= HEALTH_FRAMING;
+      }
+    }
+
+    if (now == faults) return false;
+    raised += __builtin_popcount(now & ~faults);
+    faults = now;
+    version++;
+    return true;
+  }
+
+byte DSCHealth::worst(void)
+  {
+    return faults & -faults;          // Lowest bit set, the highest priority
+  }
+
+const char *DSCHealth::name(byte fault)
+  {
+    switch (fault) {
+      case HEALTH_CLOCK_LOST: return "ClockLost";
+      case HEALTH_DATA_STUCK: return "DataStuck";
+      case HEALTH_EDGE_RATE:  return "EdgeRate";
+      case HEALTH_FRAMING:    return "Framing";
+    }
+    return "None";
+  }
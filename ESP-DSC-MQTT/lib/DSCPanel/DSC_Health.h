@@ -0,0 +1,83 @@
+/* DSC_Health.h
+ * Part of DSC Library
+ * See COPYRIGHT.txt and LICENSE.txt for more information.
+ *
+ * It contains the keybus health monitor. The ISR only counts clock edges,
+ * panel data bits (and how many were 1) and framing errors (words shorter
+ * than a command byte, or than their command's length); service() turns the
+ * counts into rates every HEALTH_TICK_MS over two sliding windows:
+ *
+ *   Fast (HEALTH_FAST ticks, 75 ms)   data line stuck low/high
+ *   Slow (HEALTH_SLOTS ticks, 1 s)    edge rate out of range, framing errors
+ *
+ * A lost clock is checked against the time of the last edge on every call,
+ * so with process() called every loop it is flagged within the clock limit
+ * (50 ms by default) of the last edge, a stuck data line within 100 ms and
+ * the rates within a tick of the slow window going over the limit.
+ */
+
+#ifndef DSC_Health_h
+#define DSC_Health_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "DSC_Globals.h"
+
+const byte HEALTH_TICK_MS = 25;   // Length of a window slot
+const byte HEALTH_SLOTS = 40;     // Slots in the slow window (1 s)
+const byte HEALTH_FAST = 3;       // Latest slots in the fast window (75 ms)
+
+// ----- Bus Faults, highest priority first -----
+const byte HEALTH_CLOCK_LOST = 0x01;  // No clock edge for the clock limit (cut/shorted clock)
+const byte HEALTH_DATA_STUCK = 0x02;  // Panel data all 0 or all 1 in the fast window
+const byte HEALTH_EDGE_RATE = 0x04;   // Clock edges per second out of range (noise, wrong bus)
+const byte HEALTH_FRAMING = 0x08;     // Framing errors per second over the limit
+
+class DSCHealth
+{
+  public:
+    DSCHealth(void);
+
+    // Sets the longest gap between clock edges (ms), the range of edges per
+    // second and the most framing errors per second before a fault is raised
+    void setLimits(unsigned int clockMs, unsigned int minEdges, unsigned int maxEdges, unsigned int maxFraming);
+
+    // Checks the counts of "state" (edges, bits, framing errors), "nowUs" is
+    // micros(). Called by DSC::process() on every loop
+    // Returns true if the faults changed
+    bool service(const dscState_t &state, unsigned long nowUs);
+
+    // Highest priority fault raised (HEALTH_CLOCK_LOST ...), 0 if none
+    byte worst(void);
+
+    // Name of a fault, e.g. "ClockLost"
+    static const char *name(byte fault);
+
+    byte faults;                      // Faults raised now, HEALTH_* bits
+    byte stuckLevel;                  // Level of the data line while HEALTH_DATA_STUCK
+    unsigned long version;            // Incremented whenever faults change
+    unsigned long raised;             // Faults raised since boot
+    unsigned int edgeRate;            // Clock edges per second, slow window
+    unsigned int framingRate;         // Framing errors per second, slow window
+
+  private:
+    void tick(const dscState_t &state);
+
+    unsigned int clockUs;             // Clock limit, us
+    unsigned int minEdges, maxEdges, maxFraming;
+
+    // Counts per slot, and the ISR counters they were taken from
+    unsigned int edges[HEALTH_SLOTS];
+    byte bits[HEALTH_SLOTS];
+    byte ones[HEALTH_SLOTS];
+    byte framing[HEALTH_SLOTS];
+    byte slot;
+    byte filled;                      // Slots holding counts, up to HEALTH_SLOTS
+    unsigned long lastEdges, lastBits, lastOnes, lastFraming;
+    unsigned long tickAt;             // micros() of the last tick
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "Arduino.h"
+#include "DSC_Keys.h"
+
+// Keys of the 2nd byte after kOut, and the character that stands for them
+typedef struct
+{
+  byte code;
+  char key;
+}
+keyChar_t;
+
+static const keyChar_t keyChars[] = {
+  {zero, '0'}, {one, '1'}, {two, '2'}, {three, '3'}, {four, '4'},
+  {five, '5'}, {six, '6'}, {seven, '7'}, {eight, '8'}, {nine, '9'},
+  {aster, '*'}, {pound, '#'}, {stay, 'S'}, {away, 'A'}, {chime, 'C'},
+  {reset, 'R'}, {kExit, 'E'}, {lArrow, '<'}, {rArrow, '>'}
+};
+
+// Installer's manual names of the * functions, by digit
+static const char *starNames[] = {
+  "QuickArm", "Bypass", "Troubles", "AlarmMemory", "ChimeToggle",
+  "UserCodes", "UserFunctions", "Outputs", "Installer", "ArmNoEntryDelay"
+};
+
+DSCKeySequence::DSCKeySequence(void)
+  {
+    memset(&seq, 0, sizeof(seq));
+    first = 0;
+    count = 0;
+    keys = 0;
+    actions = 0;
+    lost = 0;
+    lastAlarm = 0;
+    lastAlarmAt = 0;
+    setTimeout(4000);
+  }
+
+void DSCKeySequence::setTimeout(unsigned int ms)
+  {
+    timeout = ms;
+  }
+
+void DSCKeySequence::feed(byte kCmd, byte kByte2, unsigned long now)
+  {
+    char key = 0;
+    if (kCmd == fire) key = 'F';
+    else if (kCmd == aux) key = 'U';
+    else if (kCmd == panic) key = 'P';
+    else if (kCmd == kOut) {
+      for (byte i=0;i<sizeof(keyChars)/sizeof(keyChars[0]);i++) {
+        if (keyChars[i].code == kByte2) key = keyChars[i].key;
+      }
+    }
+    if (!key) return;                 // Keypad response or unknown
+    service(now);
+
+    // Alarm keys are actions of their own, the repeat of one is dropped
+    if (key == 'F' || key == 'U' || key == 'P') {
+      if (key == lastAlarm && now - lastAlarmAt < timeout) return;
+      lastAlarm = key;
+      lastAlarmAt = now;
+      keys++;
+      if (seq.len) finish(false);
+      add(key, now);
+      finish(false);
+      return;
+    }
+
+    keys++;
+    if (seq.len == KEY_SEQ_LEN) finish(false);
+    add(key, now);
+    if (key == '#' || strchr("SACRE", key)) finish(false);
+  }
+
+void DSCKeySequence::add(char key, unsigned long now)
+  {
+    if (!seq.len) seq.start = now;
+    seq.end = now;
+    if (key >= '0' && key <= '9') {
+      // The digit choosing a * function is kept, every other one is masked
+      if (seq.len == 1 && seq.keys[0] == '*') seq.star = key;
+      else {
+        key = 'x';
+        seq.digits++;
+      }
+    }
+    else if (!(key == '*' || key == '#' || key == '<' || key == '>')) seq.last = key;
+    seq.keys[seq.len++] = key;
+    seq.keys[seq.len] = 0;
+  }
+
+void DSCKeySequence::service(unsigned long now)
+  {
+    if (seq.len && now - seq.end >= timeout) finish(true);
+  }
+
+void DSCKeySequence::finish(bool timedOut)
+  {
+    seq.timedOut = timedOut;
+    if (count == KEY_ACTIONS) {
+      first = (first + 1) % KEY_ACTIONS;   // Drop the oldest
+      count--;
+      lost++;
+    }
+    done[(first + count) % KEY_ACTIONS] = seq;
+    count++;
+    actions++;
+    memset(&seq, 0, sizeof(seq));
+  }
+
+bool DSCKeySequence::next(dscKeyAction_t &action)
+  {
+    if (!count) return false;
+    action = done[first];
+    first = (first + 1) % KEY_ACTIONS;
+    count--;
+    return true;
+  }
+
+const char *DSCKeySequence::name(const dscKeyAction_t &action)
+  {
+    switch (action.last) {
+      case 'S': return "Stay";
+      case 'A': return "Away";
+      case 'C': return "Chime";
+      case 'R': return "Reset";
+      case 'E': return "Exit";
+      case 'F': return "Fire";
+      case 'U': return "Auxiliary";
+      case 'P': return "Panic";
+    }
+    if (action.star) return starNames[action.star - '0'];
+    if (action.digits) return "Code";
+    return "Keys";
+  }
@@ -0,0 +1,83 @@
+/* DSC_Keys.h
+ * Part of DSC Library
+ * See COPYRIGHT.txt and LICENSE.txt for more information.
+ *
+ * It contains the keypad sequence assembler, which groups the single key
+ * words decoded by decodeKeypad() into one action per thing the user did,
+ * for example...
+ *
+ *   1 2 3 4 Away       "Away" with a 4 digit code, keys "xxxxA"
+ *   * 8 5 5 5 5        "Installer", keys "*8xxxx"
+ *   Stay               "Stay", keys "S"
+ *   Panic (x2)         "Panic", keys "P"
+ *
+ * A sequence ends with #, a function key (Stay, Away, Chime, Reset, Exit),
+ * or when no key follows within the timeout. Fire, Auxiliary and Panic are
+ * actions of their own. Every digit is masked as 'x', except the one after a
+ * '*' that selects a function, so codes never leave the assembler.
+ */
+
+#ifndef DSC_Keys_h
+#define DSC_Keys_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "DSC_Constants.h"
+
+const byte KEY_SEQ_LEN = 24;      // Keys held per action, a longer sequence is split
+const byte KEY_ACTIONS = 4;       // Finished actions waiting for next()
+
+typedef struct
+{
+  char keys[KEY_SEQ_LEN + 1];     // Masked keys: x (digit), * # S A C R E < > F U P
+  byte len;                       // Keys in "keys"
+  byte digits;                    // Digits masked
+  char star;                      // Digit after the leading '*' ('0'-'9'), 0 if none
+  char last;                      // Function or alarm key that ended it, 0 if none
+  bool timedOut;                  // Ended by the timeout rather than a key
+  unsigned long start;            // millis() of the first key
+  unsigned long end;              // millis() of the last key
+}
+dscKeyAction_t;
+
+class DSCKeySequence
+{
+  public:
+    DSCKeySequence(void);
+
+    // Sets the longest gap between two keys of one action (ms)
+    void setTimeout(unsigned int ms);
+
+    // Feeds a decoded keypad word: its command byte (kOut, fire, aux or panic)
+    // and 2nd byte. Words that are not a key are ignored
+    void feed(byte kCmd, byte kByte2, unsigned long now);
+
+    // Ends the sequence once the timeout has passed. Called by DSC::process()
+    void service(unsigned long now);
+
+    // Takes the oldest finished action, returns false if there is none
+    bool next(dscKeyAction_t &action);
+
+    // Name of an action, e.g. "Away", "Installer", "Code" or "Keys"
+    static const char *name(const dscKeyAction_t &action);
+
+    unsigned long keys;           // Keys fed since boot
+    unsigned long actions;        // Actions finished since boot
+    unsigned long lost;           // Actions dropped because next() was not called
+
+  private:
+    void add(char key, unsigned long now);
+    void finish(bool timedOut);
+
+    dscKeyAction_t seq;           // Sequence being assembled
+    dscKeyAction_t done[KEY_ACTIONS];
+    byte first, count;
+    unsigned int timeout;
+    char lastAlarm;               // Alarm keys are sent twice, see DSC_Constants.h
+    unsigned long lastAlarmAt;
+};
+
+#endif
@@ -0,0 +1,73 @@
+/* DSC_Queue.h
+ * Part of DSC Library
+ * See COPYRIGHT.txt and LICENSE.txt for more information.
+ *
+ * It contains a fixed-size, lock-free, single producer/single consumer queue.
+ * The producer (an ISR, or a reader thread on a host) fills the slot returned
+ * by reserve() in place and publishes it with push(); the consumer reads the
+ * slot returned by front() in place and releases it with pop(). Nothing is
+ * copied or allocated, and neither side ever waits on the other.
+ *
+ * The indices are loaded and stored with acquire/release ordering, so the
+ * queue is also safe between two threads on a multi-core host. It holds at
+ * most N - 1 items.
+ */
+
+#ifndef DSC_Queue_h
+#define DSC_Queue_h
+
+template <typename T, unsigned char N>
+class DSCQueue
+{
+  public:
+    DSCQueue(void) : head(0), tail(0) {}
+
+    // ----- Producer side -----
+    // Returns the slot to fill next, or NULL if the queue is full
+    T* reserve(void)
+      {
+        unsigned char t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        if (next(t) == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) return NULL;
+        return &items[t];
+      }
+
+    // Publishes the slot returned by reserve() to the consumer
+    void push(void)
+      {
+        unsigned char t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        __atomic_store_n(&tail, next(t), __ATOMIC_RELEASE);
+      }
+
+    // ----- Consumer side -----
+    // Returns the oldest published slot, or NULL if the queue is empty
+    T* front(void)
+      {
+        unsigned char h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        if (h == __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) return NULL;
+        return &items[h];
+      }
+
+    // Releases the slot returned by front() back to the producer
+    void pop(void)
+      {
+        unsigned char h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        __atomic_store_n(&head, next(h), __ATOMIC_RELEASE);
+      }
+
+    // Returns the number of published slots (a snapshot, from either side)
+    unsigned char size(void)
+      {
+        unsigned char h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        unsigned char t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+        return (t + N - h) % N;
+      }
+
+  private:
+    static unsigned char next(unsigned char i) { return (i + 1) % N; }
+
+    T items[N];
+    volatile unsigned char head;    // Next slot to consume, written by the consumer
+    volatile unsigned char tail;    // Next slot to fill, written by the producer
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "Arduino.h"
+#include "DSC_Rules.h"
+#include "DSC.h"
+
+// Key names of the rule text form, and their codes
+typedef struct
+{
+  const char *name;
+  byte code;
+  bool alarm;                     // Sent in the 1st byte (fire/aux/panic)
+}
+ruleKey_t;
+
+static const ruleKey_t ruleKeys[] = {
+  {"0", zero, false}, {"1", one, false}, {"2", two, false}, {"3", three, false},
+  {"4", four, false}, {"5", five, false}, {"6", six, false}, {"7", seven, false},
+  {"8", eight, false}, {"9", nine, false}, {"*", aster, false}, {"#", pound, false},
+  {"stay", stay, false}, {"away", away, false}, {"chime", chime, false},
+  {"reset", reset, false}, {"exit", kExit, false},
+  {"fire", fire, true}, {"aux", aux, true}, {"panic", panic, true}
+};
+
+// Copies the next space separated word of "spec" into "tok", returns false
+// at the end of the text
+static bool nextToken(const char *&spec, char *tok, byte size)
+  {
+    while (*spec == ' ') spec++;
+    if (!*spec) return false;
+    byte n = 0;
+    while (*spec && *spec != ' ') {
+      if (n < size - 1) tok[n++] = *spec;
+      spec++;
+    }
+    tok[n] = 0;
+    return true;
+  }
+
+// Parses a decimal number, returns false if "tok" is not one
+static bool toNumber(const char *tok, unsigned long &value)
+  {
+    if (!*tok) return false;
+    value = 0;
+    for (;*tok;tok++) {
+      if (*tok < '0' || *tok > '9') return false;
+      value = value * 10 + (*tok - '0');
+    }
+    return true;
+  }
+
+DSCRules::DSCRules(void)
+  {
+    publish = NULL;
+    clear();
+  }
+
+void DSCRules::clear(void)
+  {
+    used = 0;
+    fired = 0;
+    memset(prevZones, 0, sizeof(prevZones));
+    prevKnown = 0;
+    prevArmed = 0xff;
+    lastAlarm = 0;
+    lastAlarmAt = 0;
+  }
+
+void DSCRules::setPublish(void (*callback)(const dscRule_t &rule))
+  {
+    publish = callback;
+  }
+
+int DSCRules::add(const char *spec)
+  {
+    if (used >= RULE_SLOTS) return 0;        // return failure, table full
+    dscRule_t r;
+    memset(&r, 0, sizeof(r));
+    char tok[8];
+    unsigned long n;
+
+    // ----- Event -----
+    if (!nextToken(spec, tok, sizeof(tok))) return 0;
+    if (!strcmp(tok, "open") || !strcmp(tok, "close")) {
+      r.event = (tok[0] == 'o') ? RULE_OPEN : RULE_CLOSE;
+      if (!nextToken(spec, tok, sizeof(tok)) || !toNumber(tok, n)) return 0;
+      if (n < 1 || n > ZONE_GROUPS * 8) return 0;
+      r.arg = n;
+    }
+    else if (!strcmp(tok, "key")) {
+      if (!nextToken(spec, tok, sizeof(tok))) return 0;
+      for (byte i=0;i<sizeof(ruleKeys)/sizeof(ruleKeys[0]);i++) {
+        if (strcmp(tok, ruleKeys[i].name)) continue;
+        r.event = ruleKeys[i].alarm ? RULE_ALARM_KEY : RULE_KEY;
+        r.arg = ruleKeys[i].code;
+      }
+      if (!r.event) return 0;
+    }
+    else if (!strcmp(tok, "arm")) r.event = RULE_ARM;
+    else if (!strcmp(tok, "disarm")) r.event = RULE_DISARM;
+    else return 0;
+
+    // ----- Condition (optional) and the ">" -----
+    if (!nextToken(spec, tok, sizeof(tok))) return 0;
+    if (!strcmp(tok, "armed")) r.condition = RULE_IF_ARMED;
+    else if (!strcmp(tok, "disarmed")) r.condition = RULE_IF_DISARMED;
+    if (r.condition && !nextToken(spec, tok, sizeof(tok))) return 0;
+    if (strcmp(tok, ">")) return 0;
+
+    // ----- Action -----
+    if (!nextToken(spec, tok, sizeof(tok))) return 0;
+    if (!strcmp(tok, "on")) r.action = RULE_GPIO_ON;
+    else if (!strcmp(tok, "off")) r.action = RULE_GPIO_OFF;
+    else if (!strcmp(tok, "pulse")) r.action = RULE_GPIO_PULSE;
+    else if (!strcmp(tok, "publish")) r.action = RULE_PUBLISH;
+    else return 0;
+    if (!nextToken(spec, tok, sizeof(tok)) || !toNumber(tok, n) || n > 255) return 0;
+    r.target = n;
+    if (r.action == RULE_GPIO_PULSE) {
+      if (!nextToken(spec, tok, sizeof(tok)) || !toNumber(tok, n) || n > 65535) return 0;
+      r.ms = n;
+    }
+    if (nextToken(spec, tok, sizeof(tok))) return 0;   // trailing words
+
+    if (r.action != RULE_PUBLISH) pinMode(r.target, OUTPUT);
+    rules[used] = r;
+    pulsing[used] = false;
+    used++;
+    return 1;                                 // return success
+  }
+
+int DSCRules::evaluate(const byte *zones, byte known, byte armed, byte kCmd, byte kKey, unsigned long now)
+  {
+    // What changed since the last call, worked out once for all of the rules.
+    // A group seen for the first time only seeds prevZones: its open zones
+    // were open before, they did not just open
+    byte opened[ZONE_GROUPS], closed[ZONE_GROUPS];
+    for (byte g=0;g<ZONE_GROUPS;g++) {
+      opened[g] = closed[g] = 0;
+      if (!(known & (1 << g))) continue;
+      if (prevKnown & (1 << g)) {
+        opened[g] = zones[g] & ~prevZones[g];
+        closed[g] = ~zones[g] & prevZones[g];
+      }
+      prevZones[g] = zones[g];
+    }
+    prevKnown = known;
+    bool armedNow = (armed == 1) && (prevArmed == 0);
+    bool disarmedNow = (armed == 0) && (prevArmed == 1);
+    if (armed != 0xff) prevArmed = armed;
+
+    // Alarm keys are sent twice, the repeat of one is dropped
+    byte alarmKey = 0;
+    if (kCmd == fire || kCmd == aux || kCmd == panic) {
+      if (kCmd != lastAlarm || now - lastAlarmAt >= RULE_REPEAT_MS) {
+        alarmKey = kCmd;
+        lastAlarm = kCmd;
+        lastAlarmAt = now;
+      }
+    }
+
+    int count = 0;
+    for (byte i=0;i<used;i++) {
+      const dscRule_t &r = rules[i];
+
+      // End a pulse that is due
+      if (pulsing[i] && (long)(now - pulseEnd[i]) >= 0) {
+        digitalWrite(r.target, LOW);
+        pulsing[i] = false;
+      }
+
+      bool match = false;
+      byte z = r.arg - 1;
+      switch (r.event) {
+        case RULE_OPEN:      match = opened[z / 8] & (1 << (z % 8)); break;
+        case RULE_CLOSE:     match = closed[z / 8] & (1 << (z % 8)); break;
+        case RULE_KEY:       match = (kCmd == kOut) && (kKey == r.arg); break;
+        case RULE_ALARM_KEY: match = (alarmKey == r.arg); break;
+        case RULE_ARM:       match = armedNow; break;
+        case RULE_DISARM:    match = disarmedNow; break;
+      }
+      if (!match) continue;
+      if (r.condition == RULE_IF_ARMED && armed != 1) continue;
+      if (r.condition == RULE_IF_DISARMED && armed != 0) continue;
+
+      act(i, now);
+      count++;
+    }
+    fired += count;
+    return count;
+  }
+
+int DSCRules::evaluate(DSC &dsc, unsigned long now)
+  {
+    byte kKey = dsc.state.kCmd ? dsc.binToInt(dsc.state.kWord, 8, 8) : 0;
+    return evaluate(dsc.zoneFilter.zones, dsc.zoneFilter.known, dsc.state.armed, dsc.state.kCmd, kKey, now);
+  }
+
+void DSCRules::act(byte i, unsigned long now)
+  {
+    const dscRule_t &r = rules[i];
+    switch (r.action) {
+      case RULE_GPIO_ON:
+        digitalWrite(r.target, HIGH);
+        break;
+      case RULE_GPIO_OFF:
+        digitalWrite(r.target, LOW);
+        break;
+      case RULE_GPIO_PULSE:
+        digitalWrite(r.target, HIGH);
+        pulseEnd[i] = now + r.ms;
+        pulsing[i] = true;
+        break;
+      case RULE_PUBLISH:
+        if (publish) publish(r);
+        break;
+    }
+  }
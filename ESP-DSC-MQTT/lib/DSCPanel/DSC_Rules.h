@@ -0,0 +1,113 @@
+/* DSC_Rules.h
+ * Part of DSC Library
+ * See COPYRIGHT.txt and LICENSE.txt for more information.
+ *
+ * It contains a small rule engine for reacting to the keybus on the device
+ * itself, without a round trip through the broker. Rules are compiled once
+ * from a short text form into a fixed table, for example...
+ *
+ *   "open 3 armed > pulse 14 2000"   zone 3 opens while armed: GPIO14 high for 2 s
+ *   "key panic > publish 1"          panic key: call the publish callback with 1
+ *   "disarm > off 14"                panel disarmed: GPIO14 low
+ *
+ *   Events:      open <zone>, close <zone>, key <name>, arm, disarm
+ *   Conditions:  armed, disarmed (optional, after the event)
+ *   Actions:     on <pin>, off <pin>, pulse <pin> <ms>, publish <id>
+ *   Key names:   0-9 * # stay away chime reset exit fire aux panic
+ *
+ * evaluate() runs every rule once per call, so its time is bounded by
+ * RULE_SLOTS whatever the traffic. Zone events use the debounced zones of
+ * the zone filter (DSC_Zones.h), and only fire on a change: the first state
+ * of a zone group seen (after boot, or preset from a restart) is taken as it
+ * is. The keypad sends fire/aux/panic twice, a repeat within RULE_REPEAT_MS
+ * is dropped as DSCKeySequence does.
+ */
+
+#ifndef DSC_Rules_h
+#define DSC_Rules_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "DSC_Constants.h"
+
+class DSC;
+
+const byte RULE_SLOTS = 16;       // Rules held (max 255)
+const unsigned int RULE_REPEAT_MS = 4000;   // Alarm key repeats dropped within
+
+// ----- Rule Events -----
+const byte RULE_OPEN = 1;         // Zone "arg" opens
+const byte RULE_CLOSE = 2;        // Zone "arg" closes
+const byte RULE_KEY = 3;          // Keypad button "arg" (2nd byte after kOut)
+const byte RULE_ALARM_KEY = 4;    // Keypad fire/aux/panic key "arg" (1st byte)
+const byte RULE_ARM = 5;          // Panel armed
+const byte RULE_DISARM = 6;       // Panel disarmed
+
+// ----- Rule Conditions -----
+const byte RULE_ALWAYS = 0;
+const byte RULE_IF_ARMED = 1;
+const byte RULE_IF_DISARMED = 2;
+
+// ----- Rule Actions -----
+const byte RULE_GPIO_ON = 1;      // Sets pin "target" high
+const byte RULE_GPIO_OFF = 2;     // Sets pin "target" low
+const byte RULE_GPIO_PULSE = 3;   // Sets pin "target" high for "ms"
+const byte RULE_PUBLISH = 4;      // Calls the publish callback with "target"
+
+typedef struct
+{
+  byte event;                     // RULE_OPEN ... RULE_DISARM
+  byte arg;                       // Zone number or key code
+  byte condition;                 // RULE_ALWAYS, RULE_IF_ARMED, RULE_IF_DISARMED
+  byte action;                    // RULE_GPIO_ON ... RULE_PUBLISH
+  byte target;                    // GPIO pin or publish id
+  unsigned int ms;                // Pulse length
+}
+dscRule_t;
+
+class DSCRules
+{
+  public:
+    DSCRules(void);
+
+    // Compiles a rule from its text form (see above) and adds it to the table
+    // Returns 1 for success, 0 if it does not parse or the table is full
+    int add(const char *spec);
+
+    // Removes all of the rules
+    void clear(void);
+
+    // Sets the function called by publish actions, with the rule that fired
+    void setPublish(void (*callback)(const dscRule_t &rule));
+
+    // Fires the rules matching what changed since the last call: the zone
+    // bitmaps (of the groups set in "known"), armed state (1, 0 or 0xff unknown)
+    // and keypad word decoded by the last process() (kCmd 0 if none). Also ends
+    // pulses that are due. Returns the number of rules fired
+    int evaluate(const byte *zones, byte known, byte armed, byte kCmd, byte kKey, unsigned long now);
+
+    // Same, taking the state from a DSC after its process()
+    int evaluate(DSC &dsc, unsigned long now);
+
+    byte used;                    // Rules in the table
+    unsigned long fired;          // Rules fired since boot
+
+  private:
+    void act(byte i, unsigned long now);
+
+    dscRule_t rules[RULE_SLOTS];
+    unsigned long pulseEnd[RULE_SLOTS];   // millis() a pulse ends
+    bool pulsing[RULE_SLOTS];             // The rule's pulse is running
+    void (*publish)(const dscRule_t &rule);
+
+    byte prevZones[ZONE_GROUPS];
+    byte prevKnown;                       // Groups in prevZones
+    byte prevArmed;
+    byte lastAlarm;                       // Alarm key last acted on, and when
+    unsigned long lastAlarmAt;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "Arduino.h"
+#include "DSC_Stats.h"
+#include "DSC_Constants.h"
+
+DSCStats::DSCStats(void)
+  {
+    clear();
+  }
+
+void DSCStats::clear(void)
+  {
+    memset(slots, 0, sizeof(slots));
+    used = 0;
+    other = 0;
+  }
+
+void DSCStats::record(byte cmd, int bits, bool decoded, bool chkOk)
+  {
+    if (bits > 255) bits = 255;
+
+    // Find the slot of this command byte, or claim the next free one
+    dscCmdStat_t *s = NULL;
+    for (byte i=0;i<used;i++) {
+      if (slots[i].cmd == cmd) {
+        s = &slots[i];
+        break;
+      }
+    }
+    if (!s) {
+      if (used >= STAT_SLOTS) {
+        other++;                  // Table full, count it and move on
+        return;
+      }
+      s = &slots[used++];
+      s->cmd = cmd;
+      s->minBits = bits;
+      s->maxBits = bits;
+    }
+
+    s->seen++;
+    if (decoded) s->decoded++;
+    if (!chkOk) s->chkFail++;
+    if (bits < s->minBits) s->minBits = bits;
+    if (bits > s->maxBits) s->maxBits = bits;
+    s->lastSeen = millis();
+  }
+
+const dscCmdStat_t* DSCStats::find(byte cmd)
+  {
+    for (byte i=0;i<used;i++) {
+      if (slots[i].cmd == cmd) return &slots[i];
+    }
+    return NULL;
+  }
+
+size_t DSCStats::printDigest(Print &out)
+  {
+    size_t n = 0;
+    unsigned long now = millis();
+
+    n += out.print('{');
+    for (byte i=0;i<used;i++) {
+      dscCmdStat_t &s = slots[i];
+      n += out.print('"');
+      n += out.print(hex[s.cmd >> 4]);
+      n += out.print(hex[s.cmd & 0x0f]);
+      n += out.print("\":[");
+      n += out.print(s.seen);
+      n += out.print(',');
+      n += out.print(s.decoded);
+      n += out.print(',');
+      n += out.print(s.chkFail);
+      n += out.print(',');
+      n += out.print(s.minBits);
+      n += out.print(',');
+      n += out.print(s.maxBits);
+      n += out.print(',');
+      n += out.print(now - s.lastSeen);
+      n += out.print("],");
+    }
+    n += out.print("\"Other\":");
+    n += out.print(other);
+    n += out.print('}');
+    return n;
+  }
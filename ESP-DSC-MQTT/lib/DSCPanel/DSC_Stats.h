@@ -0,0 +1,63 @@
+/* DSC_Stats.h
+ * Part of DSC Library
+ * See COPYRIGHT.txt and LICENSE.txt for more information.
+ *
+ * It contains a constant-memory census of keybus traffic, one table for the
+ * panel and one for the keypad command bytes. Each command byte seen gets a
+ * slot counting the frames seen and decoded, checksum failures, the min/max
+ * bit length and the last time it was seen. Once all STAT_SLOTS slots are in
+ * use, frames of further command bytes are only counted as "Other".
+ */
+
+#ifndef DSC_Stats_h
+#define DSC_Stats_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+const byte STAT_SLOTS = 24;       // Command bytes tracked per table (max 255)
+
+typedef struct
+{
+  byte cmd;                       // Command byte of this slot
+  byte minBits, maxBits;          // Shortest and longest frame seen, in bits
+  unsigned long seen;             // Frames seen, including repeats
+  unsigned long decoded;          // Frames of a command the decoder knows,
+                                  //   repeats included
+  unsigned long chkFail;          // Frames failing their checksum (only counted
+                                  //   for commands that carry one, not e.g. 0x05)
+  unsigned long lastSeen;         // millis() of the last frame
+}
+dscCmdStat_t;
+
+class DSCStats
+{
+  public:
+    DSCStats(void);
+
+    // Counts one frame of command byte "cmd", "bits" long. "decoded" if the
+    // decoder knows the command, "chkOk" unless it carries a checksum that fails
+    void record(byte cmd, int bits, bool decoded, bool chkOk);
+
+    // Zeros all of the counters and frees all of the slots
+    void clear(void);
+
+    // Prints a compact JSON object of the table to "out", in the form:
+    //   {"05":[seen,decoded,chkFail,minBits,maxBits,msSinceLastSeen],...,"Other":n}
+    // Returns the number of bytes printed
+    size_t printDigest(Print &out);
+
+    // Returns the slot of command byte "cmd", or NULL if it is not tracked
+    const dscCmdStat_t* find(byte cmd);
+
+    byte used;                    // Slots in use
+    unsigned long other;          // Frames of command bytes without a slot
+
+  private:
+    dscCmdStat_t slots[STAT_SLOTS];
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include "Arduino.h"
+#include "DSC_Trace.h"
+
+DSCHistogram::DSCHistogram(void)
+  {
+    clear();
+  }
+
+void DSCHistogram::clear(void)
+  {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    max = 0;
+  }
+
+void DSCHistogram::record(unsigned long us)
+  {
+    // Bucket from the position of the highest bit set, no division or loop
+    byte i = 0;
+    if (us >= 64) {
+      i = (sizeof(unsigned long) * 8 - 1 - __builtin_clzl(us)) - 5;
+      if (i >= TRACE_BUCKETS) i = TRACE_BUCKETS - 1;
+    }
+    buckets[i]++;
+    count++;
+    if (us > max) max = us;
+  }
+
+size_t DSCHistogram::printJson(Print &out)
+  {
+    size_t n = 0;
+    n += out.print("{\"Count\":");
+    n += out.print(count);
+    n += out.print(",\"Max\":");
+    n += out.print(max);
+    n += out.print(",\"Buckets\":[");
+    for (byte i=0;i<TRACE_BUCKETS;i++) {
+      if (i) n += out.print(',');
+      n += out.print(buckets[i]);
+    }
+    n += out.print("]}");
+    return n;
+  }
@@ -0,0 +1,44 @@
+/* DSC_Trace.h
+ * Part of DSC Library
+ * See COPYRIGHT.txt and LICENSE.txt for more information.
+ *
+ * It contains a constant-memory latency histogram, for tracing how long a
+ * keybus word takes through each stage of the pipeline (ISR, process(),
+ * decoding, publishing, broker ack). The buckets are fixed powers of two:
+ * bucket 0 counts latencies under 64 us, bucket i under 2^(i+6) us, and the
+ * last one everything longer (over about 1 s).
+ */
+
+#ifndef DSC_Trace_h
+#define DSC_Trace_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+const byte TRACE_BUCKETS = 16;    // Histogram buckets, the last one is open ended
+
+class DSCHistogram
+{
+  public:
+    DSCHistogram(void);
+
+    // Counts one latency of "us" microseconds
+    void record(unsigned long us);
+
+    // Zeros all of the buckets
+    void clear(void);
+
+    // Prints a compact JSON object of the histogram to "out", in the form:
+    //   {"Count":n,"Max":us,"Buckets":[b0,b1,...]}
+    // Returns the number of bytes printed
+    size_t printJson(Print &out);
+
+    unsigned long count;          // Latencies counted
+    unsigned long max;            // Longest latency, us
+    unsigned long buckets[TRACE_BUCKETS];
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "Arduino.h"
+#include "DSC_Zones.h"
+
+DSCZoneFilter::DSCZoneFilter(void)
+  {
+    memset(zones, 0, sizeof(zones));
+    memset(chatter, 0, sizeof(chatter));
+    memset(raw, 0, sizeof(raw));
+    memset(since, 0, sizeof(since));
+    memset(windowStart, 0, sizeof(windowStart));
+    memset(flips, 0, sizeof(flips));
+    known = 0;
+    version = 0;
+    suppressed = 0;
+    chatterEvents = 0;
+    setDebounce(0);
+  }
+
+void DSCZoneFilter::setDebounce(unsigned int holdMs, byte maxFlips, unsigned int windowMs)
+  {
+    for (byte z=0;z<ZONES;z++) hold[z] = holdMs;
+    this->maxFlips = maxFlips;
+    this->windowMs = windowMs;
+  }
+
+void DSCZoneFilter::setHold(byte zone, unsigned int holdMs)
+  {
+    if (zone < 1 || zone > ZONES) return;
+    hold[zone - 1] = holdMs;
+  }
+
+void DSCZoneFilter::preset(const byte *bits)
+  {
+    memcpy(zones, bits, sizeof(zones));
+    memcpy(raw, bits, sizeof(raw));
+    known = (1 << ZONE_GROUPS) - 1;
+    version++;
+  }
+
+void DSCZoneFilter::update(byte group, byte bits, unsigned long now)
+  {
+    if (group >= ZONE_GROUPS) return;
+    if (!(known & (1 << group))) {
+      // The first bitmap of the group is how the zones are, held or not
+      zones[group] = raw[group] = bits;
+      known |= 1 << group;
+      version++;
+      return;
+    }
+    byte changed = raw[group] ^ bits;
+    raw[group] = bits;
+
+    for (byte i=0;i<8;i++) {
+      if (!(changed & (1 << i))) continue;
+      byte z = group * 8 + i;
+
+      // A flip back before the last one was passed on cancels it
+      if ((bits & (1 << i)) == (zones[group] & (1 << i))) suppressed++;
+      else if (chatter[group] & (1 << i)) suppressed++;
+      since[z] = now;
+
+      // Count the flips in the current window, a zone flipping too often is
+      // reported once as chattering rather than on every flip
+      if (!windowMs) continue;
+      if (now - windowStart[z] >= windowMs) {
+        windowStart[z] = now;
+        flips[z] = 0;
+      }
+      if (flips[z] < 255) flips[z]++;
+      if (maxFlips && flips[z] > maxFlips && !(chatter[group] & (1 << i))) {
+        chatter[group] |= (1 << i);
+        chatterEvents++;
+        version++;
+      }
+    }
+    service(now);
+  }
+
+void DSCZoneFilter::service(unsigned long now)
+  {
+    for (byte z=0;z<ZONES;z++) promote(z, now);
+  }
+
+void DSCZoneFilter::promote(byte z, unsigned long now)
+  {
+    byte group = z / 8;
+    byte mask = 1 << (z % 8);
+
+    // Chatter clears after a whole quiet window, then the zone's state is
+    // passed on like any other change
+    if (chatter[group] & mask) {
+      if (now - since[z] < windowMs) return;
+      chatter[group] &= ~mask;
+      flips[z] = 0;
+      version++;
+    }
+
+    if (!((raw[group] ^ zones[group]) & mask)) return;
+    if (now - since[z] < hold[z]) return;
+    zones[group] ^= mask;
+    version++;
+  }
@@ -0,0 +1,69 @@
+/* DSC_Zones.h
+ * Part of DSC Library
+ * See COPYRIGHT.txt and LICENSE.txt for more information.
+ *
+ * It contains the per-zone debounce and chatter filter applied to the zone
+ * bitmaps decoded from 0x27/0x2d/0x34/0x3e words, before anything publishes
+ * them. A zone change is only passed on once the zone has held its new state
+ * for the hold time. A zone that flips more than maxFlips times within one
+ * window is flagged as chattering instead, and its state is frozen until it
+ * has been quiet for a whole window, so a faulty sensor produces two events
+ * (chatter on, chatter off) rather than one per flip. The first bitmap of each
+ * group is the panel's state as found, not a change: it is taken straight away.
+ */
+
+#ifndef DSC_Zones_h
+#define DSC_Zones_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "DSC_Constants.h"
+
+const byte ZONES = ZONE_GROUPS * 8;   // Zones covered by the filter
+
+class DSCZoneFilter
+{
+  public:
+    // Pass-through until setDebounce() is called: no hold, no chatter detection
+    DSCZoneFilter(void);
+
+    // Sets the hold time of every zone (ms), and flags a zone as chattering when
+    // it flips more than "maxFlips" times within "windowMs" (0 disables it)
+    void setDebounce(unsigned int holdMs, byte maxFlips = 0, unsigned int windowMs = 0);
+
+    // Overrides the hold time of a single zone (1-ZONES), e.g. a motion detector
+    void setHold(byte zone, unsigned int holdMs);
+
+    // Sets the debounced (and raw) bitmaps straight away, e.g. restored after a restart
+    void preset(const byte *bits);
+
+    // Feeds the decoded bitmap of zone group "group" (0 = zones 1-8)
+    void update(byte group, byte bits, unsigned long now);
+
+    // Passes on the changes that have been held long enough and clears chatter
+    // that has gone quiet. Called by DSC::process() on every loop
+    void service(unsigned long now);
+
+    byte zones[ZONE_GROUPS];          // Debounced open zone bitmaps (bit 0 = lowest zone)
+    byte chatter[ZONE_GROUPS];        // Zones currently flagged as chattering
+    byte known;                       // Groups decoded or preset at least once (bit 0 = group 0)
+    unsigned long version;            // Incremented whenever zones[] or chatter[] change
+    unsigned long suppressed;         // Raw flips that were never passed on
+    unsigned long chatterEvents;      // Times a zone started chattering
+
+  private:
+    void promote(byte zone, unsigned long now);
+
+    byte raw[ZONE_GROUPS];            // Bitmaps as last decoded
+    unsigned int hold[ZONES];         // Hold time per zone, ms
+    unsigned long since[ZONES];       // millis() of the last raw flip
+    unsigned long windowStart[ZONES]; // millis() the current flip window began
+    byte flips[ZONES];                // Raw flips in the current window
+    byte maxFlips;
+    unsigned int windowMs;
+};
+
+#endif
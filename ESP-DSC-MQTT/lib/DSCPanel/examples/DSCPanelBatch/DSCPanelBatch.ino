@@ -0,0 +1,99 @@
+// DSC_18XX Arduino Interface - Batch Decode Example
+//
+// - Demonstrates DSCBatch, which decodes an array of packed panel words into
+//   columns (checksum, lights, zones, armed, panel time) in one call, e.g. for
+//   traces or the journal read back for analysis. Fills a batch with sample
+//   words, prints the first few decoded rows, then times decode() and prints
+//   the frames decoded per second on this core
+//
+// DSCBatch::decode(in, out, first, count) only touches frames first to
+// first+count-1, so on a board (or PC) with several cores the batch can be
+// split into one range per core, and the frames per second added up.
+//
+//
+
+#include <DSC.h>
+
+const size_t FRAMES = 256;        // Frames in the batch
+const byte PASSES = 20;           // Times the batch is decoded for the timing
+
+// Sample panel words, '0'/'1' as in dscFrame_t::pBits
+const char* const samples[] = {
+  "00000101000000001100000010000000110001000",                            // 0x05 Status: Ready
+  "10100101000100100000101100010111010000000100110110000000000101000",    // 0xa5 2024/05/17 14:32, armed by user 3
+  "001001110000000000000000000000000000000000000101000110001",            // 0x27 ZonesA: zones 2, 4 open
+  "001011010000000000000000000000000000000000010000001001101",            // 0x2d ZonesB: zone 14 open
+  "000100010101010101010101001100101"                                     // 0x11 Keypad query
+};
+const byte SAMPLES = sizeof(samples) / sizeof(samples[0]);
+
+byte cmd[FRAMES];
+byte bits[FRAMES];
+byte words[FRAMES][BATCH_BYTES];
+
+byte valid[FRAMES], lights[FRAMES], group[FRAMES], zones[FRAMES], armed[FRAMES], user[FRAMES];
+unsigned long panelTime[FRAMES];
+
+// --------------------------------------------------------------------------------------------------------
+// -----------------------------------------------  SETUP  ------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.flush();
+  Serial.println(F("DSC Powerseries 18XX"));
+  Serial.println(F("Batch Decode Benchmark"));
+
+  for (size_t i=0;i<FRAMES;i++) {
+    bits[i] = DSCBatch::pack(samples[i % SAMPLES], words[i]);
+    cmd[i] = words[i][0];
+  }
+
+  dscBatch_t in = {FRAMES, cmd, bits, words};
+  dscColumns_t out = {valid, lights, group, zones, armed, user, panelTime};
+
+  DSCBatch::decode(in, out);
+  for (byte i=0;i<SAMPLES;i++) {
+    Serial.print("0x");
+    Serial.print(cmd[i], HEX);
+    Serial.print(" valid:");
+    Serial.print(valid[i]);
+    Serial.print(" lights:0x");
+    Serial.print(lights[i], HEX);
+    Serial.print(" group:");
+    Serial.print(group[i]);
+    Serial.print(" zones:0x");
+    Serial.print(zones[i], HEX);
+    Serial.print(" armed:");
+    Serial.print(armed[i]);
+    Serial.print(" user:");
+    Serial.print(user[i]);
+    Serial.print(" time:");
+    Serial.println(panelTime[i]);
+  }
+
+  unsigned long start = micros();
+  for (byte p=0;p<PASSES;p++) DSCBatch::decode(in, out);
+  unsigned long us = micros() - start;
+  if (!us) us = 1;
+
+  Serial.print(F("Decoded "));
+  Serial.print((unsigned long)FRAMES * PASSES);
+  Serial.print(F(" frames in "));
+  Serial.print(us);
+  Serial.print(F(" us, frames/s per core: "));
+  Serial.println((unsigned long)((float)FRAMES * PASSES * 1000000.0 / us));
+}
+
+// --------------------------------------------------------------------------------------------------------
+// ---------------------------------------------  MAIN LOOP  ----------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+void loop()
+{
+}
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------  END  -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
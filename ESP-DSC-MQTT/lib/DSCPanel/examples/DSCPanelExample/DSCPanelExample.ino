@@ -118,13 +118,13 @@ void loop()
   }
  
   // --------------- Print No Data Message -------------- (FOR DEBUG PURPOSES)
-  if ((millis() - dscGlobal.lastData) > 20000) {
+  if ((millis() - dsc.state.lastData) > 20000) {
     // Print no data message if there is no new data in XX time (ms)
     Serial.println(F("--- No data for 20 seconds ---"));  
     if (client.connected() and streamData) {
       client.println(F("--- No data for 20 seconds ---")); 
     }
-    dscGlobal.lastData = millis();          // Reset the timer
+    dsc.state.lastData = millis();          // Reset the timer
   }
 
   // ---------------- Get/process incoming data ----------------
@@ -132,7 +132,7 @@ void loop()
 
   if (dsc.timeAvailable) setDscTime();    // Attempt to update the system time
 
-  if (dscGlobal.pCmd) {
+  if (dsc.state.pCmd) {
     // ------------ Print the formatted raw data ------------
     //Serial.print(message.getBuffer());  // Prints unformatted word to serial
     Serial.println(dsc.pnlFormat());
@@ -140,13 +140,13 @@ void loop()
     message.clear();                      // Clear the message Buffer (this sets first byte to 0)
     message.print(formatTime(now()));     // Add the time stamp
     message.print(" ");
-    if (String(dscGlobal.pCmd,HEX).length() == 1)
+    if (String(dsc.state.pCmd,HEX).length() == 1)
       message.print("0");                 // Write a leading zero to a single digit HEX
-    message.print(String(dscGlobal.pCmd,HEX));
+    message.print(String(dsc.state.pCmd,HEX));
     message.print("(");
-    message.print(dscGlobal.pCmd);
+    message.print(dsc.state.pCmd);
     message.print("): ");
-    message.println(dscGlobal.pMsg);
+    message.println(dsc.state.pMsg);
   
     // ------------ Print the message ------------
     Serial.print(message.getBuffer());
@@ -155,7 +155,7 @@ void loop()
     }
   }
 
-  if (dscGlobal.kCmd) {
+  if (dsc.state.kCmd) {
     // ------------ Print the formatted raw data ------------
     //Serial.print(message.getBuffer());  // Prints unformatted word to serial
     Serial.println(dsc.kpdFormat());
@@ -163,13 +163,13 @@ void loop()
     message.clear();                      // Clear the message Buffer (this sets first byte to 0)
     message.print(formatTime(now()));     // Add the time stamp
     message.print(" ");
-    if (String(dscGlobal.kCmd,HEX).length() == 1)
+    if (String(dsc.state.kCmd,HEX).length() == 1)
       message.print("0");                 // Write a leading zero to a single digit HEX
-    message.print(String(dscGlobal.kCmd,HEX));
+    message.print(String(dsc.state.kCmd,HEX));
     message.print("(");
-    message.print(dscGlobal.kCmd);
+    message.print(dsc.state.kCmd);
     message.print("): ");
-    message.println(dscGlobal.kMsg);
+    message.println(dsc.state.kMsg);
 
     // ------------ Print the message ------------
     Serial.print(message.getBuffer());
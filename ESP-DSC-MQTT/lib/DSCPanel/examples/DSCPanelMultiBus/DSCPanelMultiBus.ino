@@ -0,0 +1,79 @@
+// DSC_18XX Arduino Interface - Multiple Keybus Example
+//
+// - Demonstrates monitoring two panels from one board. Each DSC instance has
+//   its own pins and state, and prints its decoded panel messages tagged with
+//   the bus number
+//
+// Sketch to decode the keybus protocol on DSC PowerSeries 1816, 1832 and 1864 panels
+//   -- Use the schematic at https://github.com/emcniece/Arduino-Keybus to connect the
+//      keybus lines to the arduino via voltage divider circuits.  Don't forget to
+//      connect the Keybus Ground to Arduino Ground (not depicted on the circuit)!
+//      Each panel needs its own clock and data inputs, and both grounds must be
+//      connected to the Arduino Ground.
+//
+//
+
+#include <DSC.h>
+
+const byte BUSES = 2;     // Number of keybuses connected (max MAX_BUSES)
+
+DSC dsc[BUSES];           // Initialize one DSC.h library instance per keybus
+
+// --------------------------------------------------------------------------------------------------------
+// -----------------------------------------------  SETUP  ------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.flush();
+  Serial.println(F("DSC Powerseries 18XX"));
+  Serial.println(F("Multiple Key Bus Interface"));
+  Serial.println(F("Initializing"));
+
+  dsc[0].setCLK(4);       // Bus 0: clock on pin 4, data on pin 5
+  dsc[0].setDTA_IN(5);
+  dsc[0].setLED(2);
+
+  dsc[1].setCLK(14);      // Bus 1: clock on pin 14, data on pin 12
+  dsc[1].setDTA_IN(12);
+  dsc[1].setLED(16);
+
+  for (byte i=0;i<BUSES;i++) {
+    if (!dsc[i].begin()) {            // Start each instance (Sets the pin modes)
+      Serial.print(F("Bus "));
+      Serial.print(i);
+      Serial.println(F(" could not be attached"));
+    }
+  }
+}
+
+// --------------------------------------------------------------------------------------------------------
+// ---------------------------------------------  MAIN LOOP  ----------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+void loop()
+{
+  // ---------------- Get/process incoming data on every bus ----------------
+  for (byte i=0;i<BUSES;i++) {
+    if (!dsc[i].process()) continue;
+
+    if (dsc[i].state.pCmd) {
+      Serial.print("[Bus ");
+      Serial.print(i);
+      Serial.print("] ");
+      Serial.println(dsc[i].state.pMsg);
+    }
+
+    if (dsc[i].state.kCmd) {
+      Serial.print("[Bus ");
+      Serial.print(i);
+      Serial.print("] ");
+      Serial.println(dsc[i].state.kMsg);
+    }
+  }
+}
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------  END  -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
@@ -42,7 +42,7 @@ void loop()
   // ---------------- Get/process incoming data ----------------
   if (!dsc.process()) return;
 
-  if (dscGlobal.pCmd) {
+  if (dsc.state.pCmd) {
     // ------------ Print the Binary Panel Word ------------
     //Serial.print(F("[Panel]  "));
     Serial.println(dsc.pnlRaw());
@@ -52,16 +52,16 @@ void loop()
 
     // ------------ Print the decoded Panel Message ------------
     Serial.print("---> ");
-    if (String(dscGlobal.pCmd,HEX).length() == 1)
+    if (String(dsc.state.pCmd,HEX).length() == 1)
       Serial.print("0");                  // Write a leading zero to a single digit HEX
-    Serial.print(String(dscGlobal.pCmd,HEX));
+    Serial.print(String(dsc.state.pCmd,HEX));
     Serial.print("(");
-    Serial.print(dscGlobal.pCmd);
+    Serial.print(dsc.state.pCmd);
     Serial.print("): ");
-    Serial.println(dscGlobal.pMsg);
+    Serial.println(dsc.state.pMsg);
   }
 
-  if (dscGlobal.kCmd) {
+  if (dsc.state.kCmd) {
     // ------------ Print the Binary Keypad Word ------------
     //Serial.print(F("[Keypad] "));
     Serial.println(dsc.kpdRaw());    
@@ -71,13 +71,13 @@ void loop()
 
     // ------------ Print the decoded Keypad Message ------------
     Serial.print("---> ");
-    if (String(dscGlobal.kCmd,HEX).length() == 1)
+    if (String(dsc.state.kCmd,HEX).length() == 1)
       Serial.print("0");                  // Write a leading zero to a single digit HEX
-    Serial.print(String(dscGlobal.kCmd,HEX));
+    Serial.print(String(dsc.state.kCmd,HEX));
     Serial.print("(");
-    Serial.print(dscGlobal.kCmd);
+    Serial.print(dsc.state.kCmd);
     Serial.print("): ");
-    Serial.println(dscGlobal.kMsg);
+    Serial.println(dsc.state.kMsg);
   }
 }
 
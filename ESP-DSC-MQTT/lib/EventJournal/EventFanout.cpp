@@ -0,0 +1,96 @@
+#include "EventFanout.h"
+#include <string.h>
+
+EventSink::EventSink(bool (*write)(const ringEvent_t &event), bool (*ready)(void))
+  : written(0), dropped(0), coalesced(0), refused(0), _write(write), _ready(ready),
+    _backlog(FANOUT_WINDOW), _budget(1), _policy(SINK_DROP_OLDEST), cursor(0)
+  {
+  }
+
+void EventSink::setLimits(uint8_t backlog, uint8_t budget, uint8_t policy)
+  {
+    _backlog = backlog ? backlog : 1;
+    _budget = budget ? budget : 1;
+    _policy = policy;
+  }
+
+EventFanout::EventFanout(size_t size)
+  : ring(size), used(0)
+  {
+  }
+
+int EventFanout::begin()
+  {
+    return ring.begin();
+  }
+
+int EventFanout::attach(EventSink &sink)
+  {
+    if (used >= FANOUT_SINKS) return 0;       // return failure, table full
+    sink.cursor = ring.nextSeq() - 1;
+    sinks[used++] = &sink;
+    return 1;                                 // return success
+  }
+
+uint32_t EventFanout::publish(uint32_t time, uint8_t type, uint8_t cmd, uint8_t flags, const char *text)
+  {
+    return ring.add(time, type, cmd, flags, text);
+  }
+
+uint32_t EventFanout::backlog(const EventSink &sink)
+  {
+    return ring.nextSeq() - 1 - sink.cursor;
+  }
+
+bool EventFanout::repeated(const ringEvent_t *events, size_t n, size_t i)
+  {
+    // Only a state, and only when nothing came between: open, closed, open
+    // is three changes, and two key actions alike are two actions
+    if (!(events[i].flags & FANOUT_STATE) || i + 1 >= n) return false;
+    const ringEvent_t &next = events[i + 1];
+    return next.type == events[i].type && next.cmd == events[i].cmd &&
+           next.flags == events[i].flags && !strcmp(next.text, events[i].text);
+  }
+
+int EventFanout::service()
+  {
+    ringEvent_t events[FANOUT_WINDOW];
+    int count = 0;
+    uint32_t last = ring.nextSeq() - 1;
+
+    for (uint8_t s=0;s<used;s++) {
+      EventSink &sink = *sinks[s];
+
+      // Skip what was dropped from the ring, or is beyond the sink's backlog
+      uint32_t first = ring.firstSeq();
+      if (sink.cursor + 1 < first) {
+        sink.dropped += first - 1 - sink.cursor;
+        sink.cursor = first - 1;
+      }
+      if (last - sink.cursor > sink._backlog) {
+        sink.dropped += last - sink.cursor - sink._backlog;
+        sink.cursor = last - sink._backlog;
+      }
+      if (sink.cursor == last) continue;
+      if (sink._ready && !sink._ready()) continue;
+
+      size_t n = ring.read(sink.cursor, events, FANOUT_WINDOW);
+      uint8_t budget = sink._budget;
+      for (size_t i=0;i<n && budget;i++) {
+        if (sink._policy == SINK_COALESCE && repeated(events, n, i)) {
+          sink.coalesced++;
+          sink.cursor = events[i].seq;
+          continue;
+        }
+        if (!sink._write(events[i])) {
+          sink.refused++;
+          break;                              // retried on the next call
+        }
+        sink.cursor = events[i].seq;
+        sink.written++;
+        budget--;
+        count++;
+      }
+    }
+    return count;
+  }
@@ -0,0 +1,95 @@
+/*
+  EventFanout.h - Library for passing decoded events on to several
+  outputs (sinks) without any of them holding up the keybus
+
+  publish() only copies the event into an EventRing shared by all of the
+  sinks, it never calls a sink. service() then hands each sink the events
+  after its own cursor, at most "budget" of them per call, stopping at the
+  first one the sink cannot take yet (not connected, buffer full). A sink
+  that falls more than "backlog" events behind, or behind the oldest event
+  still held, skips ahead and counts what it missed, so one slow or
+  disconnected sink costs the others nothing.
+
+  Released into the public domain.
+
+*/
+
+#ifndef EventFanout_h
+#define EventFanout_h
+
+#include "EventRing.h"
+
+#define FANOUT_SINKS 6                // Sinks attached at most
+#define FANOUT_WINDOW 16              // Events looked at per sink per service()
+
+// ----- Sink Policies -----
+#define SINK_DROP_OLDEST 0            // Every event, the oldest dropped when behind
+#define SINK_COALESCE 1               // A state event followed straight away by the
+                                      // same event is dropped, only the later is written
+
+// ----- Event Flags -----
+#define FANOUT_STATE 0x80             // The event is a state (zones, a status word),
+                                      // an identical copy right after it replaces it
+
+class EventSink
+{
+  public:
+    // "write" passes an event on, returning false if it cannot be taken now
+    // (it is retried on the next service()). "ready", if set, returns false
+    // while the sink cannot take anything, e.g. while it is disconnected
+    EventSink(bool (*write)(const ringEvent_t &event), bool (*ready)(void) = NULL);
+
+    // Sets the most events the sink may fall behind, the most written per
+    // service() and the policy (SINK_DROP_OLDEST or SINK_COALESCE)
+    void setLimits(uint8_t backlog, uint8_t budget, uint8_t policy);
+
+    unsigned long written;            // Events written
+    unsigned long dropped;            // Events skipped, the sink was too far behind
+    unsigned long coalesced;          // State repeats skipped (SINK_COALESCE)
+    unsigned long refused;            // Times write() could not take an event
+
+  private:
+    friend class EventFanout;
+
+    bool (*_write)(const ringEvent_t &event);
+    bool (*_ready)(void);
+    uint8_t _backlog;
+    uint8_t _budget;
+    uint8_t _policy;
+    uint32_t cursor;                  // Last sequence number written or skipped
+};
+
+class EventFanout
+{
+  public:
+    // Class to call to initialize the fan-out (before Setup), "size" is the
+    // byte pool of the ring shared by the sinks
+    EventFanout(size_t size);
+
+    // Allocates the ring (in Setup), returns 1 for success, 0 for failure
+    int begin();
+
+    // Adds a sink, it gets the events published from now on
+    // Returns 1 for success, 0 if FANOUT_SINKS are attached already
+    int attach(EventSink &sink);
+
+    // Queues an event for every sink, see EventRing::add()
+    uint32_t publish(uint32_t time, uint8_t type, uint8_t cmd, uint8_t flags, const char *text);
+
+    // Hands each sink its next events, within its budget
+    // Included in the main loop, returns the number of events written
+    int service();
+
+    // Events queued for "sink" and not written yet
+    uint32_t backlog(const EventSink &sink);
+
+    EventRing ring;
+
+  private:
+    bool repeated(const ringEvent_t *events, size_t n, size_t i);
+
+    EventSink *sinks[FANOUT_SINKS];
+    uint8_t used;
+};
+
+#endif
@@ -0,0 +1,342 @@
+#include "EventJournal.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#if defined(ARDUINO)
+static unsigned long journalMicros() { return micros(); }
+#else
+#include <time.h>
+static unsigned long journalMicros()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+  }
+#endif
+
+// ------------------------------------------------------------------
+// ----------------------- Storage backends -------------------------
+// ------------------------------------------------------------------
+
+#if defined(ARDUINO) && !defined(ARDUINO_HOST)
+
+FSJournalStorage::FSJournalStorage(fs::FS &fs, const char *path, uint16_t pages)
+  : _fs(fs), _path(path), _pages(pages)
+  {
+  }
+
+uint16_t FSJournalStorage::pages()
+  {
+    return _pages;
+  }
+
+void FSJournalStorage::pageName(uint16_t index, char *name, size_t len)
+  {
+    snprintf(name, len, "%s/%03u", _path, index);
+  }
+
+int FSJournalStorage::readPage(uint16_t index, journalPage_t *page)
+  {
+    char name[48];
+    pageName(index, name, sizeof(name));
+    File f = _fs.open(name, "r");
+    if (!f) return 0;                         // return failure (not written yet)
+    size_t n = f.read((uint8_t*)page, sizeof(journalPage_t));
+    f.close();
+    return n == sizeof(journalPage_t);
+  }
+
+int FSJournalStorage::writePage(uint16_t index, const journalPage_t *page)
+  {
+    // "w" truncates, so the page is written as a new file of one page
+    char name[48];
+    pageName(index, name, sizeof(name));
+    File f = _fs.open(name, "w");
+    if (!f) {
+      _fs.mkdir(_path);                       // first write, create the directory
+      f = _fs.open(name, "w");
+    }
+    if (!f) return 0;                         // return failure
+    size_t n = f.write((const uint8_t*)page, sizeof(journalPage_t));
+    f.close();
+    return n == sizeof(journalPage_t);
+  }
+
+#else
+
+FileJournalStorage::FileJournalStorage(const char *path, uint16_t pages)
+  : writes(0), _pages(pages)
+  {
+    file = fopen(path, "r+b");
+    if (!file) file = fopen(path, "w+b");     // first use, create the file
+  }
+
+FileJournalStorage::~FileJournalStorage()
+  {
+    if (file) fclose(file);
+  }
+
+uint16_t FileJournalStorage::pages()
+  {
+    return _pages;
+  }
+
+int FileJournalStorage::readPage(uint16_t index, journalPage_t *page)
+  {
+    if (!file) return 0;
+    if (fseek(file, (long)index * JOURNAL_PAGE_SIZE, SEEK_SET)) return 0;
+    return fread(page, sizeof(journalPage_t), 1, file) == 1;
+  }
+
+int FileJournalStorage::writePage(uint16_t index, const journalPage_t *page)
+  {
+    if (!file) return 0;
+    if (fseek(file, (long)index * JOURNAL_PAGE_SIZE, SEEK_SET)) return 0;
+    if (fwrite(page, sizeof(journalPage_t), 1, file) != 1) return 0;
+    fflush(file);
+    writes++;
+    return 1;
+  }
+
+#endif
+
+// ------------------------------------------------------------------
+// ------------------------- EventJournal ---------------------------
+// ------------------------------------------------------------------
+
+EventJournal::EventJournal(JournalStorage &storage, unsigned long flushMs)
+  : _storage(storage), _flushMs(flushMs)
+  {
+    index = NULL;
+    pages = 0;
+  }
+
+uint32_t EventJournal::crc32(const uint8_t *data, size_t len)
+  {
+    // Bitwise CRC32 (IEEE 802.3), small rather than fast: it runs once per page
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+      crc ^= *data++;
+      for (int k=0;k<8;k++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+  }
+
+int EventJournal::begin()
+  {
+    pages = _storage.pages();
+    if (pages < 2) return 0;                  // return failure, needs a ring
+
+    if (index) free(index);
+    index = (uint32_t*)malloc(sizeof(uint32_t) * pages);
+    if (!index) return 0;                     // return failure if malloc fails
+    memset(index, 0, sizeof(uint32_t) * pages);
+
+    pageWrites = 0;
+    badPages = 0;
+    writeErrors = 0;
+    dropped = 0;
+    writeUs = 0;
+    writeMaxUs = 0;
+    dirty = false;
+    hasPending = false;
+
+    // Scan every page, index the valid ones and find the newest
+    bool found = false;
+    uint32_t newestPageSeq = 0;
+    uint16_t newest = 0;
+    for (uint16_t i=0;i<pages;i++) {
+      if (!_storage.readPage(i, &current)) continue;   // not written yet
+      if (current.magic != JOURNAL_MAGIC || !current.count ||
+          current.count > JOURNAL_PAGE_EVENTS ||
+          current.crc != crc32((const uint8_t*)&current, offsetof(journalPage_t, crc))) {
+        if (current.magic || current.count) badPages++;
+        continue;
+      }
+      index[i] = current.events[0].seq;
+      if (!found || current.pageSeq > newestPageSeq) {
+        found = true;
+        newestPageSeq = current.pageSeq;
+        newest = i;
+      }
+    }
+
+    if (!found) {
+      // Empty journal, start at the first page
+      memset(&current, 0, sizeof(current));
+      current.magic = JOURNAL_MAGIC;
+      current.pageSeq = 1;
+      head = 0;
+      seq = 1;
+      return 1;                               // return success
+    }
+
+    // Continue after the last event of the newest page, filling it if it has room
+    _storage.readPage(newest, &current);
+    seq = current.events[current.count - 1].seq + 1;
+    if (current.count < JOURNAL_PAGE_EVENTS) {
+      head = newest;
+    }
+    else {
+      head = (newest + 1) % pages;
+      index[head] = 0;                        // the oldest page, overwritten next
+      memset(&current, 0, sizeof(current));
+      current.magic = JOURNAL_MAGIC;
+      current.pageSeq = newestPageSeq + 1;
+    }
+    return 1;                                 // return success
+  }
+
+int EventJournal::end()
+  {
+    if (!index) return 0;                     // return failure
+    free(index);
+    index = NULL;
+    return 1;                                 // return success
+  }
+
+uint32_t EventJournal::add(uint32_t time, uint32_t uptimeMs, uint8_t flags, const char *word, int bits)
+  {
+    if (!index) return 0;                     // return failure, not mounted
+
+    if (current.count >= JOURNAL_PAGE_EVENTS) {
+      // The current page is full, hand it over to service() and start the next
+      if (dirty) {
+        if (hasPending) {
+          dropped++;                          // both RAM pages are full
+          return 0;
+        }
+        memcpy(&pending, &current, sizeof(current));
+        pendingSlot = head;
+        hasPending = true;
+        dirty = false;
+      }
+
+      head = (head + 1) % pages;
+      uint32_t pageSeq = current.pageSeq + 1;
+      memset(&current, 0, sizeof(current));
+      current.magic = JOURNAL_MAGIC;
+      current.pageSeq = pageSeq;
+    }
+
+    journalEvent_t &e = current.events[current.count];
+    memset(&e, 0, sizeof(e));
+    if (bits > JOURNAL_DATA_BYTES * 8) bits = JOURNAL_DATA_BYTES * 8;
+    if (bits < 0) bits = 0;
+    for (int i=0;i<bits;i++) {
+      if (word[i] == '1') e.data[i >> 3] |= 0x80 >> (i & 7);
+    }
+    e.seq = seq++;
+    e.time = time;
+    e.uptimeMs = uptimeMs;
+    e.cmd = e.data[0];
+    e.flags = flags;
+    e.bits = bits;
+
+    if (current.count == 0) index[head] = e.seq;   // this slot now holds the new page
+    current.count++;
+    if (!dirty) dirtySince = uptimeMs;
+    dirty = true;
+    return e.seq;
+  }
+
+int EventJournal::writePage(uint16_t slot, journalPage_t *page)
+  {
+    page->crc = crc32((const uint8_t*)page, offsetof(journalPage_t, crc));
+    unsigned long start = journalMicros();
+    int ok = _storage.writePage(slot, page);
+    writeUs = journalMicros() - start;        // How long service()/flush() held up the loop
+    if (writeUs > writeMaxUs) writeMaxUs = writeUs;
+    if (!ok) {
+      writeErrors++;
+      return 0;                               // return failure
+    }
+    index[slot] = page->events[0].seq;
+    pageWrites++;
+    return 1;                                 // return success
+  }
+
+int EventJournal::service(unsigned long now)
+  {
+    if (!index) return 0;
+
+    // A full page is always written first, one page per call at most
+    if (hasPending) {
+      hasPending = false;
+      return writePage(pendingSlot, &pending);
+    }
+    if (dirty && (now - dirtySince >= _flushMs)) return flush();
+    return 0;
+  }
+
+int EventJournal::flush()
+  {
+    if (!index || !dirty) return 0;
+    dirty = false;
+    return writePage(head, &current);
+  }
+
+const journalPage_t* EventJournal::loadPage(uint16_t slot, journalPage_t *scratch)
+  {
+    // Pages still in RAM are newer than their copy in the storage
+    if (slot == head) return &current;
+    if (hasPending && slot == pendingSlot) return &pending;
+    if (!_storage.readPage(slot, scratch)) return NULL;
+    if (scratch->magic != JOURNAL_MAGIC) return NULL;
+    return scratch;
+  }
+
+uint16_t EventJournal::findPage(uint32_t fromSeq)
+  {
+    // Binary search of the page index in ring order (oldest page first, the
+    // current page last) for the last page starting at or before "fromSeq".
+    // Unused slots only occur before the first written page, so they sort as
+    // the oldest. Returns the position in ring order
+    if (current.count && current.events[0].seq <= fromSeq) return pages - 1;
+    uint16_t lo = 0, hi = pages - 1;
+    while (hi - lo > 1) {
+      uint16_t mid = (lo + hi) / 2;
+      uint32_t first = index[(head + 1 + mid) % pages];
+      if (first == 0 || first <= fromSeq) lo = mid;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+size_t EventJournal::read(uint32_t fromSeq, journalEvent_t *out, size_t max)
+  {
+    if (!index || !max) return 0;
+
+    journalPage_t scratch;
+    size_t n = 0;
+    uint32_t last = 0;
+    for (uint16_t k=findPage(fromSeq);k<pages && n<max;k++) {
+      uint16_t slot = (head + 1 + k) % pages;
+      if (!index[slot]) continue;
+      const journalPage_t *page = loadPage(slot, &scratch);
+      if (!page) continue;
+      for (uint8_t i=0;i<page->count && n<max;i++) {
+        const journalEvent_t &e = page->events[i];
+        if (e.seq < fromSeq || e.seq <= last) continue;
+        out[n++] = e;
+        last = e.seq;
+      }
+    }
+    return n;
+  }
+
+uint32_t EventJournal::firstSeq()
+  {
+    if (!index) return 0;
+    for (uint16_t k=0;k<pages;k++) {
+      uint32_t first = index[(head + 1 + k) % pages];
+      if (first) return first;
+    }
+    return seq;
+  }
+
+uint32_t EventJournal::nextSeq()
+  {
+    return seq;
+  }
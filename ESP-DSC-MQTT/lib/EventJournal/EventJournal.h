@@ -0,0 +1,198 @@
+/*
+  EventJournal.h - Library for keeping an append-only journal of
+  compact binary keybus events in flash
+
+  Events are collected in RAM into fixed-size pages and written a whole
+  page at a time, in ring order, to a JournalStorage (a LittleFS/SPIFFS
+  file per page on the ESP8266, or a plain file on a host). Each page carries a
+  sequence number and a CRC32, so torn or stale pages are skipped when
+  the journal is mounted. Writing the pages in ring order levels the wear
+  across the whole journal.
+
+  Released into the public domain.
+
+*/
+
+#ifndef EventJournal_h
+#define EventJournal_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#elif defined(ARDUINO)
+#include "WProgram.h"
+#else
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#endif
+
+#if defined(ARDUINO) && !defined(ARDUINO_HOST)
+#include <FS.h>
+#endif
+
+// ----- Journal Constants -----
+#define JOURNAL_PAGE_SIZE 512         // Bytes per flash page
+#define JOURNAL_DATA_BYTES 16         // Packed word bytes kept per event (128 bits)
+#define JOURNAL_PAGE_EVENTS 15        // Events per page, fits in JOURNAL_PAGE_SIZE
+#define JOURNAL_MAGIC 0xD5C1
+
+// ----- Event Flags -----
+#define JOURNAL_FLAG_KEYPAD 0x01      // The event is a keypad word (else panel)
+#define JOURNAL_FLAG_UPTIME 0x02      // time is seconds since boot, not epoch
+
+// A single journal event (32 bytes)
+typedef struct
+{
+  uint32_t seq;                       // Sequence number, increasing, never reused
+  uint32_t time;                      // Epoch seconds (or uptime, see flags)
+  uint8_t cmd;                        // Command byte of the word
+  uint8_t flags;                      // JOURNAL_FLAG_*
+  uint8_t bits;                       // Length of the word in bits
+  uint8_t reserved;
+  uint8_t data[JOURNAL_DATA_BYTES];   // The word, packed MSB first
+  uint32_t uptimeMs;                  // millis() when the event was added
+}
+journalEvent_t;
+
+// A journal page as written to the storage (JOURNAL_PAGE_SIZE bytes)
+typedef struct
+{
+  uint16_t magic;                     // JOURNAL_MAGIC
+  uint8_t count;                      // Events used in this page
+  uint8_t reserved;
+  uint32_t pageSeq;                   // Page sequence number, increasing
+  journalEvent_t events[JOURNAL_PAGE_EVENTS];
+  uint8_t pad[JOURNAL_PAGE_SIZE - 12 - (JOURNAL_PAGE_EVENTS * sizeof(journalEvent_t))];
+  uint32_t crc;                       // CRC32 of everything above
+}
+journalPage_t;
+
+// Storage of a fixed number of JOURNAL_PAGE_SIZE pages
+class JournalStorage
+{
+  public:
+    virtual ~JournalStorage() {}
+
+    // Returns the number of pages the storage can hold
+    virtual uint16_t pages() = 0;
+
+    // Reads/writes page "index", return 1 for success and 0 for failure
+    virtual int readPage(uint16_t index, journalPage_t *page) = 0;
+    virtual int writePage(uint16_t index, const journalPage_t *page) = 0;
+};
+
+#if defined(ARDUINO) && !defined(ARDUINO_HOST)
+// Journal pages kept on a LittleFS or SPIFFS filesystem, one small file per page
+// in directory "path" (e.g. /journal/007), so a page write replaces a whole file
+// rather than rewriting the middle of a large one (which LittleFS does by
+// copying everything after it)
+class FSJournalStorage : public JournalStorage
+{
+  public:
+    FSJournalStorage(fs::FS &fs, const char *path, uint16_t pages);
+
+    virtual uint16_t pages();
+    virtual int readPage(uint16_t index, journalPage_t *page);
+    virtual int writePage(uint16_t index, const journalPage_t *page);
+
+  private:
+    void pageName(uint16_t index, char *name, size_t len);
+
+    fs::FS &_fs;
+    const char *_path;
+    uint16_t _pages;
+};
+#else
+// Flash emulator for host builds: journal pages kept in a plain file, so
+// the journal can be built and stress-tested off the device
+class FileJournalStorage : public JournalStorage
+{
+  public:
+    FileJournalStorage(const char *path, uint16_t pages);
+    ~FileJournalStorage();
+
+    virtual uint16_t pages();
+    virtual int readPage(uint16_t index, journalPage_t *page);
+    virtual int writePage(uint16_t index, const journalPage_t *page);
+
+    unsigned long writes;             // Page writes issued, for wear figures
+
+  private:
+    FILE *file;
+    uint16_t _pages;
+};
+#endif
+
+class EventJournal
+{
+  public:
+
+    // In general, functions will return the following:
+    //    If failure, return int 0
+    //    If success, return int 1, or the count of what was added/read
+
+    // Class to call to initialize the journal (before Setup). "flushMs" is the
+    // longest a partly filled page is held in RAM before it is written
+    EventJournal(JournalStorage &storage, unsigned long flushMs = 30000);
+
+    // Mounts the journal (in Setup): scans the pages, skips the ones with a
+    // bad CRC, builds the page index and finds where to continue writing
+    int begin();
+
+    // Frees the page index, requires a begin() to mount the journal again
+    int end();
+
+    // Adds an event to the RAM page, never touches the storage. "word" is the
+    // keybus word as a string of '0'/'1' characters, "uptimeMs" is millis()
+    // Returns the sequence number of the event, or 0 if it was dropped
+    // (both RAM pages full, service() not called often enough)
+    uint32_t add(uint32_t time, uint32_t uptimeMs, uint8_t flags, const char *word, int bits);
+
+    // Writes at most one page when one is full or has waited "flushMs"
+    // Included in the main loop, returns 1 if a page was written
+    int service(unsigned long now);
+
+    // Writes the RAM page now, whether it is full or not
+    int flush();
+
+    // Copies up to "max" events with seq >= "fromSeq", oldest first, into
+    // "out". Returns the number of events copied
+    size_t read(uint32_t fromSeq, journalEvent_t *out, size_t max);
+
+    // Returns the oldest sequence number still held, and the next one to be used
+    uint32_t firstSeq();
+    uint32_t nextSeq();
+
+    // Computes the CRC32 (IEEE) of "len" bytes
+    static uint32_t crc32(const uint8_t *data, size_t len);
+
+    unsigned long pageWrites;         // Pages written since begin()
+    unsigned long badPages;           // Pages skipped at mount (CRC/magic)
+    unsigned long writeErrors;        // Failed page writes
+    unsigned long dropped;            // Events dropped by add(), RAM pages full
+    unsigned long writeUs;            // Time the last page write held up the caller, us
+    unsigned long writeMaxUs;         // Longest page write since begin(), us
+
+  private:
+    int writePage(uint16_t slot, journalPage_t *page);
+    const journalPage_t* loadPage(uint16_t slot, journalPage_t *scratch);
+    uint16_t findPage(uint32_t seq);
+
+    JournalStorage &_storage;
+    unsigned long _flushMs;
+
+    journalPage_t current;            // Page being filled in RAM
+    journalPage_t pending;            // Full page waiting for service() to write it
+    bool dirty;                       // current has events not yet written
+    bool hasPending;                  // pending holds a page not yet written
+    unsigned long dirtySince;         // uptimeMs of the first unwritten event
+    uint16_t head;                    // Storage slot of the current page
+    uint16_t pendingSlot;             // Storage slot of the pending page
+    uint32_t seq;                     // Next event sequence number
+
+    // Page index: first event seq of each stored page, 0 if empty/invalid
+    uint32_t *index;
+    uint16_t pages;
+};
+
+#endif
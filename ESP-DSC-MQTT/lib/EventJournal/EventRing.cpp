@@ -0,0 +1,136 @@
+#include "EventRing.h"
+#include <string.h>
+#include <stdlib.h>
+
+// Header of each record in the pool, the text and its null follow it and
+// the record is padded to a multiple of 4 bytes
+typedef struct
+{
+  uint32_t seq;
+  uint32_t time;
+  uint16_t len;                       // Text length, without the null
+  uint8_t type;
+  uint8_t cmd;
+  uint8_t flags;
+  uint8_t reserved[3];
+}
+ringRecord_t;
+
+static size_t paddedSize(size_t len)
+  {
+    return (sizeof(ringRecord_t) + len + 1 + 3) & ~(size_t)3;
+  }
+
+EventRing::EventRing(size_t size)
+  : epoch(0), evicted(0), dropped(0), pool(NULL), _size(size), head(0), tail(0),
+    wrapEnd(0), wrapped(false), count(0), seq(1)
+  {
+  }
+
+int EventRing::begin()
+  {
+    if (pool) return 1;
+    pool = (uint8_t*)malloc(_size);
+    return pool != NULL;
+  }
+
+size_t EventRing::recordSize(size_t offset)
+  {
+    ringRecord_t r;
+    memcpy(&r, pool + offset, sizeof(r));
+    return paddedSize(r.len);
+  }
+
+void EventRing::evict()
+  {
+    tail += recordSize(tail);
+    count--;
+    evicted++;
+    if (wrapped && tail == wrapEnd) {
+      tail = 0;
+      wrapped = false;
+    }
+  }
+
+uint32_t EventRing::add(uint32_t time, uint8_t type, uint8_t cmd, uint8_t flags, const char *text)
+  {
+    size_t len = strlen(text);
+    size_t n = paddedSize(len);
+    if (!pool || len > 0xffff || n > _size / 2) {
+      dropped++;
+      return 0;                               // return failure, too large
+    }
+
+    // Make room at head: to the end of the pool, then from its start up to
+    // the oldest event, dropping the oldest events until it is large enough
+    for (;;) {
+      if (!count) {
+        head = tail = 0;
+        wrapped = false;
+      }
+      if (!wrapped) {
+        if (head + n <= _size) break;
+        wrapEnd = head;
+        head = 0;
+        wrapped = true;
+      }
+      if (tail - head >= n) break;
+      evict();
+    }
+
+    ringRecord_t r;
+    memset(&r, 0, sizeof(r));
+    r.seq = seq;
+    r.time = time;
+    r.len = len;
+    r.type = type;
+    r.cmd = cmd;
+    r.flags = flags;
+    memcpy(pool + head, &r, sizeof(r));
+    memcpy(pool + head + sizeof(r), text, len + 1);
+    head += n;
+    count++;
+    return seq++;
+  }
+
+size_t EventRing::read(uint32_t since, ringEvent_t *out, size_t max)
+  {
+    size_t n = 0;
+    size_t offset = tail;
+    for (size_t i=0;i<count && n<max;i++) {
+      ringRecord_t r;
+      memcpy(&r, pool + offset, sizeof(r));
+      if (r.seq > since) {
+        out[n].seq = r.seq;
+        out[n].time = r.time;
+        out[n].type = r.type;
+        out[n].cmd = r.cmd;
+        out[n].flags = r.flags;
+        out[n].text = (const char*)(pool + offset + sizeof(r));
+        n++;
+      }
+      offset += paddedSize(r.len);
+      if (wrapped && offset == wrapEnd) offset = 0;
+    }
+    return n;
+  }
+
+size_t EventRing::readCursor(uint32_t cursorEpoch, uint32_t since, ringEvent_t *out, size_t max, bool &gap)
+  {
+    gap = cursorEpoch != epoch;
+    if (gap || (since + 1 < firstSeq()) || (since >= nextSeq())) {
+      gap = gap || since != 0;
+      since = firstSeq() - 1;
+    }
+    return read(since, out, max);
+  }
+
+uint32_t EventRing::firstSeq()
+  {
+    return seq - count;
+  }
+
+uint32_t EventRing::nextSeq()
+  {
+    return seq;
+  }
@@ -0,0 +1,90 @@
+/*
+  EventRing.h - Library for keeping the latest decoded events in RAM,
+  numbered, for clients that poll with a cursor
+
+  Events are variable length text records (the JSON of a decoded word,
+  a zone change...) packed one after the other into a fixed byte pool.
+  When a new event does not fit, the oldest ones are dropped to make
+  room. Every event gets the next sequence number, so a client that
+  asks for the events after the last one it has seen either gets all
+  of them, or can tell that some were dropped before it came back.
+  Sequence numbers start again at 1 with the ring, so a cursor also
+  carries the ring's epoch (e.g. a random id per boot): one of another
+  epoch is a gap whatever its number, see readCursor().
+
+  Released into the public domain.
+
+*/
+
+#ifndef EventRing_h
+#define EventRing_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#elif defined(ARDUINO)
+#include "WProgram.h"
+#else
+#include <stdint.h>
+#include <stddef.h>
+#endif
+
+// An event as returned by read(), "text" points into the ring and stays
+// valid until the next add()
+typedef struct
+{
+  uint32_t seq;                       // Sequence number, from 1, increasing
+  uint32_t time;                      // As given to add(), e.g. epoch seconds
+  uint8_t type;                       // As given to add()
+  uint8_t cmd;                        // As given to add()
+  uint8_t flags;                      // As given to add()
+  const char *text;
+}
+ringEvent_t;
+
+class EventRing
+{
+  public:
+    // Class to call to initialize the ring (before Setup), "size" is the
+    // byte pool shared by all of the events
+    EventRing(size_t size);
+
+    // Allocates the pool (in Setup), returns 1 for success, 0 for failure
+    int begin();
+
+    // Copies an event into the ring, dropping the oldest ones as needed
+    // Returns its sequence number, or 0 if it is larger than half the pool
+    uint32_t add(uint32_t time, uint8_t type, uint8_t cmd, uint8_t flags, const char *text);
+
+    // Copies up to "max" events with seq > "since", oldest first, into
+    // "out". Returns the number of events copied
+    size_t read(uint32_t since, ringEvent_t *out, size_t max);
+
+    // As read(), for a client's cursor: "cursorEpoch" and "since" as it got
+    // them with its last events ("since" 0 at first). Sets "gap" if events
+    // after the cursor were dropped, or the cursor is of another epoch or
+    // ahead of the ring; the events are then read from the oldest held
+    size_t readCursor(uint32_t cursorEpoch, uint32_t since, ringEvent_t *out, size_t max, bool &gap);
+
+    // Returns the oldest sequence number still held, and the next one to be used
+    uint32_t firstSeq();
+    uint32_t nextSeq();
+
+    uint32_t epoch;                   // Set by the owner, e.g. a random id per boot
+    unsigned long evicted;            // Events dropped to make room
+    unsigned long dropped;            // Events too large to be added
+
+  private:
+    size_t recordSize(size_t offset);
+    void evict();
+
+    uint8_t *pool;
+    size_t _size;
+    size_t head;                      // Where the next event is written
+    size_t tail;                      // Offset of the oldest event
+    size_t wrapEnd;                   // End of the events before the wrap
+    bool wrapped;                     // Events run tail..wrapEnd, then 0..head
+    size_t count;                     // Events held
+    uint32_t seq;                     // Next sequence number
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "Arduino.h"
+#include "SerialLog.h"
+
+static const char levelChars[] = "-EWID";
+
+SerialLog::SerialLog(unsigned int bufSize)
+  {
+    _bufSize = bufSize;
+    _port = NULL;
+    buffer = NULL;
+    head = tail = used = 0;
+    _level = SERIAL_LOG_LEVEL;
+    records = 0;
+    overflows = 0;
+    bytesOut = 0;
+  }
+
+int SerialLog::begin(Print &port)
+  {
+    _port = &port;
+    if (!buffer) buffer = (byte*)malloc(_bufSize);
+    if (!buffer) return 0;        // return failure if malloc fails
+    return 1;
+  }
+
+void SerialLog::setLevel(byte level)
+  {
+    _level = level;
+  }
+
+void SerialLog::put(const char *data, unsigned int len)
+  {
+    while (len) {
+      unsigned int n = _bufSize - head;
+      if (n > len) n = len;
+      memcpy(buffer + head, data, n);
+      head = (head + n) % _bufSize;
+      used += n;
+      data += n;
+      len -= n;
+    }
+  }
+
+bool SerialLog::enabled(byte level)
+  {
+    return level != LOG_NONE && level <= SERIAL_LOG_LEVEL && level <= _level;
+  }
+
+int SerialLog::add(byte level, const char *tag, const char *text)
+  {
+    if (!buffer || !enabled(level)) return 0;
+    unsigned int tagLen = strlen(tag);
+    unsigned int textLen = strlen(text);
+    unsigned int len = 2 + tagLen + 2 + textLen + 2;     // "I tag: text\r\n"
+    if (len > _bufSize - used) {
+      overflows++;
+      return 0;                   // return failure, ring full
+    }
+
+    char prefix[2] = {levelChars[level], ' '};
+    put(prefix, 2);
+    put(tag, tagLen);
+    put(": ", 2);
+    put(text, textLen);
+    put("\r\n", 2);
+    records++;
+    return 1;
+  }
+
+int SerialLog::add(byte level, const char *tag, const String &text)
+  {
+    return add(level, tag, text.c_str());
+  }
+
+size_t SerialLog::service()
+  {
+    size_t total = 0;
+    while (used && _port) {
+      int room = _port->availableForWrite();
+      if (room <= 0) break;
+      unsigned int n = _bufSize - tail;   // contiguous bytes up to the wrap
+      if (n > used) n = used;
+      if (n > (unsigned int)room) n = room;
+      n = _port->write(buffer + tail, n);
+      if (!n) break;
+      tail = (tail + n) % _bufSize;
+      used -= n;
+      total += n;
+    }
+    bytesOut += total;
+    return total;
+  }
+
+unsigned int SerialLog::pending()
+  {
+    return used;
+  }
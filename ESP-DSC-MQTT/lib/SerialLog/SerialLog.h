@@ -0,0 +1,90 @@
+/*
+  SerialLog.h - Library for logging to a serial port without ever
+  waiting for it
+
+  Records are short text lines, "<level> <tag>: <text>", copied whole
+  into a fixed TX ring. service() then writes only what the port can
+  take without blocking (availableForWrite()), so a long message costs
+  the caller a memcpy rather than the 10+ ms it takes at 115200 baud.
+  A record that does not fit in the ring is dropped and counted.
+
+  Levels can be left out at compile time with SERIAL_LOG_LEVEL (e.g.
+  -DSERIAL_LOG_LEVEL=LOG_WARN in build_flags, the logXxx() macros
+  below then compile to nothing) and filtered at run time with
+  setLevel().
+
+  Released into the public domain.
+
+*/
+
+#ifndef SerialLog_h
+#define SerialLog_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// ----- Log Levels -----
+#define LOG_NONE 0
+#define LOG_ERROR 1
+#define LOG_WARN 2
+#define LOG_INFO 3
+#define LOG_DEBUG 4
+
+#ifndef SERIAL_LOG_LEVEL
+#define SERIAL_LOG_LEVEL LOG_DEBUG    // Most detailed level compiled in
+#endif
+
+#define logError(log, tag, text) do { if (LOG_ERROR <= SERIAL_LOG_LEVEL) (log).add(LOG_ERROR, tag, text); } while (0)
+#define logWarn(log, tag, text)  do { if (LOG_WARN <= SERIAL_LOG_LEVEL) (log).add(LOG_WARN, tag, text); } while (0)
+#define logInfo(log, tag, text)  do { if (LOG_INFO <= SERIAL_LOG_LEVEL) (log).add(LOG_INFO, tag, text); } while (0)
+#define logDebug(log, tag, text) do { if (LOG_DEBUG <= SERIAL_LOG_LEVEL) (log).add(LOG_DEBUG, tag, text); } while (0)
+
+class SerialLog
+{
+  public:
+    // Class to call to initialize the log (before Setup), "bufSize" is the
+    // size of the TX ring in bytes
+    SerialLog(unsigned int bufSize);
+
+    // Allocates the ring (in Setup) and sets the port the records go to
+    // Returns 1 for success, 0 if malloc fails
+    int begin(Print &port);
+
+    // Sets the most detailed level added from now on (LOG_NONE ... LOG_DEBUG)
+    void setLevel(byte level);
+
+    // Returns true if records of "level" are kept, at compile and run time
+    bool enabled(byte level);
+
+    // Copies a record into the ring, never writes to the port
+    // Returns 1 if it was queued, 0 if it was filtered out or did not fit
+    int add(byte level, const char *tag, const char *text);
+    int add(byte level, const char *tag, const String &text);
+
+    // Writes as much of the ring as the port takes without blocking
+    // Included in the main loop, returns the number of bytes written
+    size_t service();
+
+    // Bytes waiting in the ring
+    unsigned int pending();
+
+    unsigned long records;            // Records queued
+    unsigned long overflows;          // Records dropped, the ring was full
+    unsigned long bytesOut;           // Bytes written to the port
+
+  private:
+    void put(const char *data, unsigned int len);
+
+    Print *_port;
+    byte *buffer;
+    unsigned int _bufSize;
+    unsigned int head;                // Where the next byte is added
+    unsigned int tail;                // Next byte to write to the port
+    unsigned int used;
+    byte _level;
+};
+
+#endif
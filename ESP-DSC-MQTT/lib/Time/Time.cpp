@@ -143,20 +143,28 @@ int year(time_t t) { // the year for the given time
 /* functions to convert to and from system time */
 /* These are for interfacing with time serivces and are not normally needed in a sketch */
 
-// leap year calulator expects year argument as years offset from 1970
-#define LEAP_YEAR(Y)     ( ((1970+Y)>0) && !((1970+Y)%4) && ( ((1970+Y)%100) || !((1970+Y)%400) ) )
+void civilFromDays(uint32_t days, int &year, uint8_t &month, uint8_t &day){
+// inverse of daysFromCivil(), for the days a 32 bit time_t can hold
+// years are counted from March, so the leap day is the last day of the year
+
+  uint32_t z = days + 719468;                        // days since Mar 1 0000
+  uint32_t era = z / 146097;                         // 400 year cycle
+  uint32_t doe = z - era * 146097;                   // day of the era [0, 146096]
+  uint32_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365; // year of the era [0, 399]
+  uint32_t doy = doe - (365*yoe + yoe/4 - yoe/100);  // day of the year [0, 365]
+  uint32_t mp = (5*doy + 2) / 153;                   // month, March is 0
+  day = doy - (153*mp + 2)/5 + 1;
+  month = mp < 10 ? mp + 3 : mp - 9;
+  year = yoe + era * 400 + (month <= 2);
+}
 
-static  const uint8_t monthDays[]={31,28,31,30,31,30,31,31,30,31,30,31}; // API starts months from 1, this array starts from 0
- 
 void breakTime(time_t timeInput, tmElements_t &tm){
 // break the given time_t into time components
 // this is a more compact version of the C library localtime function
 // note that year is offset from 1970 !!!
 
-  uint8_t year;
-  uint8_t month, monthLength;
   uint32_t time;
-  unsigned long days;
+  int year;
 
   time = (uint32_t)timeInput;
   tm.Second = time % 60;
@@ -166,39 +174,9 @@ void breakTime(time_t timeInput, tmElements_t &tm){
   tm.Hour = time % 24;
   time /= 24; // now it is days
   tm.Wday = ((time + 4) % 7) + 1;  // Sunday is day 1 
-  
-  year = 0;  
-  days = 0;
-  while((unsigned)(days += (LEAP_YEAR(year) ? 366 : 365)) <= time) {
-    year++;
-  }
-  tm.Year = year; // year is offset from 1970 
-  
-  days -= LEAP_YEAR(year) ? 366 : 365;
-  time  -= days; // now it is days in this year, starting at 0
-  
-  days=0;
-  month=0;
-  monthLength=0;
-  for (month=0; month<12; month++) {
-    if (month==1) { // february
-      if (LEAP_YEAR(year)) {
-        monthLength=29;
-      } else {
-        monthLength=28;
-      }
-    } else {
-      monthLength = monthDays[month];
-    }
-    
-    if (time >= monthLength) {
-      time -= monthLength;
-    } else {
-        break;
-    }
-  }
-  tm.Month = month + 1;  // jan is month 1  
-  tm.Day = time + 1;     // day of month
+
+  civilFromDays(time, year, tm.Month, tm.Day);
+  tm.Year = CalendarYrToTm(year); // year is offset from 1970 
 }
 
 time_t makeTime(tmElements_t &tm){   
@@ -206,31 +184,47 @@ time_t makeTime(tmElements_t &tm){
 // note year argument is offset from 1970 (see macros in time.h to convert to other formats)
 // previous version used full four digit year (or digits since 2000),i.e. 2009 was 2009 or 9
   
-  int i;
   uint32_t seconds;
 
-  // seconds from 1970 till 1 jan 00:00:00 of the given year
-  seconds= tm.Year*(SECS_PER_DAY * 365);
-  for (i = 0; i < tm.Year; i++) {
-    if (LEAP_YEAR(i)) {
-      seconds +=  SECS_PER_DAY;   // add extra days for leap years
-    }
-  }
-  
-  // add days for this year, months start from 1
-  for (i = 1; i < tm.Month; i++) {
-    if ( (i == 2) && LEAP_YEAR(tm.Year)) { 
-      seconds += SECS_PER_DAY * 29;
-    } else {
-      seconds += SECS_PER_DAY * monthDays[i-1];  //monthDay array starts from 0
-    }
-  }
-  seconds+= (tm.Day-1) * SECS_PER_DAY;
+  seconds= (uint32_t)daysFromCivil(tmYearToCalendar(tm.Year), tm.Month, tm.Day) * SECS_PER_DAY;
   seconds+= tm.Hour * SECS_PER_HOUR;
   seconds+= tm.Minute * SECS_PER_MIN;
   seconds+= tm.Second;
   return (time_t)seconds; 
 }
+
+static char *put2(char *p, uint8_t v) {
+  *p++ = '0' + v / 10;
+  *p++ = '0' + v % 10;
+  return p;
+}
+
+size_t formatIso8601(time_t t, char *buf, size_t len) {
+  if (len < ISO8601_LEN) return 0;
+  uint32_t secs = (uint32_t)t;
+  uint32_t days = secs / SECS_PER_DAY;
+  secs -= days * SECS_PER_DAY;
+  int year;
+  uint8_t month, day;
+  civilFromDays(days, year, month, day);
+
+  char *p = buf;
+  p = put2(p, year / 100);
+  p = put2(p, year % 100);
+  *p++ = '-';
+  p = put2(p, month);
+  *p++ = '-';
+  p = put2(p, day);
+  *p++ = 'T';
+  p = put2(p, secs / 3600);
+  *p++ = ':';
+  p = put2(p, (secs / 60) % 60);
+  *p++ = ':';
+  p = put2(p, secs % 60);
+  *p++ = 'Z';
+  *p = 0;
+  return p - buf;
+}
 /*=====================================================*/	
 /* Low level system time functions  */
 
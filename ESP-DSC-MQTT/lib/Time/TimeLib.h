@@ -12,6 +12,7 @@
 #define _Time_h
 
 #include <inttypes.h>
+#include <stddef.h>
 #ifndef __AVR__
 #include <sys/types.h> // for __time_t_defined, but avr libc lacks sys/types.h
 #endif
@@ -138,6 +139,26 @@ void    setSyncInterval(time_t interval); // set the number of seconds between r
 void breakTime(time_t time, tmElements_t &tm);  // break time_t into elements
 time_t makeTime(tmElements_t &tm);  // convert time elements into time_t
 
+/* calendar arithmetic in closed form, no loops over years or months (after Howard Hinnant's
+   days_from_civil/civil_from_days), valid for any Gregorian date from year 0 */
+constexpr int32_t tmEra(int32_t y) { return (y >= 0 ? y : y - 399) / 400; }  // 400 year cycle
+constexpr int32_t tmYearOfEra(int32_t y) { return y - tmEra(y) * 400; }     // [0, 399]
+constexpr int32_t tmDayOfYear(int32_t m, int32_t d) {                       // from Mar 1, [0, 365]
+  return (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+}
+constexpr int32_t tmDaysFromMarch(int32_t y, int32_t m, int32_t d) {        // y starts in March
+  return tmEra(y) * 146097 + tmYearOfEra(y) * 365 + tmYearOfEra(y) / 4 - tmYearOfEra(y) / 100
+         + tmDayOfYear(m, d) - 719468;
+}
+constexpr int32_t daysFromCivil(int32_t year, int32_t month, int32_t day) { // days since Jan 1 1970
+  return tmDaysFromMarch(year - (month <= 2), month, day);
+}
+void civilFromDays(uint32_t days, int &year, uint8_t &month, uint8_t &day); // days since Jan 1 1970 to a date
+
+/* ISO-8601 UTC time stamp, e.g. "2024-05-01T12:34:56Z" */
+#define ISO8601_LEN 21 // buffer size needed, including the terminating null
+size_t formatIso8601(time_t t, char *buf, size_t len); // returns the length written, 0 if buf is too small
+
 } // extern "C++"
 #endif // __cplusplus
 #endif /* _Time_h */
@@ -8,7 +8,13 @@
 #include <WiFiUdp.h>
 #include <Ticker.h>
 #include <AsyncMqttClient.h>
+#include <LittleFS.h>
 #include <DSC.h>
+#include <EventJournal.h>
+#include <EventRing.h>
+#include <EventFanout.h>
+#include <SerialLog.h>
+#include "WebAssets.h"
 
 // Required for LIGHT_SLEEP_T delay mode
 extern "C" {
@@ -28,8 +34,67 @@ const char *ntpServer = "za.pool.ntp.org";
 const char *MQTT_TOPIC = "espdsc/verbose";
 const char *MQTT_ZONE_TOPIC = "espdsc/zone";
 const char *MQTT_STATUS_TOPIC = "espdsc/status";
+const char *MQTT_STATS_TOPIC = "espdsc/stats";
+const char *MQTT_AVAILABILITY_TOPIC = "espdsc/availability";
+const char *MQTT_RULE_TOPIC = "espdsc/rule";
+const char *MQTT_KEYPAD_TOPIC = "espdsc/keypad";
+const char *MQTT_HEALTH_TOPIC = "espdsc/health"; //retained, bus faults
+
+//Retained snapshots of the latest state, republished only on change
+const char *MQTT_STATE_STATUS_TOPIC = "espdsc/state/status";
+const char *MQTT_STATE_ZONES_TOPIC = "espdsc/state/zones";
+const char *MQTT_STATE_ARMED_TOPIC = "espdsc/state/armed";
+const char *MQTT_STATE_TIME_TOPIC = "espdsc/state/time";
 
 #define SLEEP_MS 10 //100ms
+#define LOG_BYTES 2048 //serial TX ring, records that do not fit are dropped (see SerialLog.h)
+#define STATS_INTERVAL_MS 60000 //traffic digest every minute
+
+//Uncomment to trace the latency of each pipeline stage, from the last bit of a
+//panel word to the broker's ack, as histograms in /stats
+//#define MEASURE_LATENCY
+
+//Uncomment to report free heap, largest free block and fragmentation in /stats,
+//and count the keybus words after which the hot path held on to more heap
+//(the host test test/test_alloc.cpp covers the library; this also covers publishing)
+//#define REPORT_HEAP
+
+//Zone debounce: a change is passed on once held this long, and a zone flipping
+//more than ZONE_MAX_FLIPS times in ZONE_WINDOW_MS is reported as chattering
+#define ZONE_HOLD_MS 500
+#define ZONE_MAX_FLIPS 6
+#define ZONE_WINDOW_MS 10000
+
+//Longest gap between the keys of one keypad action, see DSC_Keys.h
+#define KEY_TIMEOUT_MS 4000
+
+//Local reactions, evaluated on the device after every keybus word (see DSC_Rules.h)
+//e.g. "open 3 armed > pulse 14 2000" or "key panic > publish 1"
+const char *RULES[] = {
+  "key panic > publish 1",
+  "key fire > publish 2",
+};
+
+//Decoded state kept in RTC user memory across a soft reset, watchdog reset or OTA
+//(the first 128 bytes of it are used by OTA updates, so it starts after them)
+#define RTC_STATE_BLOCK 32    //4 byte blocks
+#define RTC_STATE_MAGIC 0xD5C50001
+
+#define JOURNAL_DIR "/journal" //one file per page, see FSJournalStorage
+#define JOURNAL_PAGES 64      //32KB of flash, ~960 events
+#define JOURNAL_FLUSH_MS 30000 //longest an event waits in RAM before it is written
+#define EVENTS_MAX 32         //most events returned by one /events request
+#define RECENT_BYTES 4096     //RAM ring of the latest events, see /events?since=
+
+//Decoded events wait in one ring for each output (sink) to take them, so a slow or
+//disconnected one never holds up the keybus, see EventFanout.h. Words decoded before
+//MQTT (and NTP) are up wait there too, for at most PRECONNECT_NTP_WAIT_MS after connecting
+#define FANOUT_BYTES 6144
+#define PRECONNECT_NTP_WAIT_MS 10000
+
+//Uncomment to also send every event to a syslog server over UDP
+//#define SYSLOG_HOST IPAddress(192, 168, 0, 6)
+#define SYSLOG_PORT 514
 
 #define CLK_PIN 4
 #define DATA_PIN 5
@@ -47,7 +112,94 @@ NTPClient timeClient(ntpUDP, ntpServer, 7200);
 ESP8266WebServer server(80);
 ESP8266HTTPUpdateServer httpUpdater;
 
-String webString = "";
+//Latest decoded panel word, rendered to JSON by renderJson() on demand
+#define MSG_LEN 320
+struct
+{
+  unsigned long epoch;
+  byte cmd;
+  char raw[INFO_LEN];
+  char msg[MSG_LEN];
+} lastWord;
+uint32_t bootId = 0;            //random per boot, so versions and cursors of an earlier boot never match
+unsigned long stateVersion = 0; //bumped for every decoded panel word
+unsigned long jsonVersion = 0;  //stateVersion jsonBuf was rendered from
+TextBuffer jsonBuf(INFO_LEN + MSG_LEN + 128);
+const char *httpHeaders[] = {"If-None-Match"};
+
+//Flash journal of every decoded word
+FSJournalStorage journalStorage(LittleFS, JOURNAL_DIR, JOURNAL_PAGES);
+EventJournal journal(journalStorage, JOURNAL_FLUSH_MS);
+bool journalMounted = false;
+journalEvent_t eventsBuf[EVENTS_MAX];
+
+//Latest decoded events in RAM, numbered for /events?since=<seq>
+EventRing recent(RECENT_BYTES);
+ringEvent_t recentBuf[EVENTS_MAX];
+
+//Serial output, written out only as fast as the UART takes it
+SerialLog logger(LOG_BYTES);
+
+//Decoded events waiting for the sinks (MQTT, serial, syslog), see the writeXxx() functions
+EventFanout fanout(FANOUT_BYTES);
+
+//Last content seen per panel command, so a word repeated as is is not passed on again
+#define RECENT_CMDS 16
+struct lastCmds_t
+{
+  struct
+  {
+    byte cmd;
+    uint32_t crc;
+  } last[RECENT_CMDS];
+  byte used;
+};
+lastCmds_t recentLast = {}; //Messages recorded in RAM, see recordWord()
+lastCmds_t journalLast = {}; //Words kept in the journal, see handleKeybus()
+
+//Last snapshot payloads, see updateSnapshots()
+String snapStatus = "";
+String snapZones = "";
+unsigned long zoneVersion = 0;  //zone filter version in snapZones
+String snapArmed = "";
+String snapTime = "";
+String snapHealth = "";
+
+//Warm restart snapshot, see saveRtcState()
+struct
+{
+  uint32_t magic;
+  uint32_t crc;
+  dscSnapshot_t snap;
+} rtcState;
+
+//Boot timings, millis() (0 until it happens)
+unsigned long bootFirstFrame = 0;
+unsigned long bootWifi = 0;
+unsigned long bootMqtt = 0;
+unsigned long bootFirstPublish = 0;
+unsigned long mqttSince = 0; //millis() of the last MQTT connect
+
+//Keybus traffic digest, see buildStats()
+TextBuffer statsBuf(3072);
+unsigned long lastStats = 0;
+
+#ifdef REPORT_HEAP
+//Free heap around process(), decoding, journalling and captureWord()
+uint32_t heapMinFree = 0xFFFFFFFF;
+unsigned long heapWords = 0;
+unsigned long heapGrowth = 0;
+
+void recordHeap(uint32_t before)
+{
+  uint32_t after = ESP.getFreeHeap();
+  heapWords++;
+  if (after < before)
+    heapGrowth++;
+  if (after < heapMinFree)
+    heapMinFree = after;
+}
+#endif
 
 AsyncMqttClient mqttClient;
 Ticker mqttReconnectTimer;
@@ -56,7 +208,207 @@ WiFiEventHandler wifiConnectHandler;
 WiFiEventHandler wifiDisconnectHandler;
 Ticker wifiReconnectTimer;
 
-DSC dsc;
+//Clock and data pins fixed at compile time, the ISR reads them straight from the GPIO register
+DSCBus<CLK_PIN, DATA_PIN> dsc;
+DSCRules rules;
+
+#ifdef MEASURE_LATENCY
+//Per-stage latency of panel words, in microseconds
+DSCHistogram latPickup;  //last bit (ISR) to process() picking the word up
+DSCHistogram latDecode;  //pick up to decoding done
+DSCHistogram latPublish; //decoding done to mqttClient.publish() returning
+DSCHistogram latAck;     //publish to the broker's ack (QoS 1 publishes only)
+DSCHistogram latTotal;   //last bit to the broker's ack
+
+//Times of the panel words queued for the sinks, by fan-out seq, so a word the
+//MQTT sink publishes late (held back, or behind a backlog) is timed from its own frame
+#define TRACE_WORDS 16
+struct wordTrace_t
+{
+  uint32_t seq; //fan-out seq of the word, 0 if the slot is free
+  uint32_t frameSeq;
+  unsigned long frameEnd;
+  unsigned long decoded;
+} traceWords[TRACE_WORDS];
+uint32_t traceFrame = 0; //frameSeq of the last word timed to its publish
+
+//QoS 1 publishes waiting for their ack, oldest overwritten first
+#define TRACE_PENDING 8
+struct
+{
+  uint16_t packetId;
+  unsigned long frameEnd;
+  unsigned long published;
+} tracePending[TRACE_PENDING];
+byte traceNext = 0;
+
+void traceWord()
+{
+  latPickup.record(dsc.state.pickup - dsc.state.frameEnd);
+  latDecode.record(dsc.state.decoded - dsc.state.pickup);
+}
+
+//Keeps the times of the word just decoded with "seq", the event it was queued as
+void traceQueued(uint32_t seq)
+{
+  if (!seq)
+    return;
+  wordTrace_t &t = traceWords[seq % TRACE_WORDS];
+  t.seq = seq;
+  t.frameSeq = dsc.state.frameSeq;
+  t.frameEnd = dsc.state.frameEnd;
+  t.decoded = dsc.state.decoded;
+}
+
+//The MQTT sink published event "seq", packetId is 0 for a QoS 0 publish (never acked)
+//Words whose times were overwritten (more than TRACE_WORDS events behind) are not timed
+void tracePublish(uint32_t seq, uint16_t packetId)
+{
+  wordTrace_t &t = traceWords[seq % TRACE_WORDS];
+  if (t.seq != seq)
+    return;
+  t.seq = 0;
+  unsigned long now = micros();
+  latPublish.record(now - t.decoded);
+  traceFrame = t.frameSeq;
+  if (!packetId)
+    return;
+  tracePending[traceNext].packetId = packetId;
+  tracePending[traceNext].frameEnd = t.frameEnd;
+  tracePending[traceNext].published = now;
+  traceNext = (traceNext + 1) % TRACE_PENDING;
+}
+
+void traceAck(uint16_t packetId)
+{
+  unsigned long now = micros();
+  for (byte i = 0; i < TRACE_PENDING; i++)
+  {
+    if (tracePending[i].packetId != packetId)
+      continue;
+    latAck.record(now - tracePending[i].published);
+    latTotal.record(now - tracePending[i].frameEnd);
+    tracePending[i].packetId = 0;
+    return;
+  }
+}
+#endif
+
+//The JSON of a panel event, with the time worked back from when it was decoded
+//(and how late it is, if it waited), or the uptime if NTP has not synced
+String stampedJson(const ringEvent_t &e)
+{
+  unsigned long age = millis() - e.time;
+  String json = "{";
+  if (timeSynced())
+  {
+    unsigned long epoch = timeClient.getEpochTime() - age / 1000;
+    char t[12];
+    snprintf(t, sizeof(t), "%02lu:%02lu:%02lu", (epoch % 86400L) / 3600, (epoch % 3600) / 60, epoch % 60);
+    json += "\"Time\":\"" + String(t) + "\",\"EpochSeconds\":" + String(epoch) + ",";
+  }
+  else
+  {
+    json += "\"UptimeMs\":" + String(e.time) + ",";
+  }
+  if (age >= 1000)
+    json += "\"DelayedMs\":" + String(age) + ",";
+  json += e.text;
+  json += "}";
+  return json;
+}
+
+uint32_t statusSeq = 0;  //event whose status copy went out, see writeMqtt()
+uint16_t statusAck = 0;  //its packet id
+
+//MQTT sink: panel words on the verbose topic (and the status topic for status words),
+//zone changes and keypad actions on theirs
+bool writeMqtt(const ringEvent_t &e)
+{
+  if (e.type == 'Z')
+    return mqttClient.publish(MQTT_ZONE_TOPIC, 1, false, e.text) != 0;
+  if (e.type == 'K')
+    return mqttClient.publish(MQTT_KEYPAD_TOPIC, 1, false, e.text) != 0;
+
+  //The QoS1 status copy goes first and only once per event: a refused event is
+  //retried by the sink, and neither copy may reach subscribers twice
+  String json = stampedJson(e);
+  if (((e.cmd == 0x05) || (e.cmd == 0xA5)) && (statusSeq != e.seq)) //Status
+  {
+    uint16_t id = mqttClient.publish(MQTT_STATUS_TOPIC, 1, false, json.c_str());
+    if (!id)
+      return false; //Nothing went out, the sink retries the whole event
+    statusSeq = e.seq;
+    statusAck = id;
+  }
+  if (!mqttClient.publish(MQTT_TOPIC, 0, false, json.c_str()))
+    return false; //Retried, without the status copy
+  if (!bootFirstPublish)
+    bootFirstPublish = millis();
+  uint16_t ackId = (statusSeq == e.seq) ? statusAck : 0;
+#ifdef MEASURE_LATENCY
+  tracePublish(e.seq, ackId);
+#endif
+  return true;
+}
+
+//Held back after connecting until NTP has synced, so the times can be worked back
+bool mqttReady()
+{
+  return mqttConnected && (timeSynced() || (millis() - mqttSince >= PRECONNECT_NTP_WAIT_MS));
+}
+
+//Serial sink: refuses the event while the log's TX ring is full, so it waits in the fan-out
+bool writeSerial(const ringEvent_t &e)
+{
+  if (!logger.enabled(LOG_INFO))
+    return true;
+  if (e.type == 'P')
+    return logger.add(LOG_INFO, "dsc", stampedJson(e));
+  return logger.add(LOG_INFO, (e.type == 'Z') ? "zone" : "key", e.text);
+}
+
+#ifdef SYSLOG_HOST
+WiFiUDP syslogUDP;
+
+bool writeSyslog(const ringEvent_t &e)
+{
+  if (!syslogUDP.beginPacket(SYSLOG_HOST, SYSLOG_PORT))
+    return false;
+  syslogUDP.print("<134>"); //local0.info
+  syslogUDP.print(host);
+  syslogUDP.print(" dsc: ");
+  syslogUDP.print(e.type == 'P' ? stampedJson(e) : String(e.text));
+  return syslogUDP.endPacket();
+}
+
+bool syslogReady()
+{
+  return wifiConnected;
+}
+#endif
+
+EventSink mqttSink(writeMqtt, mqttReady);
+EventSink serialSink(writeSerial);
+#ifdef SYSLOG_HOST
+EventSink syslogSink(writeSyslog, syslogReady);
+#endif
+
+//[written, dropped, coalesced, refused, backlog]
+void printSink(EventSink &sink)
+{
+  statsBuf.print('[');
+  statsBuf.print(sink.written);
+  statsBuf.print(',');
+  statsBuf.print(sink.dropped);
+  statsBuf.print(',');
+  statsBuf.print(sink.coalesced);
+  statsBuf.print(',');
+  statsBuf.print(sink.refused);
+  statsBuf.print(',');
+  statsBuf.print(fanout.backlog(sink));
+  statsBuf.print(']');
+}
 
 void connectToWifi()
 {
@@ -71,6 +423,8 @@ void onWifiConnect(const WiFiEventStationModeGotIP &event)
 {
   //Serial.println("Connected to Wi-Fi.");
   wifiConnected = true;
+  if (!bootWifi)
+    bootWifi = millis();
   connectToMqtt();
 }
 
@@ -91,6 +445,17 @@ void connectToMqtt()
 void onMqttConnect(bool sessionPresent)
 {
   mqttConnected = true;
+  mqttSince = millis();
+  if (!bootMqtt)
+    bootMqtt = mqttSince;
+
+  //Announce ourselves and give new subscribers the full state in one go
+  mqttClient.publish(MQTT_AVAILABILITY_TOPIC, 1, true, "online");
+  publishSnapshot(MQTT_STATE_STATUS_TOPIC, snapStatus);
+  publishSnapshot(MQTT_STATE_ZONES_TOPIC, snapZones);
+  publishSnapshot(MQTT_STATE_ARMED_TOPIC, snapArmed);
+  publishSnapshot(MQTT_STATE_TIME_TOPIC, snapTime);
+  publishSnapshot(MQTT_HEALTH_TOPIC, snapHealth);
 }
 
 void onMqttDisconnect(AsyncMqttClientDisconnectReason reason)
@@ -126,11 +491,598 @@ void onMqttMessage(char *topic, char *payload, AsyncMqttClientMessageProperties
   //  Serial.println(total);
 }
 
-void onMqttPublish(uint16_t packetId) {}
+void onMqttPublish(uint16_t packetId)
+{
+#ifdef MEASURE_LATENCY
+  traceAck(packetId);
+#endif
+}
+
+//Publish action of a rule, sent ahead of everything else the word produces
+void onRule(const dscRule_t &rule)
+{
+  if (!mqttConnected)
+    return;
+  String msg = "{\"Rule\":" + String(rule.target) + "}";
+  mqttClient.publish(MQTT_RULE_TOPIC, 1, false, msg.c_str());
+}
+
+void publishSnapshot(const char *topic, const String &payload)
+{
+  if (mqttConnected && payload.length())
+  {
+    mqttClient.publish(topic, 1, true, payload.c_str());
+  }
+}
+
+//Replaces a snapshot and publishes it (retained) if it changed
+void updateSnapshot(const char *topic, String &snapshot, const String &payload)
+{
+  if (payload == snapshot)
+    return;
+  snapshot = payload;
+  publishSnapshot(topic, snapshot);
+}
+
+void updateSnapshots()
+{
+  if (dsc.state.pCmd == 0x05)
+  {
+    updateSnapshot(MQTT_STATE_STATUS_TOPIC, snapStatus, dsc.state.pMsg);
+  }
+  else if (dsc.state.pCmd == 0xA5)
+  {
+    updateSnapshot(MQTT_STATE_TIME_TOPIC, snapTime,
+                   "{\"PanelDateTime\":\"20" + String(dsc.yy) + "/" + String(dsc.mm) + "/" + String(dsc.dd) +
+                   " " + String(dsc.HH) + ":" + String(dsc.MM) + "\"}");
+  }
+
+  //Armed from the 0x05 Armed light, the code that armed it from 0xA5
+  if (((dsc.state.pCmd == 0x05) || (dsc.state.pCmd == 0xA5)) && (dsc.state.armed != 0xff))
+  {
+    updateSnapshot(MQTT_STATE_ARMED_TOPIC, snapArmed,
+                   "{\"Armed\":" + String(dsc.state.armed) + ",\"UserCode\":" + String(dsc.state.armUser) + "}");
+  }
+}
+
+bool isZoneWord(byte cmd)
+{
+  return (cmd == 0x27) || (cmd == 0x2D) || (cmd == 0x34) || (cmd == 0x3E);
+}
+
+//Appends the zone numbers set in "bits" as a JSON list, e.g. [3,17]
+void appendZones(String &out, const byte *bits)
+{
+  out += "[";
+  bool first = true;
+  for (int i = 0; i < ZONE_GROUPS * 8; i++)
+  {
+    if (bits[i / 8] & (1 << (i % 8)))
+    {
+      if (!first)
+        out += ",";
+      out += String(i + 1);
+      first = false;
+    }
+  }
+  out += "]";
+}
+
+//Debounced zones, e.g. {"Open":[3,17],"Chatter":[5]}, published on any filter change
+void updateZones()
+{
+  if (dsc.zoneFilter.version == zoneVersion)
+    return;
+  zoneVersion = dsc.zoneFilter.version;
+  String zones = "{\"Open\":";
+  appendZones(zones, dsc.zoneFilter.zones);
+  zones += ",\"Chatter\":";
+  appendZones(zones, dsc.zoneFilter.chatter);
+  zones += "}";
+  if (zones != snapZones)
+    fanout.publish(millis(), 'Z', 0, FANOUT_STATE, zones.c_str());
+  updateSnapshot(MQTT_STATE_ZONES_TOPIC, snapZones, zones);
+  recordEvent('Z', 0, zones.c_str());
+  saveRtcState();
+}
+
+//Checkpoints the decoded state into RTC user memory, with a CRC
+void saveRtcState()
+{
+  dsc.saveState(rtcState.snap);
+  rtcState.magic = RTC_STATE_MAGIC;
+  rtcState.crc = EventJournal::crc32((const uint8_t *)&rtcState.snap, sizeof(rtcState.snap));
+  ESP.rtcUserMemoryWrite(RTC_STATE_BLOCK, (uint32_t *)&rtcState, sizeof(rtcState));
+}
+
+//Restores the state saved before a restart, if RTC memory holds a valid one
+//(it does not after a power cycle). Called before dsc.begin(), so the clock
+//ISR's frame count is not written under it
+bool loadRtcState()
+{
+  if (!ESP.rtcUserMemoryRead(RTC_STATE_BLOCK, (uint32_t *)&rtcState, sizeof(rtcState)))
+    return false;
+  if (rtcState.magic != RTC_STATE_MAGIC ||
+      rtcState.crc != EventJournal::crc32((const uint8_t *)&rtcState.snap, sizeof(rtcState.snap)))
+    return false;
+
+  dsc.restoreState(rtcState.snap);
+  return true;
+}
+
+//Rebuilds the snapshots from the words restored by loadRtcState(), after dsc.begin()
+void replayRtcState()
+{
+  for (byte i = 0; i < SNAP_WORDS; i++)
+  {
+    if (!dsc.restoreWord(i))
+      continue;
+    captureWord();
+    updateSnapshots();
+  }
+  updateZones();
+}
+
+//Copies what the JSON body is made of, without rendering it
+void captureWord()
+{
+  lastWord.epoch = timeClient.getEpochTime();
+  lastWord.cmd = dsc.state.pCmd;
+  strncpy(lastWord.raw, dsc.pnlRaw(), sizeof(lastWord.raw) - 1);
+  strncpy(lastWord.msg, dsc.state.pMsg.c_str(), sizeof(lastWord.msg) - 1);
+  stateVersion++;
+}
+
+void print2(Print &out, unsigned long v)
+{
+  if (v < 10)
+    out.print('0');
+  out.print(v);
+}
+
+//Renders the latest word into jsonBuf, only if it changed since the last render
+const char *renderJson()
+{
+  if (jsonVersion == stateVersion && jsonBuf.getSize())
+    return jsonBuf.getBuffer();
+  jsonVersion = stateVersion;
+
+  jsonBuf.clear();
+  unsigned long epoch = stateVersion ? lastWord.epoch : timeClient.getEpochTime();
+  jsonBuf.print("{\"Time\":\"");
+  print2(jsonBuf, (epoch % 86400L) / 3600);
+  jsonBuf.print(':');
+  print2(jsonBuf, (epoch % 3600) / 60);
+  jsonBuf.print(':');
+  print2(jsonBuf, epoch % 60);
+  if (!stateVersion)
+  {
+    jsonBuf.print("\",\"Message\":\"Nothing received yet...\"}");
+    return jsonBuf.getBuffer();
+  }
+  jsonBuf.print("\",\"EpochSeconds\":");
+  jsonBuf.print(epoch);
+  jsonBuf.print(",\"PanelRaw\":\"");
+  jsonBuf.print(lastWord.raw);
+  jsonBuf.print("\",\"PanelCommandHex\":\"");
+  jsonBuf.print(lastWord.cmd, HEX);
+  jsonBuf.print("\",\"PanelMessage\":");
+  jsonBuf.print(lastWord.msg);
+  jsonBuf.print("}");
+  return jsonBuf.getBuffer();
+}
+
+//Returns true (and answers 304) if the client already has this ETag
+bool notModified(const char *etag)
+{
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match") == etag)
+  {
+    server.send(304);
+    return true;
+  }
+  return false;
+}
 
 void handleRoot()
 {
-  server.send(200, "text/html", "<html> <head> <meta http-equiv='refresh' content='1'/> <title>ESP-DSC-MQTT</title> <style>body{background-color: #cccccc; font-family: Arial, Helvetica, Sans-Serif; Color: #000088;}</style> </head> <body> <p>" + webString + "</p></body></html>");
+  if (notModified(INDEX_HTML_ETAG))
+    return;
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, "text/html", (PGM_P)INDEX_HTML_GZ, INDEX_HTML_GZ_LEN);
+}
+
+void handleJson()
+{
+  char etag[24];
+  snprintf(etag, sizeof(etag), "\"%08lx-v%lu\"", (unsigned long)bootId, stateVersion);
+  if (notModified(etag))
+    return;
+  server.send(200, "application/json", renderJson());
+}
+
+void buildStats()
+{
+  statsBuf.clear();
+  statsBuf.print("{\"Uptime\":");
+  statsBuf.print(millis());
+  statsBuf.print(",\"Panel\":");
+  dsc.pStats.printDigest(statsBuf);
+  statsBuf.print(",\"Keypad\":");
+  dsc.kStats.printDigest(statsBuf);
+  statsBuf.print(",\"Overruns\":");
+  statsBuf.print(dsc.state.overruns);
+  statsBuf.print(",\"ZoneFlipsSuppressed\":");
+  statsBuf.print(dsc.zoneFilter.suppressed);
+  statsBuf.print(",\"ZoneChatterEvents\":");
+  statsBuf.print(dsc.zoneFilter.chatterEvents);
+  statsBuf.print(",\"Health\":{\"Faults\":");
+  statsBuf.print(dsc.health.faults);
+  statsBuf.print(",\"Raised\":");
+  statsBuf.print(dsc.health.raised);
+  statsBuf.print(",\"EdgesPerSec\":");
+  statsBuf.print(dsc.health.edgeRate);
+  statsBuf.print(",\"FramingErrors\":");
+  statsBuf.print(dsc.state.framingErrors);
+  statsBuf.print("}");
+  statsBuf.print(",\"KeypadKeys\":");
+  statsBuf.print(dsc.keySequence.keys);
+  statsBuf.print(",\"KeypadActions\":");
+  statsBuf.print(dsc.keySequence.actions);
+  statsBuf.print(",\"Boot\":{\"FirstFrameMs\":");
+  statsBuf.print(bootFirstFrame);
+  statsBuf.print(",\"WiFiMs\":");
+  statsBuf.print(bootWifi);
+  statsBuf.print(",\"MqttMs\":");
+  statsBuf.print(bootMqtt);
+  statsBuf.print(",\"FirstPublishMs\":");
+  statsBuf.print(bootFirstPublish);
+  statsBuf.print("},\"Log\":{\"Records\":");
+  statsBuf.print(logger.records);
+  statsBuf.print(",\"Overflows\":");
+  statsBuf.print(logger.overflows);
+  statsBuf.print(",\"Pending\":");
+  statsBuf.print(logger.pending());
+  statsBuf.print("},\"Journal\":{\"Mounted\":");
+  statsBuf.print(journalMounted ? "true" : "false");
+  statsBuf.print(",\"Next\":");
+  statsBuf.print(journal.nextSeq());
+  statsBuf.print(",\"PageWrites\":");
+  statsBuf.print(journal.pageWrites);
+  statsBuf.print(",\"WriteErrors\":");
+  statsBuf.print(journal.writeErrors);
+  statsBuf.print(",\"Dropped\":");
+  statsBuf.print(journal.dropped);
+  statsBuf.print(",\"WriteUs\":");
+  statsBuf.print(journal.writeUs);
+  statsBuf.print(",\"WriteMaxUs\":");
+  statsBuf.print(journal.writeMaxUs);
+  statsBuf.print("},\"Sinks\":{\"Mqtt\":");
+  printSink(mqttSink);
+  statsBuf.print(",\"Serial\":");
+  printSink(serialSink);
+#ifdef SYSLOG_HOST
+  statsBuf.print(",\"Syslog\":");
+  printSink(syslogSink);
+#endif
+  statsBuf.print("}");
+#ifdef MEASURE_LATENCY
+  statsBuf.print(",\"LatencyUs\":{\"Frame\":");
+  statsBuf.print(traceFrame);
+  statsBuf.print(",\"Pickup\":");
+  latPickup.printJson(statsBuf);
+  statsBuf.print(",\"Decode\":");
+  latDecode.printJson(statsBuf);
+  statsBuf.print(",\"Publish\":");
+  latPublish.printJson(statsBuf);
+  statsBuf.print(",\"Ack\":");
+  latAck.printJson(statsBuf);
+  statsBuf.print(",\"Total\":");
+  latTotal.printJson(statsBuf);
+  statsBuf.print("}");
+#endif
+#ifdef REPORT_HEAP
+  statsBuf.print(",\"Heap\":{\"Free\":");
+  statsBuf.print(ESP.getFreeHeap());
+  statsBuf.print(",\"MinFree\":");
+  statsBuf.print(heapMinFree);
+  statsBuf.print(",\"MaxBlock\":");
+  statsBuf.print(ESP.getMaxFreeBlockSize());
+  statsBuf.print(",\"FragPct\":");
+  statsBuf.print(ESP.getHeapFragmentation());
+  statsBuf.print(",\"Words\":");
+  statsBuf.print(heapWords);
+  statsBuf.print(",\"Growth\":");
+  statsBuf.print(heapGrowth);
+  statsBuf.print("}");
+#endif
+  statsBuf.print("}");
+}
+
+void handleStats()
+{
+  buildStats();
+  server.send(200, "application/json", statsBuf.getBuffer());
+}
+
+//NTPClient counts from 0 until its first sync
+bool timeSynced()
+{
+  return timeClient.getEpochTime() > 1500000000UL;
+}
+
+//Journal time stamp: epoch seconds once NTP has synced, else uptime seconds
+uint32_t journalTime(uint8_t &flags)
+{
+  if (timeSynced())
+    return timeClient.getEpochTime();
+  flags |= JOURNAL_FLAG_UPTIME;
+  return millis() / 1000;
+}
+
+void journalWord(const String &word, uint8_t flags)
+{
+  if (!journalMounted)
+    return;
+  uint32_t t = journalTime(flags);
+  journal.add(t, millis(), flags, word.c_str(), word.length());
+}
+
+//Queues the panel word just decoded for the sinks, as the body of the verbose JSON
+//Returns its fan-out seq, 0 if it was not queued
+uint32_t queueWord()
+{
+  String body = "\"PanelRaw\":\"" + String(lastWord.raw) + "\",\"PanelCommandHex\":\"" + String(lastWord.cmd, HEX) +
+                "\",\"PanelMessage\":" + String(lastWord.msg);
+  return fanout.publish(millis(), 'P', lastWord.cmd, FANOUT_STATE, body.c_str());
+}
+
+//Decodes the oldest queued keybus word, if any, and passes it on
+//Returns false once the queue is empty
+bool handleKeybus()
+{
+  bool queued = dsc.state.frames.front() != NULL;
+#ifdef REPORT_HEAP
+  uint32_t heapBefore = ESP.getFreeHeap();
+#endif
+  bool word = dsc.process();
+
+  //Local reactions first, within the same pass as the word that triggers them
+  rules.evaluate(dsc, millis());
+
+  if (queued && !bootFirstFrame)
+    bootFirstFrame = dsc.state.frameEnd / 1000;
+
+  if (word)
+  {
+    if (dsc.state.kCmd && !isDigitKey())
+    {
+      journalWord(dsc.state.kWord, JOURNAL_FLAG_KEYPAD);
+    }
+
+    if (dsc.state.pCmd)
+    {
+      //Only when the word differs from the last one with its command (the panel
+      //repeats its status and zones words every few seconds)
+      if (cmdChanged(journalLast, dsc.state.pCmd, dsc.state.pWord))
+        journalWord(dsc.state.pWord, 0);
+
+      captureWord();
+#ifdef MEASURE_LATENCY
+      traceWord();
+#endif
+#ifdef REPORT_HEAP
+      recordHeap(heapBefore);
+#endif
+
+      updateSnapshots();
+      saveRtcState();
+
+      //Zone words go through the zone filter instead, see updateZones()
+      //Until the buffer has drained, new words queue up behind it to keep their order
+      if (!isZoneWord(dsc.state.pCmd))
+      {
+        recordWord();
+#ifdef MEASURE_LATENCY
+        traceQueued(queueWord());
+#else
+        queueWord();
+#endif
+      }
+    }
+  }
+
+  //Zone changes are passed on by the filter after their hold time, not only on new words
+  updateZones();
+  publishKeys();
+  updateHealth();
+  return queued;
+}
+
+//Bus faults, e.g. {"Faults":["ClockLost"],"Worst":"ClockLost","EdgesPerSec":0,"FramingPerSec":0}
+//published straight away (retained), ahead of the events waiting in the fan-out
+void updateHealth()
+{
+  static unsigned long version = 0;
+  if (dsc.health.version == version)
+    return;
+  version = dsc.health.version;
+
+  String json = "{\"Faults\":[";
+  bool first = true;
+  for (byte f = 1; f; f <<= 1)
+  {
+    if (!(dsc.health.faults & f))
+      continue;
+    if (!first)
+      json += ",";
+    json += "\"" + String(DSCHealth::name(f)) + "\"";
+    first = false;
+  }
+  json += "],\"Worst\":\"" + String(DSCHealth::name(dsc.health.worst())) + "\"";
+  if (dsc.health.faults & HEALTH_DATA_STUCK)
+    json += ",\"DataLevel\":" + String(dsc.health.stuckLevel);
+  json += ",\"EdgesPerSec\":" + String(dsc.health.edgeRate) + ",\"FramingPerSec\":" + String(dsc.health.framingRate) + "}";
+
+  updateSnapshot(MQTT_HEALTH_TOPIC, snapHealth, json);
+  recordEvent('H', 0, json.c_str());
+  if (dsc.health.faults)
+    logWarn(logger, "bus", json);
+  else
+    logInfo(logger, "bus", json);
+}
+
+//One message per keypad action, e.g. {"Action":"Away","Keys":"xxxxA","Digits":4,"Ms":1830}
+void publishKeys()
+{
+  dscKeyAction_t action;
+  while (dsc.keySequence.next(action))
+  {
+    String json = "{\"Action\":\"" + String(DSCKeySequence::name(action)) + "\",\"Keys\":\"" + String(action.keys) +
+                  "\",\"Digits\":" + String(action.digits) + ",\"Ms\":" + String(action.end - action.start) + "}";
+    recordEvent('K', 0, json.c_str());
+    fanout.publish(millis(), 'K', 0, 0, json.c_str());
+  }
+}
+
+//Digit keys are left out of the journal, so /events does not give codes away
+bool isDigitKey()
+{
+  if (dsc.state.kCmd != kOut)
+    return false;
+  byte key = dsc.binToInt(dsc.state.kWord, 8, 8);
+  return (key == zero) || (key >= one && key <= nine);
+}
+
+//Drains the keybus queue, called between the slow steps of setup()
+void pumpKeybus()
+{
+  while (handleKeybus())
+    ;
+  logger.service();
+}
+
+//Adds an event to the RAM ring, time stamped like the journal
+void recordEvent(char type, byte cmd, const char *json)
+{
+  uint8_t flags = 0;
+  uint32_t t = journalTime(flags);
+  recent.add(t, type, cmd, flags, json);
+}
+
+//Returns true if "text" differs from the last one kept in "t" for command "cmd", and keeps it
+bool cmdChanged(lastCmds_t &t, byte cmd, const String &text)
+{
+  uint32_t crc = EventJournal::crc32((const uint8_t *)text.c_str(), text.length());
+  byte i = 0;
+  while (i < t.used && t.last[i].cmd != cmd)
+    i++;
+  if (i < t.used && t.last[i].crc == crc)
+    return false;
+  if (i == RECENT_CMDS)
+    i = cmd % RECENT_CMDS; //table full, reuse a slot
+  else if (i == t.used)
+    t.used++;
+  t.last[i].cmd = cmd;
+  t.last[i].crc = crc;
+  return true;
+}
+
+//Records the panel word just decoded, unless it is the same as the last one with its command
+void recordWord()
+{
+  if (cmdChanged(recentLast, dsc.state.pCmd, dsc.state.pMsg))
+    recordEvent('P', dsc.state.pCmd, dsc.state.pMsg.c_str());
+}
+
+// /events?since=<seq>&boot=<id>&max=<n> returns the events in RAM after the client's
+// cursor, with "Gap":true when some of them were dropped, or the cursor's "Boot" is
+// not this boot's (the numbers start again at 1 on every boot)
+void handleRecent()
+{
+  uint32_t since = strtoul(server.arg("since").c_str(), NULL, 10);
+  uint32_t boot = server.hasArg("boot") ? strtoul(server.arg("boot").c_str(), NULL, 16) : bootId;
+  size_t limit = EVENTS_MAX;
+  if (server.hasArg("max"))
+    limit = constrain(server.arg("max").toInt(), 1, EVENTS_MAX);
+
+  bool gap;
+  size_t n = recent.readCursor(boot, since, recentBuf, limit, gap);
+  uint32_t next = n ? recentBuf[n - 1].seq : recent.nextSeq() - 1;
+
+  char id[9];
+  snprintf(id, sizeof(id), "%08lx", (unsigned long)bootId);
+  String json = "{\"Boot\":\"" + String(id) + "\",\"Next\":" + String(next);
+  if (gap)
+    json += ",\"Gap\":true";
+  json += ",\"Events\":[";
+  for (size_t i = 0; i < n; i++)
+  {
+    ringEvent_t &e = recentBuf[i];
+    if (i)
+      json += ",";
+    json += "{\"Seq\":" + String(e.seq) + ",\"Time\":" + String(e.time);
+    if (e.flags & JOURNAL_FLAG_UPTIME)
+      json += ",\"Uptime\":1";
+    if (e.type == 'P')
+      json += ",\"Cmd\":\"" + String(e.cmd, HEX) + "\",\"Panel\":";
+    else
+      json += (e.type == 'Z') ? ",\"Zones\":" : (e.type == 'H') ? ",\"Health\":" : ",\"Keypad\":";
+    json += e.text;
+    json += "}";
+  }
+  json += "]}";
+  server.send(200, "application/json", json);
+}
+
+// /events?from=<seq>&max=<n> returns the journalled words from seq onwards
+void handleEvents()
+{
+  if (server.hasArg("since"))
+  {
+    handleRecent();
+    return;
+  }
+  if (!journalMounted)
+  {
+    server.send(503, "text/plain", "Journal not mounted");
+    return;
+  }
+
+  uint32_t from = journal.firstSeq();
+  if (server.hasArg("from"))
+    from = strtoul(server.arg("from").c_str(), NULL, 10);
+  size_t limit = EVENTS_MAX;
+  if (server.hasArg("max"))
+    limit = constrain(server.arg("max").toInt(), 1, EVENTS_MAX);
+
+  size_t n = journal.read(from, eventsBuf, limit);
+  uint32_t next = from;
+  if (n)
+    next = eventsBuf[n - 1].seq + 1;
+  else if (next < journal.firstSeq())
+    next = journal.firstSeq();
+
+  String json = "{\"First\":" + String(journal.firstSeq()) + ",\"Next\":" + String(next) + ",\"Events\":[";
+  for (size_t i = 0; i < n; i++)
+  {
+    journalEvent_t &e = eventsBuf[i];
+    if (i)
+      json += ",";
+    json += "{\"Seq\":" + String(e.seq) + ",\"Time\":" + String(e.time);
+    if (e.flags & JOURNAL_FLAG_UPTIME)
+      json += ",\"Uptime\":1";
+    json += (e.flags & JOURNAL_FLAG_KEYPAD) ? ",\"Keypad\":\"" : ",\"Panel\":\"";
+    for (int b = 0; b < (e.bits + 7) / 8; b++)
+    {
+      json += hex[e.data[b] >> 4];
+      json += hex[e.data[b] & 0x0f];
+    }
+    json += "\",\"Bits\":" + String(e.bits) + "}";
+  }
+  json += "]}";
+  server.send(200, "application/json", json);
 }
 
 void handleNotFound()
@@ -153,7 +1105,47 @@ void handleNotFound()
 void setup(void)
 {
   Serial.begin(115200);
-  delay(100);
+  logger.begin(Serial);
+  bootId = ESP.random();
+
+  //Keybus first, so nothing the panel sends while the rest starts up is missed
+  dsc.setDTA_OUT(DATA_PIN_OUT);
+  dsc.setLED(LED_PIN);
+
+  dsc.zoneFilter.setDebounce(ZONE_HOLD_MS, ZONE_MAX_FLIPS, ZONE_WINDOW_MS);
+  dsc.keySequence.setTimeout(KEY_TIMEOUT_MS);
+  rules.setPublish(onRule);
+  for (unsigned int i = 0; i < sizeof(RULES) / sizeof(RULES[0]); i++)
+  {
+    if (!rules.add(RULES[i]))
+      logWarn(logger, "rule", "Bad rule: " + String(RULES[i]));
+  }
+  statsBuf.begin();
+  jsonBuf.begin();
+  recent.epoch = bootId;
+  recent.begin();
+  fanout.begin();
+  mqttSink.setLimits(64, 4, SINK_DROP_OLDEST); //every zone change and key action reaches the broker
+  serialSink.setLimits(8, 1, SINK_COALESCE);
+  fanout.attach(mqttSink);
+  fanout.attach(serialSink);
+#ifdef SYSLOG_HOST
+  syslogSink.setLimits(16, 2, SINK_DROP_OLDEST);
+  fanout.attach(syslogSink);
+#endif
+  bool warm = loadRtcState();
+  dsc.begin();
+
+  if (warm)
+  {
+    replayRtcState();
+    logInfo(logger, "boot", "Warm restart, state restored");
+  }
+  pumpKeybus();
+
+  //Words decoded from here on wait in the fan-out until the sinks take them
+  journalMounted = LittleFS.begin() && journal.begin();
+  pumpKeybus();
 
   wifiConnectHandler = WiFi.onStationModeGotIP(onWifiConnect);
   wifiDisconnectHandler = WiFi.onStationModeDisconnected(onWifiDisconnect);
@@ -165,8 +1157,10 @@ void setup(void)
   mqttClient.onMessage(onMqttMessage);
   mqttClient.onPublish(onMqttPublish);
   mqttClient.setServer(MQTT_HOST, MQTT_PORT);
+  mqttClient.setWill(MQTT_AVAILABILITY_TOPIC, 1, true, "offline");
 
   connectToWifi();
+  pumpKeybus();
 
   MDNS.begin(host);
 
@@ -174,9 +1168,11 @@ void setup(void)
   timeClient.begin();
 
   server.on("/", handleRoot);
-  server.on("/json", []() {
-    server.send(200, "application/json", webString);
-  });
+  server.on("/json", handleJson);
+  server.collectHeaders(httpHeaders, 1);
+
+  server.on("/stats", handleStats);
+  server.on("/events", handleEvents);
 
   server.onNotFound(handleNotFound);
 
@@ -185,20 +1181,12 @@ void setup(void)
   server.begin();
 
   MDNS.addService("http", "tcp", 80);
-
-  dsc.setCLK(CLK_PIN);
-  dsc.setDTA_IN(DATA_PIN);
-  dsc.setDTA_OUT(DATA_PIN_OUT);
-  dsc.setLED(LED_PIN);
-
-  dsc.begin();
+  pumpKeybus();
 
   //Ready to work!
-  Serial.println("https://github.com/ManCaveMade/ESP-DSC-MQTT");
-  Serial.printf("Open http://%s.local/update in your browser to update firmware.\n", host);
-  Serial.println("MQTT Topic: " + String(MQTT_TOPIC));
-
-  webString = "Nothing received yet...\nTime:" + timeClient.getFormattedTime();
+  logInfo(logger, "boot", "https://github.com/ManCaveMade/ESP-DSC-MQTT");
+  logInfo(logger, "boot", "Open http://" + String(host) + ".local/update in your browser to update firmware.");
+  logInfo(logger, "boot", "MQTT Topic: " + String(MQTT_TOPIC));
   
 }
 
@@ -210,33 +1198,26 @@ void loop(void)
     server.handleClient();
   }
 
-  if (dsc.process())
-  {
-    if (dscGlobal.pCmd)
-    {
+  handleKeybus();
 
-      Serial.println(dscGlobal.pMsg);
+  //Pass the events on, each sink within its own budget
+  fanout.service();
 
-      //stuff from serial is json without brackets so we can add more
-      webString = "{\"Time\":\"" + timeClient.getFormattedTime() +
-                  "\",\"EpochSeconds\":" + timeClient.getEpochTime() +
-                  ",\"PanelRaw\":\"" + String(dsc.pnlRaw()) +
-                  "\",\"PanelCommandHex\":\"" + String(dscGlobal.pCmd, HEX) +
-                  "\",\"PanelMessage\":" + String(dscGlobal.pMsg) +
-                  "}";
+  //Serial output, as much as the UART takes without waiting
+  logger.service();
 
-      if (mqttConnected)
-      {
-        //verbose (everything)
-        mqttClient.publish(MQTT_TOPIC, 0, false, webString.c_str());
-
-        if ((dscGlobal.pCmd == 0x05) || (dscGlobal.pCmd == 0xA5)) { //Status
-          mqttClient.publish(MQTT_STATUS_TOPIC, 1, false, webString.c_str());
-        } else if ((dscGlobal.pCmd == 0x27) || (dscGlobal.pCmd == 0x2D)) { //Zones
-          mqttClient.publish(MQTT_ZONE_TOPIC, 1, false, webString.c_str());
-        }
-      }
-    }
+  //Write at most one journal page per loop
+  if (journalMounted)
+  {
+    journal.service(millis());
+  }
+
+  //Periodic keybus traffic digest
+  if (mqttConnected && (millis() - lastStats > STATS_INTERVAL_MS))
+  {
+    lastStats = millis();
+    buildStats();
+    mqttClient.publish(MQTT_STATS_TOPIC, 0, false, statsBuf.getBuffer());
   }
 
   //Sleep for a while
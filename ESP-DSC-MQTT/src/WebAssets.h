@@ -0,0 +1,38 @@
+// Generated by web/build_assets.py from web/, do not edit
+#ifndef WebAssets_h
+#define WebAssets_h
+
+#include <Arduino.h>
+
+// index.html: 582 bytes, 397 gzipped
+#define INDEX_HTML_ETAG "\"4ed116e3cd40f439\""
+#define INDEX_HTML_GZ_LEN 397
+const uint8_t INDEX_HTML_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x6d, 0x52, 0xc1, 0x6e, 0xa3, 0x30,
+  0x10, 0xbd, 0xf3, 0x15, 0xb3, 0xe9, 0x01, 0x22, 0x05, 0xc8, 0xae, 0xb4, 0x52, 0x54, 0x20, 0x52,
+  0x9b, 0x46, 0xdb, 0x4a, 0xcd, 0x6e, 0xdb, 0x70, 0xd8, 0x3d, 0xba, 0xf6, 0x90, 0xb8, 0x0b, 0x36,
+  0x6b, 0x0f, 0x29, 0xa8, 0xca, 0xbf, 0xaf, 0x21, 0xa4, 0x87, 0xaa, 0x73, 0x79, 0xd6, 0x8c, 0xdf,
+  0xf3, 0x9b, 0x27, 0xa7, 0x5f, 0x6e, 0x7e, 0xad, 0xf2, 0x3f, 0x0f, 0x6b, 0xd8, 0x53, 0x55, 0x2e,
+  0xbd, 0xf4, 0x0c, 0xc8, 0x84, 0x83, 0x0a, 0x89, 0x01, 0xdf, 0x33, 0x63, 0x91, 0xb2, 0x49, 0x43,
+  0x45, 0xb8, 0x98, 0xb8, 0x36, 0x49, 0x2a, 0x71, 0xb9, 0xde, 0x3e, 0x84, 0x37, 0xdb, 0x55, 0xb8,
+  0x79, 0xcc, 0xf3, 0x34, 0x3e, 0xf5, 0xbc, 0xd4, 0x52, 0xe7, 0xf0, 0x59, 0x8b, 0xee, 0xed, 0x99,
+  0xf1, 0xbf, 0x3b, 0xa3, 0x1b, 0x25, 0x42, 0xae, 0x4b, 0x6d, 0x2e, 0x2f, 0xf8, 0x50, 0x49, 0xa1,
+  0x15, 0x85, 0x05, 0xab, 0x64, 0xd9, 0x5d, 0x5e, 0x19, 0xc9, 0xca, 0xd9, 0x2d, 0x96, 0x07, 0x24,
+  0xc9, 0xd9, 0x6c, 0xcb, 0x94, 0x0d, 0xb7, 0x68, 0x64, 0x91, 0x8c, 0xa4, 0xb9, 0xab, 0xc5, 0x22,
+  0x39, 0xa6, 0xf1, 0x49, 0xdb, 0x4b, 0xe3, 0xd1, 0x5e, 0xff, 0x8a, 0x83, 0x1a, 0xa4, 0xc8, 0x26,
+  0x96, 0x18, 0xe1, 0x64, 0xf9, 0x53, 0xd3, 0x5e, 0xaa, 0x1d, 0x18, 0xe4, 0x28, 0x0f, 0x28, 0xa0,
+  0x43, 0x8a, 0xa2, 0x28, 0x8d, 0xeb, 0xde, 0x1c, 0x37, 0xb2, 0xa6, 0xa5, 0x57, 0x34, 0x8a, 0x93,
+  0xd4, 0x0a, 0x9a, 0x5a, 0x38, 0x56, 0x30, 0x85, 0x37, 0x0f, 0xe0, 0xc0, 0x0c, 0xb4, 0x90, 0x81,
+  0xc2, 0x57, 0xf8, 0xbd, 0xb9, 0xbf, 0x25, 0xaa, 0x9f, 0xf0, 0x5f, 0x83, 0x96, 0x82, 0x69, 0xe2,
+  0xe6, 0x6d, 0xa4, 0x55, 0xa9, 0x99, 0x70, 0x57, 0xde, 0x05, 0x46, 0x2a, 0x80, 0x2c, 0x20, 0x68,
+  0xa3, 0xde, 0x44, 0x63, 0x21, 0xcb, 0xe0, 0xdb, 0x7c, 0x3e, 0x05, 0xa1, 0x79, 0x53, 0xa1, 0xa2,
+  0x68, 0x87, 0xb4, 0x2e, 0xb1, 0x3f, 0x5e, 0x77, 0x77, 0x22, 0xf0, 0x07, 0xb3, 0xfe, 0x34, 0x22,
+  0x6c, 0x69, 0xe5, 0xd2, 0x70, 0x03, 0xa7, 0xda, 0x46, 0x06, 0x6d, 0xad, 0x95, 0xc5, 0xdc, 0xf5,
+  0x93, 0x41, 0xd7, 0x25, 0x9f, 0xcb, 0x0a, 0x75, 0x43, 0xc1, 0xc9, 0xec, 0x0c, 0xbe, 0xba, 0x40,
+  0x06, 0x43, 0xc7, 0xb3, 0x2b, 0x34, 0x46, 0x9b, 0x8f, 0xb6, 0x3e, 0xa3, 0x7e, 0x1f, 0xa8, 0xef,
+  0xc4, 0x1a, 0x55, 0xe0, 0xff, 0x58, 0xe7, 0xfe, 0x0c, 0xfc, 0xf8, 0xc5, 0x6a, 0xe5, 0x8f, 0x8b,
+  0x5a, 0x54, 0xa2, 0x5f, 0xfa, 0xe8, 0x9d, 0x13, 0x4a, 0x5c, 0xec, 0xe7, 0xf8, 0xd2, 0x78, 0x4c,
+  0x3e, 0x3e, 0x7d, 0x97, 0xff, 0xc6, 0xbb, 0x50, 0x86, 0x46, 0x02, 0x00, 0x00,
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*
+  fuzz_decoder.cpp - libFuzzer/AFL harness for the panel and keypad decoder
+
+  An input is a panel word and a keypad word, separated by the first
+  newline. Each byte is one bit (odd bytes, e.g. '1', are ones), so any
+  input is a pair of words of any length, and the seed corpus in
+  ../corpus is readable text. Every input is run through decodePanel(),
+  decodeKeypad(), pnlChkSum(), pnlFormat()/kpdFormat()/pnlRaw()/kpdRaw()
+  and binToInt()/binToChar() at the edges of the word, under ASan/UBSan
+  for out of bounds reads.
+
+  The words of up to MAX_BITS bits are also decoded by DSCBatch (the
+  branch-free column decoder) and compared, output for output, with what
+  the String decoder made of them. A mismatch aborts, so the fuzzer keeps
+  the input.
+
+  Built with clang -fsanitize=fuzzer (make libfuzzer), with the driver in
+  fuzz_main.cpp for AFL and plain gcc runs (make fuzz).
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <TimeLib.h>
+#include <stdlib.h>
+
+static DSC *fuzzDsc;
+unsigned long fuzzMismatches;
+
+static void mismatch(const char *what, const String &word, long decoder, long batch)
+  {
+    fprintf(stderr, "fuzz_decoder: %s differs for %s: decoder %ld, batch %ld\n",
+            what, word.c_str(), decoder, batch);
+    fuzzMismatches++;
+    if (!getenv("FUZZ_CONTINUE")) abort();
+  }
+
+static void setWord(String &word, const uint8_t *data, size_t size)
+  {
+    word = "";
+    word.reserve(size);
+    for (size_t i=0;i<size;i++) word += (data[i] & 1) ? '1' : '0';
+  }
+
+// Compares the columns DSCBatch decodes for the panel word with the state
+// decodePanel() left behind
+static void compareBatch(DSC &dsc, byte pCmd)
+  {
+    String &w = dsc.state.pWord;
+    if (w.length() < 8 || w.length() > MAX_BITS) return;
+
+    byte cmd[1], bits[1], words[1][BATCH_BYTES];
+    bits[0] = DSCBatch::pack(w.c_str(), words[0]);
+    cmd[0] = words[0][0];
+    byte valid[1], lights[1], group[1], zones[1], armed[1], user[1];
+    unsigned long panelTime[1];
+    dscBatch_t in = {1, cmd, bits, words};
+    dscColumns_t out = {valid, lights, group, zones, armed, user, panelTime};
+    DSCBatch::decode(in, out);
+
+    if (valid[0] != dsc.pnlChkSum(w)) mismatch("checksum", w, dsc.pnlChkSum(w), valid[0]);
+    if (cmd[0] != dsc.binToInt(w, 0, 8)) mismatch("command", w, dsc.binToInt(w, 0, 8), cmd[0]);
+    if (!pCmd) return;                      // Not decoded (command 0x00)
+
+    if (pCmd == 0x05) {
+      bool ready = strncmp(dsc.state.pMsg.c_str(), "{\"Status\":[\"Ready\"", 18) == 0;
+      if ((lights[0] & LIGHT_READY) != ready) mismatch("ready light", w, ready, lights[0] & LIGHT_READY);
+      if (lights[0] != dsc.pnlLights()) mismatch("lights", w, dsc.pnlLights(), lights[0]);
+      if (armed[0] != dsc.state.armed) mismatch("armed", w, dsc.state.armed, armed[0]);
+    }
+    else if (armed[0] != BATCH_NONE) mismatch("armed", w, BATCH_NONE, armed[0]);
+    if (group[0] != BATCH_NONE && dsc.state.zones[group[0]] != zones[0])
+      mismatch("zones", w, dsc.state.zones[group[0]], zones[0]);
+    if (pCmd == 0xa5) {
+      if (dsc.state.armUser != user[0]) mismatch("user", w, dsc.state.armUser, user[0]);
+
+      // The String decoder reads the year as two decimal numbers, the batch as
+      // BCD, so only a BCD year in a valid date is compared (a day past the end
+      // of a short month rolls over into the next in the batch decoder)
+      if (panelTime[0] && dsc.dd <= 28) {
+        tmElements_t tm;
+        breakTime(panelTime[0], tm);
+        if (tm.Year + 1970 != 2000 + dsc.yy) mismatch("year", w, 2000 + dsc.yy, tm.Year + 1970);
+        if (tm.Month != dsc.mm || tm.Day != dsc.dd) mismatch("month/day", w, dsc.mm * 100 + dsc.dd, tm.Month * 100 + tm.Day);
+        if (tm.Hour != dsc.HH || tm.Minute != dsc.MM) mismatch("hour:minute", w, dsc.HH * 100 + dsc.MM, tm.Hour * 100 + tm.Minute);
+      }
+    }
+    else if (user[0] != BATCH_NONE || panelTime[0])
+      mismatch("0xa5 fields", w, 0, 1);
+  }
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+  {
+    if (!fuzzDsc) {
+      fuzzDsc = new DSC;
+      fuzzDsc->begin();                     // Allocates the format buffers
+    }
+    DSC &dsc = *fuzzDsc;
+
+    const uint8_t *nl = (const uint8_t *)memchr(data, '\n', size);
+    size_t pSize = nl ? nl - data : size;
+    setWord(dsc.state.pWord, data, pSize);
+    if (nl) setWord(dsc.state.kWord, nl + 1, size - pSize - 1);
+    else dsc.state.kWord = "";
+
+    dsc.state.oldPWord = "";                // Decode it even if it repeats the last input
+    dsc.state.pMsg = "";
+    dsc.state.kMsg = "";
+    dsc.state.pCmd = dsc.decodePanel();
+    dsc.state.kCmd = dsc.decodeKeypad();
+    compareBatch(dsc, dsc.state.pCmd);
+
+    // Every output, and the reads at and past both ends of the words
+    const char *f;
+    f = dsc.pnlFormat();
+    if (f) (void)strlen(f);
+    f = dsc.kpdFormat();
+    if (f) (void)strlen(f);
+    f = dsc.pnlRaw();
+    if (f) (void)strlen(f);
+    f = dsc.kpdRaw();
+    if (f) (void)strlen(f);
+    int len = dsc.state.pWord.length();
+    (void)dsc.binToInt(dsc.state.pWord, len - 4, 8);
+    if (dsc.binToInt(dsc.state.pWord, len, 8)) abort();        // Past the end reads as 0
+    if (*dsc.binToChar(dsc.state.pWord, len, len)) abort();     // An empty range is empty
+    (void)strlen(dsc.binToChar(dsc.state.pWord, len - 3, len + 5));
+    (void)strlen(dsc.binToChar(dsc.state.kWord, 0, MAX_BITS + 8));
+    return 0;
+  }
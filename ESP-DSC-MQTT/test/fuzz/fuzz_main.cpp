@@ -0,0 +1,167 @@
+/*
+  fuzz_main.cpp - Driver for fuzz_decoder.cpp without libFuzzer
+
+    fuzz_decoder [-n count] [-s seed] file|dir ...
+
+  Runs every input file given (and every file in every directory given),
+  then "count" random mutations of them (bit flips, cut and extended
+  words, spliced words), and prints the inputs per second. It then times
+  the String decoder (decodePanel()) and DSCBatch over the panel words of
+  the inputs and prints the frames per second of each.
+
+  For AFL, give it the one input file: afl-fuzz -i corpus -o out -- ./fuzz_decoder @@
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+extern unsigned long fuzzMismatches;
+
+static std::vector<std::string> inputs;
+
+static void load(const std::string &path)
+  {
+    struct stat st;
+    if (stat(path.c_str(), &st)) {
+      fprintf(stderr, "fuzz_decoder: cannot read %s\n", path.c_str());
+      exit(2);
+    }
+    if (S_ISDIR(st.st_mode)) {
+      DIR *d = opendir(path.c_str());
+      std::vector<std::string> names;
+      while (struct dirent *e = readdir(d)) {
+        if (e->d_name[0] != '.') names.push_back(path + "/" + e->d_name);
+      }
+      closedir(d);
+      std::sort(names.begin(), names.end());
+      for (const std::string &n : names) load(n);
+      return;
+    }
+    FILE *f = fopen(path.c_str(), "rb");
+    std::string s;
+    char b[4096];
+    size_t n;
+    while (f && (n = fread(b, 1, sizeof(b), f)) > 0) s.append(b, n);
+    if (f) fclose(f);
+    inputs.push_back(s);
+  }
+
+static std::string mutate(std::mt19937 &rng)
+  {
+    std::string s = inputs[rng() % inputs.size()];
+    switch (rng() % 5) {
+      case 0:                               // Flip a few bits
+        for (int i=rng() % 4;i>=0 && s.size();i--) s[rng() % s.size()] ^= 1;
+        break;
+      case 1: {                             // Cut the panel word short
+        size_t len = std::min(s.find('\n'), s.size());
+        size_t at = len ? rng() % len : 0;
+        s.erase(at, len - at);
+        break;
+      }
+      case 2:                               // Extend it, past MAX_BITS at times
+        s.insert(s.find('\n') == std::string::npos ? s.size() : s.find('\n'),
+                 std::string(rng() % (MAX_BITS + 16), rng() & 1 ? '1' : '0'));
+        break;
+      case 3:                               // Splice two inputs
+        s = s.substr(0, s.size() ? rng() % s.size() : 0) + inputs[rng() % inputs.size()];
+        break;
+      default:                              // Random bytes
+        s.resize(rng() % 200);
+        for (char &c : s) c = rng();
+    }
+    return s;
+  }
+
+static double seconds(std::chrono::steady_clock::time_point start)
+  {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return d.count() > 0 ? d.count() : 1e-9;
+  }
+
+// Frames per second of the String decoder and of DSCBatch, over the panel
+// words of the inputs that are at least a command byte long
+static void throughput(void)
+  {
+    std::vector<std::string> words;
+    for (const std::string &s : inputs) {
+      std::string w = s.substr(0, s.find('\n'));
+      for (char &c : w) c = (c & 1) ? '1' : '0';
+      if (w.size() >= 8 && w.size() <= MAX_BITS && w.compare(0, 8, "00000000")) words.push_back(w);
+    }
+    if (words.empty()) return;
+    const size_t FRAMES = 4096;
+    const int PASSES = 20;
+
+    DSC dsc;
+    std::vector<String> strs;
+    for (size_t i=0;i<FRAMES;i++) strs.push_back(String(words[i % words.size()].c_str()));
+    auto start = std::chrono::steady_clock::now();
+    for (int p=0;p<PASSES;p++) {
+      for (size_t i=0;i<FRAMES;i++) {
+        dsc.state.pWord = strs[i];
+        dsc.state.oldPWord = "";
+        dsc.state.pMsg = "";
+        dsc.decodePanel();
+        dsc.pnlChkSum(dsc.state.pWord);
+      }
+    }
+    double stringFps = FRAMES * PASSES / seconds(start);
+
+    std::vector<byte> cmd(FRAMES), bits(FRAMES), valid(FRAMES), lights(FRAMES), group(FRAMES),
+                      zones(FRAMES), armed(FRAMES), user(FRAMES);
+    std::vector<unsigned long> panelTime(FRAMES);
+    std::vector<byte> packed(FRAMES * BATCH_BYTES);
+    byte (*words2)[BATCH_BYTES] = (byte (*)[BATCH_BYTES])packed.data();
+    for (size_t i=0;i<FRAMES;i++) {
+      bits[i] = DSCBatch::pack(words[i % words.size()].c_str(), words2[i]);
+      cmd[i] = words2[i][0];
+    }
+    dscBatch_t in = {FRAMES, cmd.data(), bits.data(), words2};
+    dscColumns_t out = {valid.data(), lights.data(), group.data(), zones.data(),
+                        armed.data(), user.data(), panelTime.data()};
+    start = std::chrono::steady_clock::now();
+    for (int p=0;p<PASSES;p++) DSCBatch::decode(in, out);
+    double batchFps = FRAMES * PASSES / seconds(start);
+
+    printf("fuzz_decoder: decodePanel()+pnlChkSum() %.0f frames/s, DSCBatch::decode() %.0f frames/s (%.1fx)\n",
+           stringFps, batchFps, batchFps / stringFps);
+  }
+
+int main(int argc, char **argv)
+  {
+    long count = 0;
+    unsigned long seed = 1;
+    for (int i=1;i<argc;i++) {
+      if (!strcmp(argv[i], "-n") && i + 1 < argc) count = atol(argv[++i]);
+      else if (!strcmp(argv[i], "-s") && i + 1 < argc) seed = strtoul(argv[++i], NULL, 0);
+      else load(argv[i]);
+    }
+    if (inputs.empty()) {
+      fprintf(stderr, "usage: fuzz_decoder [-n count] [-s seed] file|dir ...\n");
+      return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string &s : inputs) LLVMFuzzerTestOneInput((const uint8_t *)s.data(), s.size());
+    std::mt19937 rng(seed);
+    for (long i=0;i<count;i++) {
+      std::string s = mutate(rng);
+      LLVMFuzzerTestOneInput((const uint8_t *)s.data(), s.size());
+    }
+    double t = seconds(start);
+    printf("fuzz_decoder: %zu inputs + %ld mutations in %.2f s (%.0f inputs/s), %lu mismatches\n",
+           inputs.size(), count, t, (inputs.size() + count) / t, fuzzMismatches);
+
+    if (count) throughput();
+    return fuzzMismatches ? 1 : 0;
+  }
@@ -0,0 +1,107 @@
+/*
+  keybus.h - Keybus simulator for the host tests
+
+  Drives the clock and data pins of a DSC (through hostSetPin(), which
+  calls its clock ISR) with the timing of a real keybus: the clock idles
+  high through a ~15 ms new word gap, then each bit is a falling edge
+  (keypad bit) and a rising edge (panel bit), 500 us apart. The data line
+  is set before each edge and held until the next one, so it is also
+  valid when the sampling timer reads it (120-240 us after the edge).
+
+  Simulated time belongs to the calling thread (see host/Arduino.h), so
+  one KeybusSim per thread drives its own bus.
+
+  Released into the public domain.
+
+*/
+
+#ifndef keybus_h
+#define keybus_h
+
+#include <Arduino.h>
+#include <string>
+
+// A panel word from its command byte and data bytes (see DSC::pnlChkSum()):
+// the command byte, a separator bit, then each data byte, plus the checksum
+// byte if "checksum" is set
+static inline std::string panelWord(byte cmd, const byte *data, byte count, bool checksum = true)
+  {
+    std::string w;
+    byte sum = cmd;
+    for (int b=7;b>=0;b--) w += (cmd >> b) & 1 ? '1' : '0';
+    w += '0';
+    for (byte i=0;i<count + checksum;i++) {
+      byte v = i < count ? data[i] : sum;
+      sum += v;
+      for (int b=7;b>=0;b--) w += (v >> b) & 1 ? '1' : '0';
+    }
+    return w;
+  }
+
+// A keypad word from its two bytes, ones after them (the keypad holds the
+// data line high when it has nothing to send)
+static inline std::string keypadWord(byte cmd, byte key, byte bits)
+  {
+    std::string w;
+    for (int b=7;b>=0;b--) w += (cmd >> b) & 1 ? '1' : '0';
+    for (int b=7;b>=0;b--) w += (key >> b) & 1 ? '1' : '0';
+    while (w.size() < bits) w += '1';
+    return w;
+  }
+
+class KeybusSim
+{
+  public:
+    KeybusSim(byte clk, byte data, unsigned long start = 1000000)
+      : clk(clk), data(data), now(start), halfBit(500), gapUs(15000)
+      {
+        hostSetMicros(now);
+        hostSetPin(data, HIGH);
+        hostSetPin(clk, HIGH);
+      }
+
+    // Sends a word after a new word gap: "panel" on the rising edges, "keypad"
+    // on the falling ones (ones once it runs out). "extra" clock cycles are
+    // added after the panel word, as the panel does after a short command
+    void word(const std::string &panel, const std::string &keypad = "", unsigned int extra = 0)
+      {
+        gap();
+        size_t bits = panel.size() + extra;
+        if (keypad.size() > bits) bits = keypad.size();
+        for (size_t i=0;i<bits;i++) {
+          edge(LOW, i < keypad.size() ? keypad[i] == '1' : true);
+          edge(HIGH, i < panel.size() ? panel[i] == '1' : true);
+        }
+      }
+
+    // Holds the clock high for a new word gap, so the ISR closes the last word
+    void gap(void)
+      {
+        now += gapUs;
+        hostSetMicros(now);
+      }
+
+    // Ends the last word: a gap and the falling edge after it, which is where
+    // the ISR closes a word of unknown length
+    void close(void)
+      {
+        gap();
+        edge(LOW, true);
+      }
+
+    // One clock edge to "level", with the data line at "bit"
+    void edge(int level, bool bit)
+      {
+        now += halfBit;
+        hostSetMicros(now);
+        hostSetPin(data, bit ? HIGH : LOW);
+        hostSetPin(clk, level);
+      }
+
+    byte clk, data;
+    unsigned long now;          // Simulated micros() of the last edge
+    unsigned int halfBit;       // Time between edges, us
+    unsigned int gapUs;         // New word gap, us
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*
+  test.h - Checks for the host tests in this directory
+
+  Each test is a program: it calls CHECK()/CHECK_EQ() as it goes, and
+  returns testResult() from main(), which prints the outcome and is
+  non-zero if any check failed.
+
+  Released into the public domain.
+
+*/
+
+#ifndef test_h
+#define test_h
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+static std::atomic<int> testChecks(0), testFailures(0);
+
+#define CHECK(cond) do { \
+    testChecks++; \
+    if (!(cond)) { \
+      testFailures++; \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+  } while (0)
+
+#define CHECK_EQ(a, b) do { \
+    testChecks++; \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (_a != _b) { \
+      testFailures++; \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+    } \
+  } while (0)
+
+#define CHECK_STR(a, b) do { \
+    testChecks++; \
+    const char *_a = (a), *_b = (b); \
+    if (strcmp(_a, _b)) { \
+      testFailures++; \
+      fprintf(stderr, "%s:%d: CHECK_STR(%s, %s) failed:\n  \"%s\"\n  \"%s\"\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+    } \
+  } while (0)
+
+static inline int testResult(const char *name)
+  {
+    printf("%s: %d checks, %d failed\n", name, testChecks.load(), testFailures.load());
+    return testFailures ? 1 : 0;
+  }
+
+#endif
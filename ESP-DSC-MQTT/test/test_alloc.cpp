@@ -0,0 +1,150 @@
+/*
+  test_alloc.cpp - The keybus hot path never touches the heap: malloc(),
+  calloc(), realloc() (String's allocator in the host core) and operator
+  new are counted, per thread, while a corpus of every panel command and
+  keypad key is sent through the clock ISR (KeybusSim), process(),
+  decodePanel() and decodeKeypad(). After a first pass, in which the
+  Strings grow to the longest word and message they hold, a second pass
+  must not allocate at all
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <vector>
+#include "test.h"
+#include "keybus.h"
+
+// ----- Allocation counting, glibc's allocator underneath -----
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+extern "C" void __libc_free(void *p);
+
+static thread_local bool counting = false;
+static thread_local unsigned long allocs = 0;
+
+extern "C" void *malloc(size_t size)
+  {
+    if (counting) allocs++;
+    return __libc_malloc(size);
+  }
+
+extern "C" void *calloc(size_t n, size_t size)
+  {
+    if (counting) allocs++;
+    return __libc_calloc(n, size);
+  }
+
+extern "C" void *realloc(void *p, size_t size)
+  {
+    if (counting) allocs++;
+    return __libc_realloc(p, size);
+  }
+
+extern "C" void free(void *p)
+  {
+    __libc_free(p);
+  }
+
+// Counts the allocations made by this thread while it is in scope
+class AllocScope
+{
+  public:
+    AllocScope() : start(allocs) { counting = true; }
+    ~AllocScope() { counting = false; }
+    unsigned long count() { return allocs - start; }
+
+  private:
+    unsigned long start;
+};
+
+DSC dsc;
+
+struct word_t
+{
+  std::string panel, keypad;
+};
+
+// Two words of every panel command the decoder knows (and one it does not),
+// each with different data so neither is a repeat, and every key
+static std::vector<word_t> corpus()
+  {
+    std::vector<word_t> words;
+    for (byte v=0;v<2;v++) {
+      for (byte i=0;i<sizeof(PANEL_CMDS)/sizeof(PANEL_CMDS[0]);i++) {
+        byte cmd = PANEL_CMDS[i][0];
+        byte data[8];
+        for (byte j=0;j<8;j++) data[j] = (byte)(0x11 * (j + 1) + v * 0x5a);
+        if (cmd == 0xa5) {                    // A valid date, so the time is set
+          byte date[6] = {0x20, 0x16, 0x8c, (byte)(0x20 + v), 0x00, 0x01};
+          memcpy(data, date, sizeof(date));
+        }
+        byte bits = dsc.frameBits(cmd);
+        byte count = bits ? (bits - 9) / 8 - PANEL_CMDS[i][1] : 4;
+        words.push_back({panelWord(cmd, data, count, PANEL_CMDS[i][1]), ""});
+      }
+      byte other[3] = {1, 2, (byte)(3 + v)};
+      words.push_back({panelWord(0x77, other, 3), ""});
+    }
+
+    const byte keys[] = {one, two, three, four, five, six, seven, eight, nine, aster, zero, pound,
+                         stay, away, chime, reset, kExit, lArrow, rArrow};
+    byte status[4] = {0x81, 0x01, 0x10, 0xc7};
+    for (byte i=0;i<sizeof(keys);i++) {
+      status[3] = i;
+      std::string p = panelWord(0x05, status, 4, false);
+      words.push_back({p, keypadWord(kOut, keys[i], p.size())});
+    }
+    const byte firstByteKeys[] = {fire, aux, panic};
+    for (byte i=0;i<sizeof(firstByteKeys);i++) {
+      status[3] = 0x40 + i;
+      std::string p = panelWord(0x05, status, 4, false);
+      words.push_back({p, keypadWord(firstByteKeys[i], firstByteKeys[i], p.size())});
+    }
+    return words;
+  }
+
+// Sends every word of "words", returns the allocations made in each
+static std::vector<unsigned long> replay(KeybusSim &sim, const std::vector<word_t> &words)
+  {
+    std::vector<unsigned long> counts(words.size(), 0);
+    for (size_t i=0;i<words.size();i++) {
+      AllocScope scope;
+      sim.word(words[i].panel, words[i].keypad);
+      hostAdvance(1000);                    // The last bit's samples are taken
+      while (dsc.state.frames.front()) dsc.process();
+      counts[i] = scope.count();
+    }
+    return counts;
+  }
+
+int main()
+  {
+    hostSetPin(3, HIGH);                  // The clock idles high
+    CHECK_EQ(dsc.begin(), 1);
+    KeybusSim sim(3, 4);
+    std::vector<word_t> words = corpus();
+
+    replay(sim, words);                   // The Strings grow to size
+    unsigned long decoded = dsc.state.frameCount;
+    std::vector<unsigned long> counts = replay(sim, words);
+    CHECK_EQ(dsc.state.frameCount - decoded, words.size());
+
+    for (size_t i=0;i<words.size();i++) {
+      if (counts[i]) {
+        fprintf(stderr, "test_alloc: %lu allocations for %s %s\n", counts[i],
+                words[i].panel.c_str(), words[i].keypad.c_str());
+      }
+      CHECK_EQ(counts[i], 0);
+    }
+
+    {
+      AllocScope scope;                   // The counter itself works
+      String s;
+      s.reserve(64);
+      CHECK_EQ(scope.count(), 1);
+    }
+    return testResult("test_alloc");
+  }
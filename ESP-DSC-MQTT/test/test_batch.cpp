@@ -0,0 +1,178 @@
+/*
+  test_batch.cpp - DSCBatch against the String decoder (pnlChkSum() and
+  decodePanel()) on 200k panel words: status, zone and 0xa5 words with
+  random data, half with a valid checksum, and random words of any length.
+  The batch is then decoded again split into one range per thread, which
+  must give the same columns. Prints the frames decoded per second, on one
+  core and on all of them
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <DSC_Batch.h>
+#include <TimeLib.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "test.h"
+#include "keybus.h"
+
+DSC dsc;
+
+const size_t FRAMES = 200000;
+
+struct Columns
+{
+  std::vector<byte> valid, lights, group, zones, armed, user;
+  std::vector<unsigned long> panelTime;
+
+  Columns() : valid(FRAMES), lights(FRAMES), group(FRAMES), zones(FRAMES), armed(FRAMES),
+              user(FRAMES), panelTime(FRAMES) {}
+
+  dscColumns_t out()
+    {
+      return {valid.data(), lights.data(), group.data(), zones.data(), armed.data(), user.data(), panelTime.data()};
+    }
+
+  bool operator==(const Columns &c) const
+    {
+      return valid == c.valid && lights == c.lights && group == c.group && zones == c.zones &&
+             armed == c.armed && user == c.user && panelTime == c.panelTime;
+    }
+};
+
+static std::vector<std::string> panel;
+static std::vector<byte> cmd, bits;
+static byte words[FRAMES][BATCH_BYTES];
+static Columns cols;
+static unsigned long mismatches = 0;
+
+static void mismatch(const char *what, size_t i, long decoder, long batch)
+  {
+    if (mismatches++ < 10) {
+      fprintf(stderr, "test_batch: %s differs for %s: decoder %ld, batch %ld\n",
+              what, panel[i].c_str(), decoder, batch);
+    }
+  }
+
+// A word of the command "c" with random data, its checksum valid half the time
+static std::string randomWord(byte c)
+  {
+    byte data[8];
+    byte count = c == 0x05 ? 4 : c == 0xa5 ? 6 : 5;
+    for (byte i=0;i<count;i++) data[i] = rand();
+    if (c == 0x05 || rand() & 1) return panelWord(c, data, count, c != 0x05);
+    data[count] = rand();                     // Most likely a bad checksum
+    return panelWord(c, data, count + 1, false);
+  }
+
+static void makeWords()
+  {
+    const byte cmds[] = {0x05, 0x27, 0x2d, 0x34, 0x3e, 0xa5};
+    srand(1);
+    for (size_t i=0;i<FRAMES;i++) {
+      if (i % 8 == 7) {                       // Any bits, any length
+        std::string w(8 + rand() % (MAX_BITS - 7), '0');
+        for (char &b : w) b = rand() & 1 ? '1' : '0';
+        panel.push_back(w);
+      }
+      else panel.push_back(randomWord(cmds[rand() % sizeof(cmds)]));
+      bits.push_back(DSCBatch::pack(panel[i].c_str(), words[i]));
+      cmd.push_back(words[i][0]);
+    }
+  }
+
+// Decodes word "i" with decodePanel() and compares it with the batch columns,
+// as the fuzz harness does
+static void compare(size_t i)
+  {
+    dsc.state.pWord = panel[i].c_str();
+    dsc.state.oldPWord = "";
+    dsc.state.pMsg = "";
+    byte pCmd = dsc.decodePanel();
+
+    String &w = dsc.state.pWord;
+    if (cols.valid[i] != dsc.pnlChkSum(w)) mismatch("checksum", i, dsc.pnlChkSum(w), cols.valid[i]);
+    if (!pCmd) return;
+
+    if (pCmd == 0x05) {
+      bool ready = strncmp(dsc.state.pMsg.c_str(), "{\"Status\":[\"Ready\"", 18) == 0;
+      if ((cols.lights[i] & LIGHT_READY) != ready) mismatch("ready light", i, ready, cols.lights[i] & LIGHT_READY);
+      if (cols.lights[i] != dsc.pnlLights()) mismatch("lights", i, dsc.pnlLights(), cols.lights[i]);
+      if (cols.armed[i] != dsc.state.armed) mismatch("armed", i, dsc.state.armed, cols.armed[i]);
+    }
+    else if (cols.armed[i] != BATCH_NONE) mismatch("armed", i, BATCH_NONE, cols.armed[i]);
+    byte group = cols.group[i];
+    if (group != BATCH_NONE && dsc.state.zones[group] != cols.zones[i])
+      mismatch("zones", i, dsc.state.zones[group], cols.zones[i]);
+    if (pCmd == 0xa5) {
+      if (dsc.state.armUser != cols.user[i]) mismatch("user", i, dsc.state.armUser, cols.user[i]);
+      if (cols.panelTime[i] && dsc.dd <= 28) {  // See fuzz_decoder.cpp
+        tmElements_t tm;
+        breakTime(cols.panelTime[i], tm);
+        if (tm.Year + 1970 != 2000 + dsc.yy) mismatch("year", i, 2000 + dsc.yy, tm.Year + 1970);
+        if (tm.Month != dsc.mm || tm.Day != dsc.dd) mismatch("month/day", i, dsc.mm * 100 + dsc.dd, tm.Month * 100 + tm.Day);
+        if (tm.Hour != dsc.HH || tm.Minute != dsc.MM) mismatch("hour:minute", i, dsc.HH * 100 + dsc.MM, tm.Hour * 100 + tm.Minute);
+      }
+    }
+    else if (cols.user[i] != BATCH_NONE || cols.panelTime[i])
+      mismatch("0xa5 fields", i, 0, 1);
+  }
+
+// Decodes the batch into "c", split into "threads" ranges, one per thread.
+// Returns the frames decoded per second
+static double decodeSplit(const dscBatch_t &in, Columns &c, unsigned int threads, int passes)
+  {
+    dscColumns_t out = c.out();
+    size_t per = (FRAMES + threads - 1) / threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int p=0;p<passes;p++) {
+      std::vector<std::thread> pool;
+      for (unsigned int t=0;t<threads;t++) {
+        pool.emplace_back([&in, &out, t, per] { DSCBatch::decode(in, out, t * per, per); });
+      }
+      for (std::thread &th : pool) th.join();
+    }
+    std::chrono::duration<double> s = std::chrono::steady_clock::now() - start;
+    return FRAMES * passes / s.count();
+  }
+
+int main()
+  {
+    CHECK_EQ(dsc.begin(), 1);
+    makeWords();
+    dscBatch_t in = {FRAMES, cmd.data(), bits.data(), words};
+    DSCBatch::decode(in, cols.out());
+
+    size_t valid = 0, zoneWords = 0, armWords = 0;
+    for (size_t i=0;i<FRAMES;i++) {
+      compare(i);
+      valid += cols.valid[i];
+      zoneWords += cols.group[i] != BATCH_NONE;
+      armWords += cols.panelTime[i] != 0;
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK(valid > FRAMES / 4 && valid < FRAMES * 3 / 4);  // Both kinds were tried
+    CHECK(zoneWords > FRAMES / 2);
+    CHECK(armWords > 0);
+
+    // A range past the end is cut short, and nothing outside it is touched
+    Columns part;
+    std::fill(part.lights.begin(), part.lights.end(), 0xee);
+    DSCBatch::decode(in, part.out(), FRAMES - 10, 100);
+    CHECK(std::equal(part.lights.end() - 10, part.lights.end(), cols.lights.end() - 10));
+    CHECK_EQ(part.lights[FRAMES - 11], 0xee);
+
+    // Split across threads: the same columns
+    unsigned int threads = std::max(4u, std::thread::hardware_concurrency());
+    Columns split;
+    double one = decodeSplit(in, cols, 1, 20);
+    double all = decodeSplit(in, split, threads, 20);
+    CHECK(split == cols);
+    printf("test_batch: %.1fM frames/s on one thread, %.1fM on %u (%u cores)\n",
+           one / 1e6, all / 1e6, threads, std::thread::hardware_concurrency());
+    return testResult("test_batch");
+  }
@@ -0,0 +1,110 @@
+/*
+  test_decode.cpp - decodePanel() on the 0x05, 0x27 and 0xa5 words of
+  test_replay (and a 0xa5 word of a real panel): the message and the
+  decoded fields, lights, zones, armed, arming code and panel time. The
+  keypad lights of 0x05 and of 0x0a/0x5d are read from the same bits
+  (pnlLights()), so both name the same lights for the same bytes. Armed
+  follows the 0x05 Armed light, and time words do not clear it
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include "test.h"
+#include "keybus.h"
+
+DSC dsc;
+
+// Decodes the panel word "w" as process() would, returns the command byte
+static byte decode(const std::string &w)
+  {
+    dsc.state.pWord = w.c_str();
+    dsc.state.oldPWord = "";
+    dsc.state.pMsg = "";
+    return dsc.decodePanel();
+  }
+
+static void replayWords()
+  {
+    byte status[4] = {0x81, 0x01, 0x10, 0xc7};
+    CHECK_EQ(decode(panelWord(0x05, status, 4, false)), 0x05);
+    CHECK_STR(dsc.state.pMsg.c_str(), "{\"Status\":[\"Ready\"]}");
+    CHECK_EQ(dsc.pnlLights(), LIGHT_READY | LIGHT_BACKLIGHT);
+    CHECK_EQ(dsc.state.armed, 0);
+
+    byte zones[5] = {0, 0, 0, 0, 0x05};
+    CHECK_EQ(decode(panelWord(0x27, zones, 5)), 0x27);
+    CHECK_STR(dsc.state.pMsg.c_str(), "{\"ZonesA\":[1,0,1,0,0,0,0,0]}");
+    CHECK_EQ(dsc.state.zones[0], 0x05);
+    CHECK_EQ(dsc.zoneFilter.zones[0], 0x05);  // First bitmap, taken as it is
+
+    // The test_replay date: year 20, month 4, day 0, 18:13, arm field 0
+    byte date[6] = {0x20, 0x10, 0x12, 0x34, 0x00, 0x01};
+    CHECK_EQ(decode(panelWord(0xa5, date, 6)), 0xa5);
+    CHECK_STR(dsc.state.pMsg.c_str(), "{\"PanelDateTime\":\"2020/4/0 18:13\",\"Armed\":0}");
+    CHECK_EQ(dsc.yy, 20);
+    CHECK_EQ(dsc.mm, 4);
+    CHECK_EQ(dsc.HH, 18);
+    CHECK_EQ(dsc.MM, 13);
+    CHECK_EQ(dsc.state.armUser, 0);
+
+    // Armed by user 3, from a panel
+    CHECK_EQ(decode("10100101000100100000101100010111010000000100110110000000000101000"), 0xa5);
+    CHECK_STR(dsc.state.pMsg.c_str(), "{\"PanelDateTime\":\"2024/5/17 14:32\",\"Armed\":1,\"UserCode\":\"3\"}");
+    CHECK_EQ(dsc.yy, 24);
+    CHECK_EQ(dsc.mm, 5);
+    CHECK_EQ(dsc.dd, 17);
+    CHECK_EQ(dsc.state.armUser, 3);
+  }
+
+static void armed()
+  {
+    byte status[4] = {0x82, 0x01, 0x10, 0xc7};  // Armed light on
+    decode(panelWord(0x05, status, 4, false));
+    CHECK_STR(dsc.state.pMsg.c_str(), "{\"Status\":[\"Not Ready\",\"Armed\"]}");
+    CHECK_EQ(dsc.state.armed, 1);
+
+    // A periodic time word, its arm field 0: still armed
+    byte date[6] = {0x20, 0x10, 0x12, 0x34, 0x00, 0x01};
+    decode(panelWord(0xa5, date, 6));
+    CHECK_EQ(dsc.state.armed, 1);
+
+    // The light goes out: disarmed
+    status[0] = 0x81;
+    decode(panelWord(0x05, status, 4, false));
+    CHECK_EQ(dsc.state.armed, 0);
+  }
+
+static void lights()
+  {
+    // Program is the top bit of the second data byte in every word with lights
+    byte status[4] = {0x00, 0x80, 0x00, 0x00};
+    decode(panelWord(0x05, status, 4, false));
+    CHECK_STR(dsc.state.pMsg.c_str(), "{\"Status\":[\"Not Ready\",\"Program\"]}");
+    CHECK_EQ(dsc.pnlLights(), LIGHT_PROGRAM);
+    byte program[6] = {0x01, 0x82, 0x04, 0x00, 0x00, 0x00};
+    decode(panelWord(0x0a, program, 6));
+    CHECK_STR(dsc.state.pMsg.c_str(), "{\"PanelProgramMode\":{\"Lights\":[\"Ready\",\"Program\"],\"Status\":\"82\",\"Zones\":[3]}}");
+
+    // Bit 5 of the first byte is not read as a light by either
+    status[0] = 0x20;
+    status[1] = 0x00;
+    decode(panelWord(0x05, status, 4, false));
+    CHECK_STR(dsc.state.pMsg.c_str(), "{\"Status\":[\"Not Ready\"]}");
+    CHECK_EQ(dsc.pnlLights(), 0);
+    byte memory[5] = {0x24, 0x00, 0x01, 0x00, 0x00};
+    decode(panelWord(0x5d, memory, 5));
+    CHECK_STR(dsc.state.pMsg.c_str(), "{\"AlarmMemoryGroup1\":{\"Lights\":[\"Memory\"],\"Zones\":[9]}}");
+    CHECK_EQ(dsc.pnlLights(), LIGHT_MEMORY);
+  }
+
+int main()
+  {
+    CHECK_EQ(dsc.begin(), 1);
+    CHECK_EQ(dsc.state.armed, 0xff);
+    replayWords();
+    armed();
+    lights();
+    return testResult("test_decode");
+  }
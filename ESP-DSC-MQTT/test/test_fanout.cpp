@@ -0,0 +1,153 @@
+/*
+  test_fanout.cpp - EventFanout under overload, with mock sinks: one that
+  keeps up, one that takes only some of what it is given, and one that is
+  disconnected for a while. publish() never calls a sink, the sink that
+  keeps up gets every event in order whatever the others do, and the slow
+  ones skip ahead and count what they missed. SINK_COALESCE only drops a
+  state event followed straight away by the same one
+
+  Released into the public domain.
+
+*/
+
+#include <EventFanout.h>
+#include <string>
+#include <vector>
+#include "test.h"
+
+// A sink that records what it is given. It takes one write in "every"
+// (refusing the others) while "connected"
+struct MockSink
+{
+  std::vector<uint32_t> seqs;
+  std::vector<std::string> texts;
+  unsigned long calls;
+  unsigned int every;
+  bool connected;
+
+  bool write(const ringEvent_t &e)
+    {
+      if (++calls % every) return false;
+      seqs.push_back(e.seq);
+      texts.push_back(e.text);
+      return true;
+    }
+};
+
+static MockSink mocks[3];
+static unsigned long writeCalls = 0;
+
+template <int N> bool mockWrite(const ringEvent_t &e)
+  {
+    writeCalls++;
+    return mocks[N].write(e);
+  }
+
+template <int N> bool mockReady()
+  {
+    return mocks[N].connected;
+  }
+
+static void reset()
+  {
+    for (MockSink &m : mocks) m = {{}, {}, 0, 1, true};
+  }
+
+static bool inOrder(const std::vector<uint32_t> &seqs)
+  {
+    for (size_t i=1;i<seqs.size();i++) {
+      if (seqs[i] <= seqs[i - 1]) return false;
+    }
+    return true;
+  }
+
+static void overload()
+  {
+    reset();
+    EventFanout fanout(4096);
+    CHECK_EQ(fanout.begin(), 1);
+    EventSink fast(mockWrite<0>, mockReady<0>), slow(mockWrite<1>, mockReady<1>), away(mockWrite<2>, mockReady<2>);
+    fast.setLimits(64, 4, SINK_DROP_OLDEST);
+    slow.setLimits(8, 1, SINK_DROP_OLDEST);
+    away.setLimits(16, 2, SINK_DROP_OLDEST);
+    fanout.attach(fast);
+    fanout.attach(slow);
+    fanout.attach(away);
+    mocks[1].every = 3;                       // Takes a third of the writes
+    mocks[2].connected = false;
+
+    // Three events per loop, more than the slow sink can take
+    const int EVENTS = 1000;
+    char text[32];
+    unsigned long publishWrites = 0;
+    for (int i=0;i<EVENTS;i++) {
+      unsigned long before = writeCalls;
+      snprintf(text, sizeof(text), "{\"Event\":%d}", i);
+      fanout.publish(i, 'P', 0x05, 0, text);
+      publishWrites += writeCalls - before;
+      if (i % 3 == 2) fanout.service();
+      if (i == EVENTS / 2) mocks[2].connected = true;
+    }
+    for (int i=0;i<100;i++) fanout.service();  // Drain
+    CHECK_EQ(publishWrites, 0);                 // publish() never writes
+    CHECK_EQ(fanout.ring.nextSeq(), EVENTS + 1);
+
+    CHECK_EQ(mocks[0].seqs.size(), EVENTS);     // Every event, in order
+    CHECK(inOrder(mocks[0].seqs));
+    CHECK_EQ(fast.dropped, 0);
+    CHECK_STR(mocks[0].texts.back().c_str(), "{\"Event\":999}");
+
+    CHECK(slow.dropped > 0);                    // Behind, skipped ahead
+    CHECK_EQ(slow.written + slow.dropped, EVENTS);
+    CHECK_EQ(slow.written, mocks[1].seqs.size());
+    CHECK(inOrder(mocks[1].seqs));
+    CHECK(slow.refused > 0);
+
+    // Nothing while disconnected, then at most its backlog of what was missed
+    CHECK_EQ(away.written + away.dropped, EVENTS);
+    CHECK(away.dropped >= EVENTS / 2 - 16);
+    CHECK(inOrder(mocks[2].seqs));
+    CHECK_EQ(mocks[2].seqs.back(), EVENTS);
+    for (const EventSink *s : {&fast, &slow, &away}) CHECK_EQ(fanout.backlog(*s), 0);
+  }
+
+static void coalesce()
+  {
+    reset();
+    EventFanout fanout(4096);
+    CHECK_EQ(fanout.begin(), 1);
+    EventSink serial(mockWrite<0>, mockReady<0>), mqtt(mockWrite<1>, mockReady<1>);
+    serial.setLimits(16, 16, SINK_COALESCE);
+    mqtt.setLimits(16, 16, SINK_DROP_OLDEST);
+    fanout.attach(serial);
+    fanout.attach(mqtt);
+    mocks[0].connected = mocks[1].connected = false;  // Everything queues up
+
+    fanout.publish(1, 'Z', 0, FANOUT_STATE, "open");
+    fanout.publish(2, 'Z', 0, FANOUT_STATE, "closed");
+    fanout.publish(3, 'Z', 0, FANOUT_STATE, "open");
+    fanout.publish(4, 'K', 0, 0, "Away");
+    fanout.publish(5, 'K', 0, 0, "Away");
+    fanout.publish(6, 'P', 0x05, FANOUT_STATE, "ready");
+    fanout.publish(7, 'P', 0x05, FANOUT_STATE, "ready");
+    fanout.publish(8, 'Z', 0, FANOUT_STATE, "closed");
+    mocks[0].connected = mocks[1].connected = true;
+    fanout.service();
+
+    // A zone going open, closed, open again is three changes, two key presses
+    // alike are two: only the status word repeated back to back is collapsed
+    std::string got;
+    for (const std::string &t : mocks[0].texts) got += t + " ";
+    CHECK_STR(got.c_str(), "open closed open Away Away ready closed ");
+    CHECK_EQ(serial.coalesced, 1);
+    CHECK_EQ(serial.written, 7);
+    CHECK_EQ(mocks[1].texts.size(), 8);       // Everything
+    CHECK_EQ(mqtt.coalesced, 0);
+  }
+
+int main()
+  {
+    overload();
+    coalesce();
+    return testResult("test_fanout");
+  }
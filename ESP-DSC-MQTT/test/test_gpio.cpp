@@ -0,0 +1,61 @@
+/*
+  test_gpio.cpp - DSCBus with a GPIO policy of its own (here, for a board
+  with an inverting buffer on the data line): the bits the sampling timer
+  reads after the edge go through the policy too, not only the clock ISR's
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include "test.h"
+#include "keybus.h"
+
+// Reads the data line through an inverting buffer, and counts the reads
+struct InvertedData
+{
+  static bool read(byte pin)
+    {
+      reads++;
+      bool level = digitalRead(pin);
+      return pin == 4 ? !level : level;
+    }
+  static unsigned long reads;
+};
+unsigned long InvertedData::reads = 0;
+
+DSCBus<3, 4, InvertedData> dsc;
+
+static std::string invert(std::string s)
+  {
+    for (char &c : s) c = c == '1' ? '0' : '1';
+    return s;
+  }
+
+int main()
+  {
+    hostSetPin(3, HIGH);                  // The clock idles high
+    CHECK_EQ(dsc.begin(), 1);             // Default: timer1 sampling, 3 reads per bit
+    KeybusSim sim(3, 4);
+
+    byte zones[5] = {0, 0, 0, 0, 0x05};
+    byte status[4] = {0x81, 0x01, 0x10, 0xc7};
+    std::string words[2] = {panelWord(0x27, zones, 5), panelWord(0x05, status, 4, false)};
+    std::string key = keypadWord(0xff, 0x82, words[0].size());   // [Button] 1
+    unsigned long edges = 0;
+    for (const std::string &w : words) {
+      sim.word(invert(w), invert(key.substr(0, w.size())));
+      edges += w.size() * 2;
+      hostAdvance(1000);                  // The last bit's samples are taken
+    }
+
+    for (const std::string &w : words) {
+      CHECK(dsc.state.frames.front() != NULL);
+      dsc.process();
+      CHECK_STR(dsc.state.pWord.c_str(), w.c_str());
+      CHECK_STR(dsc.state.kMsg.c_str(), "[Button] 1");
+    }
+    // The clock level on every edge, and three data reads per bit
+    CHECK_EQ(InvertedData::reads, edges + edges * 3);
+    return testResult("test_gpio");
+  }
@@ -0,0 +1,99 @@
+/*
+  test_health.cpp - DSCHealth on a simulated bus, with process() called
+  every millisecond as the sketch's loop does: normal traffic raises no
+  fault; a cut clock, a data line stuck high and a stream of runt words
+  each raise theirs (the first two within 100 ms), and the faults clear
+  once normal traffic is back
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include "test.h"
+#include "keybus.h"
+
+DSC dsc;
+
+// One word, the way KeybusSim::word() sends it, but with a loop pass
+// (process()) after every clock cycle
+static void sendWord(KeybusSim &sim, const std::string &panel)
+  {
+    for (unsigned long t=0;t<sim.gapUs;t+=1000) {
+      sim.now += 1000;
+      hostSetMicros(sim.now);
+      dsc.process();
+    }
+    for (size_t i=0;i<panel.size();i++) {
+      sim.edge(LOW, true);
+      sim.edge(HIGH, panel[i] == '1');
+      dsc.process();
+    }
+  }
+
+// Normal traffic, alternating status and zone words, for about "ms"
+static void traffic(KeybusSim &sim, unsigned long ms)
+  {
+    byte status[4] = {0x81, 0x01, 0x10, 0xc7};
+    byte zones[5] = {0, 0, 0, 0, 0x04};
+    std::string words[2] = {panelWord(0x05, status, 4, false), panelWord(0x27, zones, 5)};
+    unsigned long end = sim.now + ms * 1000;
+    for (int i=0;sim.now < end;i++) sendWord(sim, words[i % 2]);
+  }
+
+int main()
+  {
+    hostSetPin(3, HIGH);                      // The clock idles high
+    CHECK_EQ(dsc.begin(), 1);
+    KeybusSim sim(3, 4);
+
+    // Normal traffic, over more than the slow window
+    traffic(sim, 2000);
+    CHECK_EQ(dsc.health.faults, 0);
+    CHECK(dsc.health.edgeRate >= 1000 && dsc.health.edgeRate <= 2500);
+    unsigned long raised = dsc.health.raised;
+
+    // The clock is cut: flagged within 100 ms of the last edge
+    unsigned long lastEdge = sim.now;
+    while (!(dsc.health.faults & HEALTH_CLOCK_LOST) && sim.now - lastEdge < 500000) {
+      sim.now += 1000;
+      hostSetMicros(sim.now);
+      dsc.process();
+    }
+    CHECK(dsc.health.faults & HEALTH_CLOCK_LOST);
+    CHECK_EQ(dsc.health.worst(), HEALTH_CLOCK_LOST);
+    CHECK(sim.now - lastEdge > 50000);
+    CHECK(sim.now - lastEdge <= 100000);
+    CHECK_STR(DSCHealth::name(dsc.health.worst()), "ClockLost");
+
+    // Back: the clock at once, the edge rate once the slow window has refilled
+    traffic(sim, 100);
+    CHECK(!(dsc.health.faults & HEALTH_CLOCK_LOST));
+    traffic(sim, 1500);
+    CHECK_EQ(dsc.health.faults, 0);
+
+    // The data line stuck high under a running clock: flagged within 100 ms
+    unsigned long stuckAt = sim.now;
+    unsigned long flaggedAt = 0;
+    for (int i=0;i<20 && !flaggedAt;i++) {
+      sendWord(sim, std::string(16, '1'));
+      if (dsc.health.faults & HEALTH_DATA_STUCK) flaggedAt = sim.now;
+    }
+    CHECK(flaggedAt != 0);
+    CHECK(flaggedAt - stuckAt <= 100000 + 16 * 1000);   // Checked at the end of a word
+    CHECK_EQ(dsc.health.stuckLevel, 1);
+    traffic(sim, 1500);
+    CHECK_EQ(dsc.health.faults, 0);
+
+    // Runt words, shorter than a command byte: framing errors
+    unsigned long framingErrors = dsc.state.framingErrors;
+    for (int i=0;i<60;i++) sendWord(sim, "1010");
+    CHECK(dsc.state.framingErrors - framingErrors >= 50);
+    CHECK(dsc.health.faults & HEALTH_FRAMING);
+    CHECK(dsc.health.framingRate > 5);
+    traffic(sim, 1500);
+    CHECK_EQ(dsc.health.faults, 0);
+
+    CHECK(dsc.health.raised > raised + 2);
+    return testResult("test_health");
+  }
@@ -0,0 +1,137 @@
+/*
+  test_journal.cpp - EventJournal on the flash emulator (FileJournalStorage)
+  and on a storage that takes simulated time per page: add() never touches
+  the storage, service() writes at most one page per call and reports how
+  long it held up the caller, the ring wraps, and the pages survive a
+  remount with torn ones skipped
+
+  Released into the public domain.
+
+*/
+
+#include <EventJournal.h>
+#include <unistd.h>
+#include "test.h"
+
+const uint16_t PAGES = 4;
+const unsigned long PAGE_WRITE_US = 7000;   // A LittleFS page file write, roughly
+
+// Pages in RAM, each write taking PAGE_WRITE_US of simulated time
+class SlowStorage : public JournalStorage
+{
+  public:
+    SlowStorage() : writes(0) { memset(store, 0, sizeof(store)); }
+
+    virtual uint16_t pages() { return PAGES; }
+    virtual int readPage(uint16_t index, journalPage_t *page)
+      {
+        memcpy(page, &store[index], sizeof(journalPage_t));
+        return 1;
+      }
+    virtual int writePage(uint16_t index, const journalPage_t *page)
+      {
+        hostAdvance(PAGE_WRITE_US);
+        memcpy(&store[index], page, sizeof(journalPage_t));
+        writes++;
+        return 1;
+      }
+
+    journalPage_t store[PAGES];
+    unsigned long writes;
+};
+
+static const char *WORD = "00000101100000010000000100010000110001110";   // 0x05 status, 41 bits
+
+static void addEvents(EventJournal &j, int n)
+  {
+    for (int i=0;i<n;i++) j.add(1000 + i, millis(), 0, WORD, 41);
+  }
+
+static void testTiming()
+  {
+    SlowStorage storage;
+    EventJournal j(storage, 1000);
+    CHECK_EQ(j.begin(), 1);
+
+    addEvents(j, JOURNAL_PAGE_EVENTS * 2);
+    CHECK_EQ(storage.writes, 0);            // add() only fills RAM pages
+    CHECK_EQ(j.service(millis()), 1);       // The full page
+    CHECK_EQ(storage.writes, 1);
+    CHECK_EQ(j.writeUs, PAGE_WRITE_US);
+    CHECK_EQ(j.writeMaxUs, PAGE_WRITE_US);
+    CHECK_EQ(j.service(millis()), 0);       // The second one is still the current page
+
+    addEvents(j, 1);                        // Hands it over to service()
+    CHECK_EQ(j.service(millis()), 1);
+    CHECK_EQ(storage.writes, 2);
+    CHECK_EQ(j.service(millis()), 0);       // Partly filled, not waited flushMs yet
+    delay(1001);
+    CHECK_EQ(j.service(millis()), 1);
+    CHECK_EQ(storage.writes, 3);
+    CHECK_EQ(j.pageWrites, 3);
+    CHECK_EQ(j.writeErrors, 0);
+  }
+
+static void testFile()
+  {
+    char path[] = "/tmp/test_journal_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    uint32_t last = 0;
+    {
+      FileJournalStorage storage(path, PAGES);
+      EventJournal j(storage, 1000);
+      CHECK_EQ(j.begin(), 1);
+      // Seven pages into a ring of four: the oldest three are overwritten
+      for (int p=0;p<7;p++) {
+        addEvents(j, JOURNAL_PAGE_EVENTS);
+        CHECK_EQ(j.flush(), 1);
+      }
+      last = j.nextSeq() - 1;
+      CHECK_EQ(storage.writes, 7);
+      j.end();
+    }
+
+    // Tear the newest page: it is skipped at mount, the three before it read back
+    FILE *f = fopen(path, "r+b");
+    CHECK(f != NULL);
+    if (f) {
+      journalPage_t page;
+      for (uint16_t i=0;i<PAGES;i++) {
+        fseek(f, (long)i * JOURNAL_PAGE_SIZE, SEEK_SET);
+        if (fread(&page, sizeof(page), 1, f) != 1) continue;
+        if (page.events[page.count - 1].seq == last) {
+          fseek(f, (long)i * JOURNAL_PAGE_SIZE + 40, SEEK_SET);
+          fputc(0xff, f);
+        }
+      }
+      fclose(f);
+    }
+
+    FileJournalStorage storage(path, PAGES);
+    EventJournal j(storage, 1000);
+    CHECK_EQ(j.begin(), 1);
+    CHECK_EQ(j.badPages, 1);
+    CHECK_EQ(j.firstSeq(), last - JOURNAL_PAGE_EVENTS * 4 + 1);
+    CHECK_EQ(j.nextSeq(), last - JOURNAL_PAGE_EVENTS + 1);   // Continues after the last good page
+
+    journalEvent_t events[JOURNAL_PAGE_EVENTS * PAGES];
+    size_t n = j.read(0, events, JOURNAL_PAGE_EVENTS * PAGES);
+    CHECK_EQ(n, JOURNAL_PAGE_EVENTS * 3);
+    CHECK_EQ(events[0].seq, j.firstSeq());
+    CHECK_EQ(events[n - 1].seq, last - JOURNAL_PAGE_EVENTS);
+    CHECK_EQ(events[0].cmd, 0x05);
+    CHECK_EQ(events[0].bits, 41);
+    CHECK_EQ(events[0].data[0], 0x05);
+    j.end();
+    unlink(path);
+  }
+
+int main()
+  {
+    testTiming();
+    testFile();
+    return testResult("test_journal");
+  }
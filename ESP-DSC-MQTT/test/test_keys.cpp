@@ -0,0 +1,107 @@
+/*
+  test_keys.cpp - DSCKeySequence fed by keypad words on a simulated bus:
+  a code and a "*8" installer code come out masked as 'x', with the digit
+  after '*' kept; a sequence no key follows is flushed once the timeout
+  has passed; the repeat of an alarm key, which the keypad sends twice,
+  is dropped, while a press after the timeout is an action of its own
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <vector>
+#include "test.h"
+#include "keybus.h"
+
+DSC dsc;
+
+const unsigned int TIMEOUT_MS = 2000;
+
+// Sends a status word with keypad word "kCmd key" alongside it
+static void press(KeybusSim &sim, byte kCmd, byte key)
+  {
+    byte status[4] = {0x81, 0x01, 0x10, 0xc7};
+    std::string p = panelWord(0x05, status, 4, false);
+    sim.word(p, keypadWord(kCmd, key, p.size()));
+    hostAdvance(1000);                        // The last bit's samples are taken
+    while (dsc.state.frames.front()) dsc.process();
+  }
+
+static void keys(KeybusSim &sim, const std::vector<byte> &codes)
+  {
+    for (byte k : codes) press(sim, kOut, k);
+  }
+
+// Lets the bus idle for "ms", with the loop running
+static void idle(KeybusSim &sim, unsigned long ms)
+  {
+    sim.now = micros() + ms * 1000UL;       // From the last sample, see press()
+    hostSetMicros(sim.now);
+    dsc.process();
+  }
+
+int main()
+  {
+    hostSetPin(3, HIGH);                      // The clock idles high
+    dsc.keySequence.setTimeout(TIMEOUT_MS);
+    CHECK_EQ(dsc.begin(), 1);
+    KeybusSim sim(3, 4);
+    dscKeyAction_t a;
+
+    // A code, then Away
+    keys(sim, {one, two, three, four, away});
+    CHECK(dsc.keySequence.next(a));
+    CHECK_STR(a.keys, "xxxxA");
+    CHECK_EQ(a.digits, 4);
+    CHECK_STR(DSCKeySequence::name(a), "Away");
+    CHECK(!a.timedOut);
+
+    // A code ended with #
+    keys(sim, {five, five, five, five, pound});
+    CHECK(dsc.keySequence.next(a));
+    CHECK_STR(a.keys, "xxxx#");
+    CHECK_STR(DSCKeySequence::name(a), "Code");
+
+    // *8 and the installer code: nothing ends it but the timeout
+    keys(sim, {aster, eight, five, five, five, five});
+    CHECK(!dsc.keySequence.next(a));
+    idle(sim, TIMEOUT_MS - 100);
+    CHECK(!dsc.keySequence.next(a));
+    idle(sim, 100);
+    CHECK(dsc.keySequence.next(a));
+    CHECK_STR(a.keys, "*8xxxx");
+    CHECK_EQ(a.star, '8');
+    CHECK_EQ(a.digits, 4);
+    CHECK(a.timedOut);
+    CHECK_STR(DSCKeySequence::name(a), "Installer");
+
+    // Digits left hanging are flushed by the timeout too, still masked
+    keys(sim, {one, two});
+    idle(sim, TIMEOUT_MS);
+    CHECK(dsc.keySequence.next(a));
+    CHECK_STR(a.keys, "xx");
+    CHECK(a.timedOut);
+    CHECK(!dsc.keySequence.next(a));
+
+    // Panic, sent twice: one action, and it ends a sequence in progress
+    unsigned long fed = dsc.keySequence.keys;
+    keys(sim, {one});
+    press(sim, panic, panic);
+    press(sim, panic, panic);
+    CHECK(dsc.keySequence.next(a));
+    CHECK_STR(a.keys, "x");
+    CHECK(dsc.keySequence.next(a));
+    CHECK_STR(a.keys, "P");
+    CHECK_STR(DSCKeySequence::name(a), "Panic");
+    CHECK(!dsc.keySequence.next(a));
+    CHECK_EQ(dsc.keySequence.keys, fed + 2);
+
+    // Pressed again once the timeout has passed: a new action
+    idle(sim, TIMEOUT_MS);
+    press(sim, panic, panic);
+    CHECK(dsc.keySequence.next(a));
+    CHECK_STR(a.keys, "P");
+    CHECK_EQ(dsc.keySequence.lost, 0);
+    return testResult("test_keys");
+  }
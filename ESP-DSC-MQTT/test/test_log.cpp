@@ -0,0 +1,89 @@
+/*
+  test_log.cpp - SerialLog against a port that takes only so many bytes
+  at a time (its availableForWrite()): service() never writes more than
+  the port has room for, and nothing while it has none; add() never
+  writes at all, and a record that does not fit in a full ring is dropped
+  and counted rather than waited for. What is written comes out whole and
+  in order across the wrap of the ring
+
+  Released into the public domain.
+
+*/
+
+#include <SerialLog.h>
+#include <string>
+#include "test.h"
+
+// A UART with "room" bytes free in its FIFO, each write taking some of it
+class MockPort : public Print
+{
+  public:
+    std::string out;
+    int room = 0;
+    unsigned long writes = 0;
+    unsigned long overruns = 0;         // Bytes written past the room there was
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size)
+      {
+        writes++;
+        if ((int)size > room) overruns += size - room;
+        room -= size;
+        out.append((const char *)buffer, size);
+        return size;
+      }
+    int availableForWrite(void) { return room; }
+};
+
+int main()
+  {
+    MockPort port;
+    SerialLog log(64);
+    CHECK_EQ(log.begin(port), 1);
+
+    // Queued, not written: the port is not touched by add()
+    CHECK_EQ(log.add(LOG_INFO, "dsc", "first"), 1);      // "I dsc: first\r\n", 14 bytes
+    CHECK_EQ(log.add(LOG_WARN, "zone", "second"), 1);    // 16 bytes
+    CHECK_EQ(port.writes, 0);
+    CHECK_EQ(log.pending(), 30);
+
+    // No room: nothing written, and no waiting for it
+    CHECK_EQ(log.service(), 0);
+    CHECK_EQ(port.writes, 0);
+
+    // Room for 10 bytes: exactly those
+    port.room = 10;
+    CHECK_EQ(log.service(), 10);
+    CHECK_STR(port.out.c_str(), "I dsc: fir");
+    CHECK_EQ(log.pending(), 20);
+
+    // A full ring: the record is dropped and counted, nothing is written
+    CHECK_EQ(log.add(LOG_INFO, "key", "a record much too long for the room left in the ring"), 0);
+    CHECK_EQ(log.overflows, 1);
+    CHECK_EQ(log.add(LOG_INFO, "key", "short"), 1);      // 14 bytes, fits in 44
+    CHECK_EQ(log.pending(), 34);
+
+    // Filtered out: not an overflow
+    log.setLevel(LOG_WARN);
+    CHECK_EQ(log.add(LOG_INFO, "dsc", "hidden"), 0);
+    CHECK_EQ(log.overflows, 1);
+    log.setLevel(LOG_DEBUG);
+
+    // Drained 7 bytes a loop, with records added on the way so the ring wraps
+    std::string expected = "I dsc: first\r\nW zone: second\r\nI key: short\r\n";
+    for (int i=0;i<40;i++) {
+      port.room = 7;
+      size_t n = log.service();
+      CHECK(n <= 7);
+      if (i < 20) {
+        std::string text = "loop " + std::to_string(i);
+        if (log.add(LOG_DEBUG, "t", text.c_str())) expected += "D t: " + text + "\r\n";
+      }
+    }
+    CHECK_EQ(log.pending(), 0);
+    CHECK_EQ(port.overruns, 0);
+    CHECK_STR(port.out.c_str(), expected.c_str());
+    CHECK_EQ(log.bytesOut, expected.size());
+    CHECK(log.records > 10);
+    return testResult("test_log");
+  }
@@ -0,0 +1,88 @@
+/*
+  test_multibus.cpp - MAX_BUSES DSC instances, each on its own pins and
+  driven by its own thread at once, each decoding only its own keybus
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <thread>
+#include <vector>
+#include "test.h"
+#include "keybus.h"
+
+const int WORDS = 200;
+
+DSC buses[MAX_BUSES];
+std::vector<std::string> decoded[MAX_BUSES];
+
+// Bus "n" reports zone n+1 open on every even word, and closed on every odd
+// one, with its own status word in between
+static void runBus(int n)
+  {
+    DSC &dsc = buses[n];
+    KeybusSim sim(4 + n * 2, 5 + n * 2, 1000000 + n * 777);
+
+    for (int i=0;i<WORDS;i++) {
+      byte zones[5] = {0, 0, 0, 0, (byte)((i & 1) ? 0 : 1 << n)};
+      sim.word(panelWord(0x27, zones, 5));
+      byte status[4] = {(byte)(0x81 + n), 0x01, 0x10, (byte)i};
+      sim.word(panelWord(0x05, status, 4, false));
+      while (dsc.process()) {
+        if (dsc.state.pMsg.length()) decoded[n].push_back(dsc.state.pMsg.c_str());
+      }
+    }
+    sim.close();
+    while (dsc.process()) {
+      if (dsc.state.pMsg.length()) decoded[n].push_back(dsc.state.pMsg.c_str());
+    }
+  }
+
+int main()
+  {
+    for (int n=0;n<MAX_BUSES;n++) {
+      buses[n].setCLK(4 + n * 2);
+      buses[n].setDTA_IN(5 + n * 2);
+      buses[n].setSampling(0, 0, 1, 0);   // Read on the edge, timer1 is shared
+      hostSetPin(4 + n * 2, HIGH);        // The clock idles high
+      CHECK_EQ(buses[n].begin(), 1);
+    }
+    DSC extra;
+    CHECK_EQ(extra.begin(), 0);           // Every slot is taken
+
+    std::vector<std::thread> threads;
+    for (int n=0;n<MAX_BUSES;n++) threads.push_back(std::thread(runBus, n));
+    for (std::thread &t : threads) t.join();
+
+    for (int n=0;n<MAX_BUSES;n++) {
+      DSC &dsc = buses[n];
+      CHECK_EQ(dsc.state.overruns, 0);
+      CHECK_EQ(dsc.state.framingErrors, 0);
+      CHECK_EQ(dsc.state.frameCount, WORDS * 2);
+
+      // Every word differs from the one before it, so every word is decoded
+      CHECK_EQ(decoded[n].size(), WORDS * 2);
+      int opens = 0, closes = 0, statuses = 0;
+      std::string open = "{\"ZonesA\":[", closed = open;
+      for (int z=0;z<8;z++) {
+        open += z == n ? "1" : "0";
+        closed += "0";
+        open += z < 7 ? "," : "]}";
+        closed += z < 7 ? "," : "]}";
+      }
+      for (const std::string &m : decoded[n]) {
+        if (m == open) opens++;
+        else if (m == closed) closes++;
+        else if (m.find("{\"Status\"") == 0) statuses++;
+      }
+      CHECK_EQ(opens, WORDS / 2);
+      CHECK_EQ(closes, WORDS / 2);
+      CHECK_EQ(statuses, WORDS);
+    }
+
+    for (int n=0;n<MAX_BUSES;n++) buses[n].end();
+    CHECK_EQ(extra.begin(), 1);           // A slot is free again
+    extra.end();
+    return testResult("test_multibus");
+  }
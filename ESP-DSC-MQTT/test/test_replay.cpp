@@ -0,0 +1,71 @@
+/*
+  test_replay.cpp - A capture of mixed panel words, some closed at their last
+  bit (known length: 0x05, 0x27, 0xa5) and some at the new word gap (0x11,
+  0x0a), each sent with its own keypad word: every panel word comes out of
+  process() paired with the keypad word of its own clock cycles
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <vector>
+#include "test.h"
+#include "keybus.h"
+
+DSC dsc;
+
+struct sent_t
+{
+  std::string panel, keypad;
+};
+
+int main()
+  {
+    hostSetPin(3, HIGH);                  // The clock idles high
+    CHECK_EQ(dsc.begin(), 1);
+    KeybusSim sim(3, 4);
+
+    byte status[4] = {0x81, 0x01, 0x10, 0xc7};
+    byte zones[5] = {0, 0, 0, 0, 0x05};
+    byte date[6] = {0x20, 0x10, 0x12, 0x34, 0x00, 0x01};
+    byte query[3] = {0x55, 0x55, 0x55};
+    byte lcd[4] = {0x01, 0x02, 0x03, 0x04};
+    std::vector<sent_t> sent;
+    for (int i=0;i<8;i++) {
+      std::string p;
+      switch (i % 5) {
+        case 0: status[3] = i; p = panelWord(0x05, status, 4, false); break;
+        case 1: p = panelWord(0x11, query, 3, false); break;            // Unknown length
+        case 2: zones[4] = i; p = panelWord(0x27, zones, 5); break;
+        case 3: p = panelWord(0x0a, lcd, 4); break;                     // Unknown length
+        default: p = panelWord(0xa5, date, 6); break;
+      }
+      // A keypad word of its own for each panel word, as long as it
+      sent.push_back({p, keypadWord(0xff, 0x10 + i, p.size())});
+    }
+
+    std::vector<std::string> panels, keypads;
+    for (const sent_t &s : sent) {
+      sim.word(s.panel, s.keypad);
+      while (dsc.state.frames.front()) {
+        dsc.process();
+        panels.push_back(dsc.state.pWord.c_str());
+        keypads.push_back(dsc.state.kWord.c_str());
+      }
+    }
+    sim.close();
+    while (dsc.state.frames.front()) {
+      dsc.process();
+      panels.push_back(dsc.state.pWord.c_str());
+      keypads.push_back(dsc.state.kWord.c_str());
+    }
+
+    CHECK_EQ(dsc.state.framingErrors, 0);
+    CHECK_EQ(panels.size(), sent.size());
+    for (size_t i=0;i<sent.size() && i<panels.size();i++) {
+      CHECK_STR(panels[i].c_str(), sent[i].panel.c_str());
+      CHECK_STR(keypads[i].c_str(), sent[i].keypad.c_str());
+    }
+    return testResult("test_replay");
+  }
@@ -0,0 +1,104 @@
+/*
+  test_ring.cpp - EventRing: events of any length wrap around the pool,
+  the oldest dropped first, and read() gives back the newest ones intact
+  and in order; a client cursor gets the events after it, a gap when it
+  fell behind the oldest event held, ran ahead of the ring or is of
+  another epoch (from before a restart), and no gap otherwise
+
+  Released into the public domain.
+
+*/
+
+#include <EventRing.h>
+#include <deque>
+#include <string>
+#include "test.h"
+
+static ringEvent_t out[64];
+
+static void wrap()
+  {
+    EventRing ring(512);
+    CHECK_EQ(ring.begin(), 1);
+    std::deque<std::string> sent;
+    unsigned long bad = 0;
+    srand(1);
+    for (int i=0;i<2000;i++) {
+      std::string text(1 + rand() % 80, 'a' + i % 26);
+      text += std::to_string(i);
+      if (ring.add(i, 'P', 0x05, 0, text.c_str()) != (uint32_t)i + 1) bad++;
+      sent.push_back(text);
+
+      // Everything held is the newest events sent, oldest first
+      size_t n = ring.read(0, out, 64);
+      if (n != ring.nextSeq() - ring.firstSeq()) bad++;
+      for (size_t j=0;j<n;j++) {
+        size_t k = sent.size() - n + j;
+        if (out[j].seq != k + 1 || out[j].time != k || sent[k] != out[j].text) bad++;
+      }
+    }
+    CHECK_EQ(bad, 0);
+    CHECK(ring.evicted > 1900);
+    CHECK_EQ(ring.evicted + (ring.nextSeq() - ring.firstSeq()), 2000);
+
+    // Too large for the pool: refused, nothing dropped
+    unsigned long evicted = ring.evicted;
+    std::string huge(300, 'x');
+    CHECK_EQ(ring.add(0, 'P', 0x05, 0, huge.c_str()), 0);
+    CHECK_EQ(ring.dropped, 1);
+    CHECK_EQ(ring.evicted, evicted);
+  }
+
+static void cursor()
+  {
+    EventRing ring(256);                      // 28 bytes an event below, 9 held
+    CHECK_EQ(ring.begin(), 1);
+    ring.epoch = 0x1234abcd;
+    char text[16];
+    for (int i=1;i<=5;i++) {
+      snprintf(text, sizeof(text), "event %d", i);
+      ring.add(i, 'P', 0x05, 0, text);
+    }
+    bool gap;
+    size_t n = ring.readCursor(ring.epoch, 3, out, 64, gap);
+    CHECK_EQ(n, 2);
+    CHECK(!gap);
+    CHECK_EQ(out[0].seq, 4);
+    CHECK_STR(out[1].text, "event 5");
+    CHECK_EQ(ring.readCursor(ring.epoch, 5, out, 64, gap), 0);   // Caught up
+    CHECK(!gap);
+    CHECK_EQ(ring.readCursor(ring.epoch, 0, out, 2, gap), 2);    // At most "max"
+    CHECK_EQ(out[1].seq, 2);
+
+    // Behind the oldest event held: a gap, read from the oldest
+    for (int i=6;i<=20;i++) {
+      snprintf(text, sizeof(text), "event %d", i);
+      ring.add(i, 'P', 0x05, 0, text);
+    }
+    CHECK(ring.firstSeq() > 4);
+    n = ring.readCursor(ring.epoch, 3, out, 64, gap);
+    CHECK(gap);
+    CHECK_EQ(out[0].seq, ring.firstSeq());
+    CHECK_EQ(n, 21 - ring.firstSeq());
+    ring.readCursor(ring.epoch, ring.firstSeq() - 1, out, 64, gap);
+    CHECK(!gap);                              // Just in time
+    ring.readCursor(ring.epoch, 0, out, 64, gap);
+    CHECK(!gap);                              // A new client
+
+    // Ahead of the ring, or from another boot: a gap whatever the number,
+    // since a restarted ring reuses the numbers of the last one
+    ring.readCursor(ring.epoch, 30, out, 64, gap);
+    CHECK(gap);
+    n = ring.readCursor(0x5555aaaa, 18, out, 64, gap);
+    CHECK(gap);
+    CHECK_EQ(out[0].seq, ring.firstSeq());
+    ring.readCursor(0x5555aaaa, 0, out, 64, gap);
+    CHECK(gap);
+  }
+
+int main()
+  {
+    wrap();
+    cursor();
+    return testResult("test_ring");
+  }
@@ -0,0 +1,108 @@
+/*
+  test_rules.cpp - DSCRules fires zone rules on changes only: zones that are
+  already open when the first zone word arrives (or when the zones are
+  preset after a restart) do not fire "open" rules. The repeat of an alarm
+  key, which the keypad sends twice, does not fire a rule a second time
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <DSC_Rules.h>
+#include <vector>
+#include "test.h"
+#include "keybus.h"
+
+DSC dsc;
+DSCRules rules;
+static std::vector<int> published;
+
+static void onRule(const dscRule_t &rule)
+  {
+    published.push_back(rule.target);
+  }
+
+// Sends a zones word for zones 1-8 ("bits", bit 0 = zone 1) with an optional
+// keypad word, and evaluates the rules after it
+static void send(KeybusSim &sim, byte bits, const std::string &keypad = "")
+  {
+    byte zones[5] = {0, 0, 0, 0, bits};
+    std::string p = panelWord(0x27, zones, 5);
+    sim.word(p, keypad.empty() ? keypad : keypad.substr(0, p.size()));
+    hostAdvance(1000);                        // The last bit's samples are taken
+    while (dsc.state.frames.front()) {
+      dsc.process();
+      rules.evaluate(dsc, millis());
+    }
+    rules.evaluate(dsc, millis());            // The next loop, nothing new
+  }
+
+static bool publishedExactly(std::vector<int> ids)
+  {
+    bool same = published == ids;
+    published.clear();
+    return same;
+  }
+
+int main()
+  {
+    hostSetPin(3, HIGH);                      // The clock idles high
+    CHECK_EQ(dsc.begin(), 1);
+    KeybusSim sim(3, 4);
+    rules.setPublish(onRule);
+    CHECK_EQ(rules.add("open 3 > publish 1"), 1);
+    CHECK_EQ(rules.add("close 3 > publish 2"), 1);
+    CHECK_EQ(rules.add("open 1 > publish 3"), 1);
+    CHECK_EQ(rules.add("key panic > publish 4"), 1);
+
+    // Nothing known yet, then zone 3 found open: no rule fires
+    rules.evaluate(dsc, millis());
+    CHECK_EQ(dsc.zoneFilter.known, 0);
+    send(sim, 0x04);
+    CHECK_EQ(dsc.zoneFilter.known, 1);
+    CHECK(publishedExactly({}));
+
+    // Changes from there on do
+    send(sim, 0x00);
+    CHECK(publishedExactly({2}));
+    send(sim, 0x05);
+    CHECK(publishedExactly({1, 3}));
+    send(sim, 0x05);
+    CHECK(publishedExactly({}));
+
+    // Panic, sent twice by the keypad: one publish. Pressed again later: another
+    std::string panicKey = keypadWord(panic, panic, 64);
+    send(sim, 0x05, panicKey);
+    send(sim, 0x05, panicKey);
+    CHECK(publishedExactly({4}));
+    sim.now += RULE_REPEAT_MS * 1000UL;      // The bus idles, see KeybusSim
+    send(sim, 0x05, panicKey);
+    CHECK(publishedExactly({4}));
+    CHECK_EQ(rules.fired, 5);
+
+    // After a restart the zones are preset, zone 1 and 3 open: still nothing,
+    // until zone 3 closes
+    rules.clear();
+    CHECK_EQ(rules.add("open 3 > publish 1"), 1);
+    CHECK_EQ(rules.add("close 3 > publish 2"), 1);
+    byte restored[ZONE_GROUPS] = {0x05, 0, 0, 0};
+    dsc.zoneFilter.preset(restored);
+    rules.evaluate(dsc, millis());
+    send(sim, 0x05);
+    CHECK(publishedExactly({}));
+    send(sim, 0x01);
+    CHECK(publishedExactly({2}));
+
+    // The first bitmap of a group is taken straight away, even with a hold time
+    DSCZoneFilter filter;
+    filter.setDebounce(1000);
+    filter.update(1, 0x80, 0);
+    CHECK_EQ(filter.zones[1], 0x80);
+    CHECK_EQ(filter.known, 2);
+    filter.update(1, 0x00, 10);
+    CHECK_EQ(filter.zones[1], 0x80);          // A change waits for the hold
+    filter.service(1010);
+    CHECK_EQ(filter.zones[1], 0x00);
+    return testResult("test_rules");
+  }
@@ -0,0 +1,155 @@
+/*
+  test_sampling.cpp - Data line sampling (DSC::setSampling()) against the
+  waveforms seen on marginal wiring: a data line that only settles 90 us
+  after the clock edge (slow edges), one that rings for 100 us after it,
+  and a 4 us glitch on one of the three reads. Two buses are driven with
+  the same waveform, one with the default timer1 sampling (3 reads, 20 us
+  apart, 120/200 us after the edge) and one reading on the clock edge: the
+  sampled one decodes every word, the one reading on the edge does not
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <vector>
+#include "test.h"
+#include "keybus.h"
+
+enum wave_t { WAVE_CLEAN, WAVE_SLOW, WAVE_RINGING, WAVE_GLITCH };
+
+DSC sampled, onEdge;
+
+// Drives the clock and data pins of both buses with the same waveform
+class WaveSim
+{
+  public:
+    WaveSim() : now(1000000), level(1) { hostSetMicros(now); setData(1); setClock(HIGH); }
+
+    void word(const std::string &panel, const std::string &keypad, wave_t wave)
+      {
+        now += 15000;                       // New word gap
+        hostSetMicros(now);
+        for (size_t i=0;i<panel.size();i++) {
+          edge(LOW, keypad[i] == '1', 200, wave);
+          edge(HIGH, panel[i] == '1', 120, wave);
+        }
+      }
+
+  private:
+    void setData(bool bit) { level = bit; hostSetPin(4, bit); hostSetPin(6, bit); }
+    void setClock(int clk) { hostSetPin(3, clk); hostSetPin(5, clk); }
+
+    // Data line at "bit" from time "at"
+    void dataAt(unsigned long at, bool bit)
+      {
+        hostSetMicros(at);                  // Reads due before "at" see the old level
+        setData(bit);
+      }
+
+    // A clock edge, then the data line moving to "bit" as "wave" has it. "read"
+    // is when the first of the sampled reads is due after the edge
+    void edge(int clk, bool bit, unsigned int read, wave_t wave)
+      {
+        unsigned long t0 = now;
+        bool was = level;
+        hostSetMicros(t0);
+        if (wave == WAVE_CLEAN || wave == WAVE_GLITCH) setData(bit);
+        setClock(clk);
+        switch (wave) {
+          case WAVE_SLOW:                   // Crosses the threshold 90 us late
+            dataAt(t0 + 90, bit);
+            break;
+          case WAVE_RINGING:                // Overshoots back across it until 100 us
+            dataAt(t0 + 10, bit);
+            for (int k=0;k<3 && was!=bit;k++) {
+              dataAt(t0 + 20 + 25 * k, was);
+              dataAt(t0 + 30 + 25 * k, bit);
+            }
+            break;
+          case WAVE_GLITCH:                 // A spike across the second read
+            dataAt(t0 + read + 18, !bit);
+            dataAt(t0 + read + 22, bit);
+            break;
+          default:
+            break;
+        }
+        now = t0 + 500;
+        hostSetMicros(now);
+      }
+
+    unsigned long now;
+    bool level;
+};
+
+static void pump(DSC &dsc, std::vector<std::string> &panels, std::vector<std::string> &keypads)
+  {
+    while (dsc.state.frames.front()) {
+      dsc.process();
+      panels.push_back(dsc.state.pWord.c_str());
+      keypads.push_back(dsc.state.kWord.c_str());
+    }
+  }
+
+// Sends "words" words with "wave", returns how many each bus got wrong
+static void run(WaveSim &sim, wave_t wave, int words, int &sampledBad, int &edgeBad)
+  {
+    std::vector<std::string> sent, sentKeys;
+    std::vector<std::string> p0, k0, p1, k1;
+
+    // A clean word first, whose gap closes what an earlier run left unfinished
+    byte status[4] = {0x81, 0x01, 0x10, 0xc7};
+    std::string p = panelWord(0x05, status, 4, false);
+    sim.word(p, keypadWord(0xff, 0xff, p.size()), WAVE_CLEAN);
+    pump(sampled, p0, k0);
+    pump(onEdge, p1, k1);
+    p0.clear(), k0.clear(), p1.clear(), k1.clear();
+
+    for (int i=0;i<words;i++) {
+      byte status[4] = {(byte)(0x81 + i), 0x01, (byte)(0x10 ^ i), (byte)(0xc7 - i)};
+      byte zones[5] = {0, 0, 0, (byte)i, (byte)(0x55 ^ i)};
+      std::string p = (i & 1) ? panelWord(0x27, zones, 5) : panelWord(0x05, status, 4, false);
+      std::string k = keypadWord(0xff, (byte)(0x5a ^ i), p.size());
+      sim.word(p, k, wave);
+      sent.push_back(p);
+      sentKeys.push_back(k);
+      pump(sampled, p0, k0);
+      pump(onEdge, p1, k1);
+    }
+
+    sampledBad = words - p0.size();
+    edgeBad = words - p1.size();
+    for (size_t i=0;i<p0.size();i++) sampledBad += p0[i] != sent[i] || k0[i] != sentKeys[i];
+    for (size_t i=0;i<p1.size();i++) edgeBad += p1[i] != sent[i] || k1[i] != sentKeys[i];
+  }
+
+int main()
+  {
+    WaveSim sim;                          // The clocks idle high
+    CHECK_EQ(sampled.begin(), 1);         // Default: 3 reads, 20 us apart, after 120/200 us
+    onEdge.setCLK(5);
+    onEdge.setDTA_IN(6);
+    onEdge.setSampling(0, 0, 1, 0);
+    CHECK_EQ(onEdge.begin(), 1);
+
+    const int WORDS = 40;
+    int sampledBad, edgeBad;
+    run(sim, WAVE_CLEAN, WORDS, sampledBad, edgeBad);
+    CHECK_EQ(sampledBad, 0);
+    CHECK_EQ(edgeBad, 0);
+
+    run(sim, WAVE_SLOW, WORDS, sampledBad, edgeBad);
+    CHECK_EQ(sampledBad, 0);
+    CHECK(edgeBad > WORDS / 2);           // Reads the previous bit
+
+    run(sim, WAVE_RINGING, WORDS, sampledBad, edgeBad);
+    CHECK_EQ(sampledBad, 0);
+    CHECK(edgeBad > WORDS / 2);
+
+    run(sim, WAVE_GLITCH, WORDS, sampledBad, edgeBad);
+    CHECK_EQ(sampledBad, 0);              // Outvoted by the other two reads
+    CHECK_EQ(edgeBad, 0);                 // Misses it altogether
+
+    CHECK_EQ(sampled.state.framingErrors, 0);
+    return testResult("test_sampling");
+  }
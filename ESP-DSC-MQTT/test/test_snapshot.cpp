@@ -0,0 +1,110 @@
+/*
+  test_snapshot.cpp - the warm restart snapshot: the words a DSC decoded
+  are saved with saveState(), restored into a second DSC with
+  restoreState() before its begin(), and re-decoded by restoreWord() to
+  the same messages and state. Empty slots and slots past SNAP_WORDS
+  return 0, and the restored DSC numbers its frames on from the first
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include "test.h"
+#include "keybus.h"
+
+DSC before, after;
+static std::string sentWord[SNAP_WORDS], sentMsg[SNAP_WORDS];
+
+static int slotOf(byte cmd)
+  {
+    for (byte i=0;i<SNAP_WORDS;i++) {
+      if (SNAP_CMDS[i] == cmd) return i;
+    }
+    return -1;
+  }
+
+// Sends "w" to "dsc" and decodes it, keeping the word and message of the
+// commands in the snapshot
+static void send(DSC &dsc, KeybusSim &sim, const std::string &w)
+  {
+    sim.word(w);
+    hostAdvance(1000);                        // The last bit's samples are taken
+    while (dsc.state.frames.front()) {
+      dsc.process();
+      int i = slotOf(dsc.state.pCmd);
+      if (i < 0) continue;
+      sentWord[i] = dsc.state.pWord.c_str();
+      sentMsg[i] = dsc.state.pMsg.c_str();
+    }
+  }
+
+int main()
+  {
+    hostSetPin(3, HIGH);                      // The clocks idle high
+    hostSetPin(5, HIGH);
+    CHECK_EQ(before.begin(), 1);
+    KeybusSim sim(3, 4);
+
+    byte status[4] = {0x82, 0x01, 0x10, 0xc7};  // Armed
+    byte zonesA[5] = {0, 0, 0, 0, 0x05};
+    byte zonesC[5] = {0, 0, 0, 0, 0x80};
+    byte query[3] = {0x55, 0x55, 0x55};
+    send(before, sim, panelWord(0x05, status, 4, false));
+    send(before, sim, panelWord(0x27, zonesA, 5));
+    send(before, sim, panelWord(0x11, query, 3, false));     // Not kept
+    send(before, sim, panelWord(0x34, zonesC, 5));
+    send(before, sim, "10100101000100100000101100010111010000000100110110000000000101000");
+    CHECK_EQ(before.state.frameCount, 5);
+
+    dscSnapshot_t snap;
+    before.saveState(snap);
+    CHECK_EQ(snap.frameCount, 5);
+    CHECK_EQ(snap.bits[slotOf(0x05)], 41);
+    CHECK_EQ(snap.bits[slotOf(0xa5)], 65);
+    CHECK_EQ(snap.bits[slotOf(0x2d)], 0);     // Never sent
+    CHECK_EQ(snap.zones[0], 0x05);
+    CHECK_EQ(snap.zones[2], 0x80);
+
+    // Restored before begin(), as the sketch does
+    after.setCLK(5);
+    after.setDTA_IN(6);
+    after.restoreState(snap);
+    CHECK_EQ(after.state.frameCount, 5);
+    CHECK_EQ(after.zoneFilter.known, (1 << ZONE_GROUPS) - 1);
+    CHECK_EQ(after.zoneFilter.zones[0], 0x05);
+    CHECK_EQ(after.zoneFilter.zones[2], 0x80);
+    CHECK_EQ(after.begin(), 1);
+
+    // Each kept word decodes as it did the first time
+    int restored = 0;
+    for (byte i=0;i<SNAP_WORDS;i++) {
+      byte cmd = after.restoreWord(i);
+      if (sentWord[i].empty()) {
+        CHECK_EQ(cmd, 0);
+        CHECK_EQ(after.state.pCmd, 0);
+        CHECK_EQ(after.state.pMsg.length(), 0);
+        continue;
+      }
+      restored++;
+      CHECK_EQ(cmd, SNAP_CMDS[i]);
+      CHECK_EQ(after.state.pCmd, SNAP_CMDS[i]);
+      CHECK_STR(after.state.pWord.c_str(), sentWord[i].c_str());
+      CHECK_STR(after.state.pMsg.c_str(), sentMsg[i].c_str());
+    }
+    CHECK_EQ(restored, 4);
+    CHECK_EQ(after.state.armed, 1);
+    CHECK_EQ(after.state.armUser, 3);
+    CHECK_EQ(after.state.zones[2], 0x80);
+
+    // Out of range: nothing decoded
+    CHECK_EQ(after.restoreWord(SNAP_WORDS), 0);
+    CHECK_EQ(after.state.pCmd, 0);
+    CHECK_EQ(after.state.pMsg.length(), 0);
+
+    // Frames received after the restart are numbered on from before it
+    KeybusSim sim2(5, 6, sim.now);
+    send(after, sim2, panelWord(0x05, status, 4, false));
+    CHECK_EQ(after.state.frameSeq, 6);
+    return testResult("test_snapshot");
+  }
@@ -0,0 +1,74 @@
+/*
+  test_stats.cpp - Traffic census (DSC_Stats.h): repeated words count as
+  decoded, and checksum failures are only counted for the commands that
+  carry a checksum
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include "test.h"
+#include "keybus.h"
+
+DSC dsc;
+
+static void send(KeybusSim &sim, const std::string &panel)
+  {
+    sim.word(panel);
+    while (dsc.process());
+  }
+
+int main()
+  {
+    hostSetPin(3, HIGH);                  // The clock idles high
+    CHECK_EQ(dsc.begin(), 1);
+    KeybusSim sim(3, 4);
+
+    byte status[4] = {0x81, 0x01, 0x10, 0xc7};
+    byte zones[5] = {0, 0, 0, 0, 0x05};
+    for (int i=0;i<3;i++) send(sim, panelWord(0x05, status, 4, false));   // No checksum
+    for (int i=0;i<2;i++) send(sim, panelWord(0x27, zones, 5));
+    std::string bad = panelWord(0x27, zones, 5);
+    bad[bad.size() - 1] ^= 1;             // Checksum off by one
+    send(sim, bad);
+    byte query[3] = {0x55, 0x55, 0x55};
+    send(sim, panelWord(0x11, query, 3, false));
+    send(sim, panelWord(0x77, query, 3, false));  // Not known to the decoder
+    sim.close();
+    while (dsc.process());
+
+    const dscCmdStat_t *s = dsc.pStats.find(0x05);
+    CHECK(s != NULL);
+    if (s) {
+      CHECK_EQ(s->seen, 3);
+      CHECK_EQ(s->decoded, 3);            // Two of them repeats
+      CHECK_EQ(s->chkFail, 0);
+      CHECK_EQ(s->minBits, 41);
+    }
+    s = dsc.pStats.find(0x27);
+    CHECK(s != NULL);
+    if (s) {
+      CHECK_EQ(s->seen, 3);
+      CHECK_EQ(s->decoded, 3);
+      CHECK_EQ(s->chkFail, 1);
+    }
+    s = dsc.pStats.find(0x11);
+    CHECK(s != NULL);
+    if (s) {
+      CHECK_EQ(s->decoded, 1);
+      CHECK_EQ(s->chkFail, 0);
+      CHECK_EQ(s->maxBits, 33);
+    }
+    s = dsc.pStats.find(0x77);
+    CHECK(s != NULL);
+    if (s) {
+      CHECK_EQ(s->seen, 1);
+      CHECK_EQ(s->decoded, 0);
+      CHECK_EQ(s->chkFail, 0);            // Not known to carry a checksum
+    }
+    CHECK(dsc.pnlKnown(0xa5) && dsc.pnlHasChkSum(0xa5));
+    CHECK(dsc.pnlKnown(0x05) && !dsc.pnlHasChkSum(0x05));
+    CHECK(!dsc.pnlKnown(0x77) && !dsc.pnlHasChkSum(0x77));
+    return testResult("test_stats");
+  }
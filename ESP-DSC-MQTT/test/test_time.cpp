@@ -0,0 +1,174 @@
+/*
+  test_time.cpp - breakTime() and makeTime() in lib/Time, now in closed
+  form, against the loops they replaced (copied below as they were) over
+  the whole 32 bit time_t range, one time a day with the time of day
+  sliding; formatIso8601(); and the time per call of both, old and new
+
+  Released into the public domain.
+
+*/
+
+#include <TimeLib.h>
+#include <chrono>
+#include "test.h"
+
+static_assert(daysFromCivil(1970, 1, 1) == 0, "the epoch");
+static_assert(daysFromCivil(2000, 3, 1) == 11017, "after the leap day of a year 400");
+static_assert(daysFromCivil(2106, 2, 7) == 49710, "the last day of a 32 bit time_t");
+
+// ----- The loops of lib/Time before, unchanged but for the names -----
+
+// leap year calulator expects year argument as years offset from 1970
+#define LEAP_YEAR(Y)     ( ((1970+Y)>0) && !((1970+Y)%4) && ( ((1970+Y)%100) || !((1970+Y)%400) ) )
+
+static  const uint8_t monthDays[]={31,28,31,30,31,30,31,31,30,31,30,31}; // API starts months from 1, this array starts from 0
+
+static void oldBreakTime(time_t timeInput, tmElements_t &tm){
+  uint8_t year;
+  uint8_t month, monthLength;
+  uint32_t time;
+  unsigned long days;
+
+  time = (uint32_t)timeInput;
+  tm.Second = time % 60;
+  time /= 60; // now it is minutes
+  tm.Minute = time % 60;
+  time /= 60; // now it is hours
+  tm.Hour = time % 24;
+  time /= 24; // now it is days
+  tm.Wday = ((time + 4) % 7) + 1;  // Sunday is day 1
+
+  year = 0;
+  days = 0;
+  while((unsigned)(days += (LEAP_YEAR(year) ? 366 : 365)) <= time) {
+    year++;
+  }
+  tm.Year = year; // year is offset from 1970
+
+  days -= LEAP_YEAR(year) ? 366 : 365;
+  time  -= days; // now it is days in this year, starting at 0
+
+  days=0;
+  month=0;
+  monthLength=0;
+  for (month=0; month<12; month++) {
+    if (month==1) { // february
+      if (LEAP_YEAR(year)) {
+        monthLength=29;
+      } else {
+        monthLength=28;
+      }
+    } else {
+      monthLength = monthDays[month];
+    }
+
+    if (time >= monthLength) {
+      time -= monthLength;
+    } else {
+        break;
+    }
+  }
+  tm.Month = month + 1;  // jan is month 1
+  tm.Day = time + 1;     // day of month
+}
+
+static time_t oldMakeTime(tmElements_t &tm){
+  int i;
+  uint32_t seconds;
+
+  // seconds from 1970 till 1 jan 00:00:00 of the given year
+  seconds= tm.Year*(SECS_PER_DAY * 365);
+  for (i = 0; i < tm.Year; i++) {
+    if (LEAP_YEAR(i)) {
+      seconds +=  SECS_PER_DAY;   // add extra days for leap years
+    }
+  }
+
+  // add days for this year, months start from 1
+  for (i = 1; i < tm.Month; i++) {
+    if ( (i == 2) && LEAP_YEAR(tm.Year)) {
+      seconds += SECS_PER_DAY * 29;
+    } else {
+      seconds += SECS_PER_DAY * monthDays[i-1];  //monthDay array starts from 0
+    }
+  }
+  seconds+= (tm.Day-1) * SECS_PER_DAY;
+  seconds+= tm.Hour * SECS_PER_HOUR;
+  seconds+= tm.Minute * SECS_PER_MIN;
+  seconds+= tm.Second;
+  return (time_t)seconds;
+}
+
+// ----- The test -----
+
+static bool same(const tmElements_t &a, const tmElements_t &b)
+  {
+    return a.Second == b.Second && a.Minute == b.Minute && a.Hour == b.Hour && a.Wday == b.Wday &&
+           a.Day == b.Day && a.Month == b.Month && a.Year == b.Year;
+  }
+
+// Nanoseconds per call of breakTime() (or makeTime() after it) over the range
+static double timeCalls(bool old, bool make)
+  {
+    const uint32_t STEP = 9973;
+    volatile uint32_t sink = 0;
+    unsigned long calls = 0;
+    tmElements_t tm;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t t=0;t<=0xFFFFFFFFull;t+=STEP) {
+      if (old) oldBreakTime((time_t)t, tm);
+      else breakTime((time_t)t, tm);
+      sink += make ? (old ? oldMakeTime(tm) : makeTime(tm)) : tm.Day;
+      calls++;
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / calls;
+  }
+
+int main()
+  {
+    // Every day of the range, at a time of day 7 s earlier than the day before
+    unsigned long days = 0, breakDiffers = 0, makeDiffers = 0, roundTrips = 0;
+    for (uint64_t t=0;t<=0xFFFFFFFFull;t+=SECS_PER_DAY-7) {
+      tmElements_t a, b;
+      oldBreakTime((time_t)t, a);
+      breakTime((time_t)t, b);
+      if (!same(a, b)) {
+        if (!breakDiffers++) fprintf(stderr, "test_time: breakTime(%llu) differs\n", (unsigned long long)t);
+      }
+      if (makeTime(b) != oldMakeTime(a)) {
+        if (!makeDiffers++) fprintf(stderr, "test_time: makeTime() of %llu differs\n", (unsigned long long)t);
+      }
+      roundTrips += makeTime(b) == (time_t)t;
+      days++;
+    }
+    CHECK_EQ(breakDiffers, 0);
+    CHECK_EQ(makeDiffers, 0);
+    CHECK_EQ(roundTrips, days);
+
+    // The ends of the range, and a leap day
+    tmElements_t tm;
+    breakTime(0xFFFFFFFF, tm);
+    CHECK_EQ(tmYearToCalendar(tm.Year), 2106);
+    CHECK_EQ(tm.Month, 2);
+    CHECK_EQ(tm.Day, 7);
+    CHECK_EQ(tm.Second, 15);
+    breakTime(951782400, tm);                 // 2000-02-29
+    CHECK_EQ(tm.Month, 2);
+    CHECK_EQ(tm.Day, 29);
+
+    char buf[ISO8601_LEN];
+    CHECK_EQ(formatIso8601(0, buf, sizeof(buf)), ISO8601_LEN - 1);
+    CHECK_STR(buf, "1970-01-01T00:00:00Z");
+    formatIso8601(1714566896, buf, sizeof(buf));
+    CHECK_STR(buf, "2024-05-01T12:34:56Z");
+    formatIso8601(0xFFFFFFFF, buf, sizeof(buf));
+    CHECK_STR(buf, "2106-02-07T06:28:15Z");
+    CHECK_EQ(formatIso8601(0, buf, ISO8601_LEN - 1), 0);   // Too small
+
+    double oldBreak = timeCalls(true, false), newBreak = timeCalls(false, false);
+    double oldMake = timeCalls(true, true), newMake = timeCalls(false, true);
+    printf("test_time: breakTime %.1f ns (was %.1f), breakTime+makeTime %.1f ns (was %.1f)\n",
+           newBreak, oldBreak, newMake, oldMake);
+    return testResult("test_time");
+  }
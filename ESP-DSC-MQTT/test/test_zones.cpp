@@ -0,0 +1,116 @@
+/*
+  test_zones.cpp - DSCZoneFilter on its own, fed bitmaps at set times: a
+  change is passed on once it has held for the hold time (per zone if set),
+  a flip back before then is counted as suppressed, a zone flipping too
+  often is frozen as chattering until it has been quiet for a window, and
+  preset() makes the zones known without any of them counting as a change
+
+  Released into the public domain.
+
+*/
+
+#include <DSC_Zones.h>
+#include "test.h"
+
+static void hold()
+  {
+    DSCZoneFilter f;
+    f.update(0, 0x00, 0);
+    f.update(0, 0x01, 10);
+    CHECK_EQ(f.zones[0], 0x01);               // Pass-through until setDebounce()
+
+    f.setDebounce(500);
+    f.update(0, 0x00, 1000);
+    CHECK_EQ(f.zones[0], 0x01);
+    f.service(1499);
+    CHECK_EQ(f.zones[0], 0x01);
+    unsigned long version = f.version;
+    f.service(1500);                          // Held for 500 ms
+    CHECK_EQ(f.zones[0], 0x00);
+    CHECK_EQ(f.version, version + 1);
+
+    // Open and closed again within the hold: never passed on, counted
+    version = f.version;
+    f.update(0, 0x01, 2000);
+    f.update(0, 0x00, 2200);
+    f.service(5000);
+    CHECK_EQ(f.zones[0], 0x00);
+    CHECK_EQ(f.version, version);
+    CHECK_EQ(f.suppressed, 1);
+
+    // A zone with a hold of its own (zone 2 is bit 1)
+    f.setHold(2, 0);
+    f.update(0, 0x03, 6000);
+    CHECK_EQ(f.zones[0], 0x02);
+    f.service(6500);
+    CHECK_EQ(f.zones[0], 0x03);
+  }
+
+static void chatter()
+  {
+    DSCZoneFilter f;
+    f.setDebounce(100, 3, 1000);
+    f.update(0, 0x00, 0);
+
+    // Five flips in 50 ms, one more than allowed: chattering from the fourth
+    byte bits = 0;
+    for (unsigned long t=10;t<=50;t+=10) {
+      bits ^= 0x01;
+      f.update(0, bits, t);
+      CHECK_EQ(f.chatterEvents, t >= 40 ? 1 : 0);
+    }
+    CHECK_EQ(f.chatter[0], 0x01);
+    CHECK_EQ(f.zones[0], 0x00);               // Frozen, nothing passed on
+    CHECK_EQ(f.suppressed, 3);                // The flips back, and the one while frozen
+
+    // Still chattering until a whole window has gone by without a flip, then
+    // its state is passed on
+    f.service(1049);
+    CHECK_EQ(f.chatter[0], 0x01);
+    CHECK_EQ(f.zones[0], 0x00);
+    unsigned long version = f.version;
+    f.service(1050);
+    CHECK_EQ(f.chatter[0], 0x00);
+    CHECK_EQ(f.zones[0], 0x01);
+    CHECK_EQ(f.version, version + 2);         // Chatter off, zone open
+
+    // Slow flips, one per window, never chatter
+    for (unsigned long t=2000;t<8000;t+=1000) {
+      bits ^= 0x01;
+      f.update(0, bits, t);
+      f.service(t + 100);
+      CHECK_EQ(f.zones[0], bits);
+    }
+    CHECK_EQ(f.chatterEvents, 1);
+  }
+
+static void preset()
+  {
+    DSCZoneFilter f;
+    f.setDebounce(500);
+    CHECK_EQ(f.known, 0);
+    byte restored[ZONE_GROUPS] = {0x05, 0x00, 0x80, 0x00};
+    f.preset(restored);
+    CHECK_EQ(f.known, (1 << ZONE_GROUPS) - 1);
+    CHECK(memcmp(f.zones, restored, ZONE_GROUPS) == 0);
+
+    // The same bitmaps decoded again are no change, and a change after a
+    // preset is held like any other (not taken as the first bitmap)
+    unsigned long version = f.version;
+    f.update(0, 0x05, 100);
+    f.update(2, 0x80, 100);
+    CHECK_EQ(f.version, version);
+    f.update(0, 0x04, 200);
+    CHECK_EQ(f.zones[0], 0x05);
+    f.service(700);
+    CHECK_EQ(f.zones[0], 0x04);
+    CHECK_EQ(f.suppressed, 0);
+  }
+
+int main()
+  {
+    hold();
+    chatter();
+    preset();
+    return testResult("test_zones");
+  }
@@ -0,0 +1,243 @@
+/*
+  dsccorr.cpp - Keybus bit analyser: correlates every bit of the journalled
+  words of each command byte with labelled external events, and lists the
+  bits most likely to carry each one (lib/BitCorrelator)
+
+    dsccorr [-k] [-n top] labels journal ...
+
+  Each journal is a FileJournalStorage file (pages of JOURNAL_PAGE_SIZE
+  bytes, as the host builds write) or a directory of page files as the
+  sketch keeps them on LittleFS (/journal/000, /journal/001...), copied off
+  the device. Every word of every journal is counted, oldest first; the
+  panel words, or with -k the keypad words.
+
+  The labels file has a line per stretch of time an event was seen:
+
+    <from> <to> <label>     e.g. "1717000000 1717000600 mains-off"
+
+  times in the journal's own seconds (epoch, or uptime for the events
+  journalled before NTP synced), from inclusive, to exclusive. A label
+  may have any number of lines; up to CORR_LABELS labels.
+
+  For each label, dsccorr prints the number of words seen while it was
+  active, then the -n (default 5) bits with the largest phi coefficient
+  across all command bytes, e.g.
+
+    label mains-off: 612 of 48213 words
+      cmd 0x05 bit 29: phi +0.998, set in 615 words, 611 while active
+
+  Bit 0 is the MSB of the command byte, as in binToInt(pWord, bit, 1).
+
+  Released into the public domain.
+
+*/
+
+#include <BitCorrelator.h>
+#include <EventJournal.h>
+#include <algorithm>
+#include <dirent.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <string>
+
+#define READ_EVENTS 256               // Events read from a journal at a time
+
+typedef struct
+{
+  uint32_t from, to;
+  uint8_t label;
+}
+span_t;
+
+static std::vector<span_t> spans;
+static std::vector<std::string> labels;
+static BitCorrelator corr;
+static bool seen[256];                // Command bytes counted
+static unsigned long words = 0, badPages = 0;
+
+// Journal pages kept one file per page in a directory, as FSJournalStorage
+// writes them on the device. Read only
+class DirJournalStorage : public JournalStorage
+{
+  public:
+    DirJournalStorage(const char *path) : _path(path), _pages(0)
+      {
+        // As many pages as the highest page file, pages never written are skipped
+        DIR *dir = opendir(path);
+        if (!dir) return;
+        struct dirent *d;
+        while ((d = readdir(dir))) {
+          char *end;
+          unsigned long n = strtoul(d->d_name, &end, 10);
+          if (end != d->d_name && !*end && n < 0xffff && n + 1 > _pages) _pages = n + 1;
+        }
+        closedir(dir);
+        if (_pages == 1) _pages = 2;          // EventJournal needs a ring
+      }
+
+    virtual uint16_t pages() { return _pages; }
+
+    virtual int readPage(uint16_t index, journalPage_t *page)
+      {
+        char name[512];
+        snprintf(name, sizeof(name), "%s/%03u", _path, index);
+        FILE *f = fopen(name, "rb");
+        if (!f) return 0;                     // return failure (not written)
+        size_t n = fread(page, sizeof(journalPage_t), 1, f);
+        fclose(f);
+        return n == 1;
+      }
+
+    virtual int writePage(uint16_t index, const journalPage_t *page) { return 0; }
+
+  private:
+    const char *_path;
+    uint16_t _pages;
+};
+
+static int loadLabels(const char *path)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+      fprintf(stderr, "dsccorr: cannot open %s\n", path);
+      return 0;
+    }
+    char line[256];
+    int n = 0;
+    while (fgets(line, sizeof(line), f)) {
+      n++;
+      unsigned long from, to;
+      char name[64];
+      if (line[0] == '#' || line[strspn(line, " \t\r\n")] == 0) continue;
+      if (sscanf(line, "%lu %lu %63s", &from, &to, name) != 3 || to < from) {
+        fprintf(stderr, "dsccorr: %s:%d: expected \"<from> <to> <label>\"\n", path, n);
+        fclose(f);
+        return 0;
+      }
+      size_t l = 0;
+      while (l < labels.size() && labels[l] != name) l++;
+      if (l == labels.size()) {
+        if (l == CORR_LABELS) {
+          fprintf(stderr, "dsccorr: %s:%d: more than %d labels\n", path, n, CORR_LABELS);
+          fclose(f);
+          return 0;
+        }
+        labels.push_back(name);
+      }
+      spans.push_back({(uint32_t)from, (uint32_t)to, (uint8_t)l});
+    }
+    fclose(f);
+    return 1;
+  }
+
+// The labels active at "time"
+static uint32_t activeAt(uint32_t time)
+  {
+    uint32_t active = 0;
+    for (const span_t &s : spans) {
+      if (time >= s.from && time < s.to) active |= (uint32_t)1 << s.label;
+    }
+    return active;
+  }
+
+// Counts the words of one journal, returns 0 if it cannot be read
+static int loadJournal(const char *path, bool keypad)
+  {
+    struct stat st;
+    if (stat(path, &st)) {
+      fprintf(stderr, "dsccorr: cannot open %s\n", path);
+      return 0;
+    }
+    JournalStorage *storage;
+    if (S_ISDIR(st.st_mode)) storage = new DirJournalStorage(path);
+    else storage = new FileJournalStorage(path, st.st_size / JOURNAL_PAGE_SIZE);
+
+    EventJournal journal(*storage);
+    if (!journal.begin()) {
+      fprintf(stderr, "dsccorr: %s is not a journal\n", path);
+      delete storage;
+      return 0;
+    }
+    static journalEvent_t events[READ_EVENTS];
+    uint32_t from = journal.firstSeq();
+    size_t n;
+    while ((n = journal.read(from, events, READ_EVENTS))) {
+      for (size_t i=0;i<n;i++) {
+        journalEvent_t &e = events[i];
+        if (!(e.flags & JOURNAL_FLAG_KEYPAD) != !keypad) continue;
+        corr.add(e.data, e.bits, activeAt(e.time));
+        seen[e.cmd] = true;
+        words++;
+      }
+      from = events[n - 1].seq + 1;
+    }
+    badPages += journal.badPages;
+    journal.end();
+    delete storage;
+    return 1;
+  }
+
+static void report(uint8_t label, size_t top)
+  {
+    // The best "top" candidates of every command byte, then the best of those
+    std::vector<std::pair<uint8_t, corrCandidate_t> > best;
+    std::vector<corrCandidate_t> found(top);
+    unsigned long active = 0;
+    for (int cmd=0;cmd<256;cmd++) {
+      if (!seen[cmd]) continue;
+      active += corr.frames(cmd, label);
+      size_t n = corr.candidates(cmd, label, found.data(), top);
+      for (size_t i=0;i<n;i++) best.push_back(std::make_pair((uint8_t)cmd, found[i]));
+    }
+    std::stable_sort(best.begin(), best.end(),
+                     [](const std::pair<uint8_t, corrCandidate_t> &a, const std::pair<uint8_t, corrCandidate_t> &b)
+                     { return fabs(a.second.phi) > fabs(b.second.phi); });
+
+    printf("label %s: %lu of %lu words\n", labels[label].c_str(), active, words);
+    for (size_t i=0;i<best.size() && i<top;i++) {
+      const corrCandidate_t &c = best[i].second;
+      printf("  cmd 0x%02x bit %u: phi %+.3f, set in %u words, %u while active\n",
+             best[i].first, c.bit, c.phi, c.ones, c.onesLabelled);
+    }
+  }
+
+static int usage()
+  {
+    fprintf(stderr, "usage: dsccorr [-k] [-n top] labels journal ...\n"
+                    "  labels: lines of \"<from> <to> <label>\", journal: a journal file or page directory\n");
+    return 2;
+  }
+
+int main(int argc, char **argv)
+  {
+    bool keypad = false;
+    size_t top = 5;
+    int opt;
+    while ((opt = getopt(argc, argv, "kn:")) != -1) {
+      switch (opt) {
+        case 'k': keypad = true; break;
+        case 'n': top = atoi(optarg); break;
+        default: return usage();
+      }
+    }
+    if (argc - optind < 2 || top < 1) return usage();
+    if (!loadLabels(argv[optind])) return 1;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i=optind+1;i<argc;i++) {
+      if (!loadJournal(argv[i], keypad)) return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    fprintf(stderr, "dsccorr: %lu %s words in %.2f s, %lu bad pages, %lu words of commands over %d\n",
+            words, keypad ? "keypad" : "panel", secs, badPages, corr.other, CORR_SLOTS);
+    for (uint8_t l=0;l<labels.size();l++) report(l, top);
+    return 0;
+  }
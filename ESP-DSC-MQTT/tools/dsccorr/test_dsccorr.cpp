@@ -0,0 +1,157 @@
+/*
+  test_dsccorr.cpp - dsccorr on a synthetic capture: a journal of random
+  panel and keypad words in which a few bits follow labelled events (with
+  some noise), written with EventJournal as the device would. dsccorr must
+  name those bits first for their labels, from the journal file and from
+  the same pages as a directory of page files
+
+    test_dsccorr path/to/dsccorr
+
+  Released into the public domain.
+
+*/
+
+#include <EventJournal.h>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "test.h"
+
+#define PAGES 2000
+#define WORDS 25000                           // 4 a second, the journal does not wrap
+
+static char dir[] = "/tmp/test_dsccorr_XXXXXX";
+
+// Runs dsccorr, returns what it printed, or "" if it failed
+static std::string run(const char *dsccorr, const char *args)
+  {
+    std::string cmd = std::string(dsccorr) + " " + args;
+    FILE *p = popen(cmd.c_str(), "r");
+    if (!p) return "";
+    std::string out;
+    char buf[256];
+    while (fgets(buf, sizeof(buf), p)) out += buf;
+    return pclose(p) == 0 ? out : "";
+  }
+
+// The first candidate line after "label <name>:"
+static std::string best(const std::string &out, const char *name)
+  {
+    size_t i = out.find(std::string("label ") + name + ":");
+    if (i == std::string::npos) return "";
+    i = out.find('\n', i);
+    if (i == std::string::npos) return "";
+    return out.substr(i + 1, out.find('\n', i + 1) - i - 1);
+  }
+
+static std::string header(const std::string &out, const char *name)
+  {
+    size_t i = out.find(std::string("label ") + name + ":");
+    if (i == std::string::npos) return "";
+    return out.substr(i, out.find('\n', i) - i);
+  }
+
+static void checkReport(const std::string &out, unsigned long panel, unsigned long mainsOff)
+  {
+    char line[128];
+    snprintf(line, sizeof(line), "label mains-off: %lu of %lu words", mainsOff, panel);
+    std::string mains = best(out, "mains-off"), zone = best(out, "zone-3"), armed = best(out, "armed");
+    std::string head = header(out, "mains-off");
+    CHECK_STR(head.c_str(), line);
+    mains.resize(27);                         // Up to the first decimals of phi
+    zone.resize(27);
+    armed.resize(27);
+    CHECK_STR(mains.c_str(), "  cmd 0x05 bit 29: phi +0.9");
+    CHECK_STR(zone.c_str(), "  cmd 0x27 bit 11: phi +0.9");
+    CHECK_STR(armed.c_str(), "  cmd 0x05 bit 15: phi -0.9");
+  }
+
+int main(int argc, char **argv)
+  {
+    if (argc < 2) {
+      fprintf(stderr, "usage: test_dsccorr path/to/dsccorr\n");
+      return 2;
+    }
+    CHECK(mkdtemp(dir) != NULL);
+    std::string journalFile = std::string(dir) + "/journal.bin";
+    std::string labelFile = std::string(dir) + "/labels";
+    std::string pageDir = std::string(dir) + "/journal";
+
+    // Labels: mains off twice, zone 3 open once, armed for a long stretch
+    const uint32_t T0 = 1000;
+    FILE *f = fopen(labelFile.c_str(), "w");
+    fprintf(f, "# from to label\n3000 4000 mains-off\n2000 2600 zone-3\n4500 5200 armed\n6000 6500 mains-off\n");
+    fclose(f);
+
+    // The capture: 0x05 words carry mains-off in bit 29 and armed, inverted,
+    // in bit 15; 0x27 words carry zone 3 in bit 11. Every other bit is
+    // random, and one word in fifty has the labelled bit wrong
+    {
+      FileJournalStorage storage(journalFile.c_str(), PAGES);
+      EventJournal journal(storage);
+      CHECK_EQ(journal.begin(), 1);
+      std::mt19937 rng(39);
+      unsigned long panel = 0, mainsOff = 0, added = 0;
+      for (int i=0;i<WORDS;i++) {
+        uint32_t t = T0 + i / 4;
+        bool keypad = i % 5 == 4;
+        byte cmd = keypad ? 0xff : (i % 2 ? 0x05 : 0x27);
+        std::string w;
+        for (int b=0;b<8;b++) w += cmd & (0x80 >> b) ? '1' : '0';
+        while (w.size() < 49) w += rng() & 1 ? '1' : '0';
+        bool noise = rng() % 50 == 0;
+        bool off = (t >= 3000 && t < 4000) || (t >= 6000 && t < 6500);
+        if (cmd == 0x05) {
+          w[29] = off != noise ? '1' : '0';
+          w[15] = (t >= 4500 && t < 5200) == noise ? '1' : '0';
+        }
+        if (cmd == 0x27) w[11] = (t >= 2000 && t < 2600) != noise ? '1' : '0';
+        panel += !keypad;
+        mainsOff += !keypad && off;
+        added += journal.add(t, i * 250, keypad ? JOURNAL_FLAG_KEYPAD : 0, w.c_str(), w.size()) != 0;
+        journal.service(i * 250);
+      }
+      CHECK_EQ(added, WORDS);
+      CHECK_EQ(journal.flush(), 1);
+      CHECK_EQ(journal.dropped, 0);
+      journal.end();
+
+      std::string args = labelFile + " " + journalFile;
+      std::string out = run(argv[1], args.c_str());
+      CHECK(out.size() > 0);
+      checkReport(out, panel, mainsOff);
+
+      // The same pages as the sketch keeps them, one file each
+      CHECK_EQ(mkdir(pageDir.c_str(), 0700), 0);
+      journalPage_t page;
+      int copied = 0;
+      for (uint16_t p=0;p<PAGES;p++) {
+        if (!storage.readPage(p, &page) || page.magic != JOURNAL_MAGIC) continue;
+        char name[160];
+        snprintf(name, sizeof(name), "%s/%03u", pageDir.c_str(), p);
+        FILE *pf = fopen(name, "wb");
+        fwrite(&page, sizeof(page), 1, pf);
+        fclose(pf);
+        copied++;
+      }
+      CHECK_EQ(copied, (WORDS + JOURNAL_PAGE_EVENTS - 1) / JOURNAL_PAGE_EVENTS);
+      args = labelFile + " " + pageDir;
+      std::string fromDir = run(argv[1], args.c_str());
+      CHECK_STR(fromDir.c_str(), out.c_str());
+
+      // -k counts the keypad words only, none of which follow a label
+      args = "-k -n 1 " + labelFile + " " + journalFile;
+      out = run(argv[1], args.c_str());
+      CHECK(header(out, "mains-off").find(" of " + std::to_string(WORDS - panel) + " words") != std::string::npos);
+      CHECK(best(out, "mains-off").find("phi +0.9") == std::string::npos);
+    }
+
+    // A file that is not a journal is refused
+    std::string args = labelFile + " " + labelFile;
+    CHECK(run(argv[1], args.c_str()).empty());
+
+    std::string rm = std::string("rm -rf ") + dir;
+    CHECK_EQ(system(rm.c_str()), 0);
+    return testResult("test_dsccorr");
+  }
@@ -0,0 +1,269 @@
+#include "GwSource.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <linux/gpio.h>
+
+#define GW_HALF_BIT 500               // us between the edges of an F line word
+#define GW_GAP 15000                  // New word gap before it, us
+
+// ------------------------------------------------------------------
+// --------------------------- GwSource -----------------------------
+// ------------------------------------------------------------------
+
+GwSource::GwSource(gwEdgeQueue &edges, std::atomic<bool> &stop)
+  : edges(0), overruns(0), badLines(0), queue(edges), stop(stop)
+  {
+  }
+
+GwSource *GwSource::make(const char *spec, gwEdgeQueue &edges, std::atomic<bool> &stop)
+  {
+    char path[128];
+    if (!strncmp(spec, "file:", 5)) return new GwLineSource(spec + 5, 0, edges, stop);
+    if (!strncmp(spec, "serial:", 7)) {
+      snprintf(path, sizeof(path), "%s", spec + 7);
+      unsigned long baud = 115200;
+      char *at = strrchr(path, '@');
+      if (at) {
+        *at = 0;
+        baud = strtoul(at + 1, NULL, 10);
+      }
+      return new GwLineSource(path, baud, edges, stop);
+    }
+    unsigned int clk, data;
+    if (!strncmp(spec, "gpio:", 5)) {
+      snprintf(path, sizeof(path), "%s", spec + 5);
+      char *c = strchr(path, ':');
+      if (c && sscanf(c, ":%u:%u", &clk, &data) == 2) {
+        *c = 0;
+        return new GwGpioSource(path, clk, data, edges, stop);
+      }
+    }
+    return NULL;
+  }
+
+int GwSource::push(const gwEdge_t &e, bool wait)
+  {
+    gwEdge_t *slot;
+    while (!(slot = queue.reserve())) {
+      if (!wait || stop) {
+        overruns++;
+        return 0;                             // return failure, dropped
+      }
+      usleep(100);
+    }
+    *slot = e;
+    queue.push();
+    if (!e.end) edges++;
+    return 1;
+  }
+
+void GwSource::end()
+  {
+    // Never dropped: the decode thread drains the queue until it gets this
+    gwEdge_t *slot;
+    while (!(slot = queue.reserve())) usleep(100);
+    slot->end = 1;
+    queue.push();
+  }
+
+// ------------------------------------------------------------------
+// ------------------ Capture files, serial ports -------------------
+// ------------------------------------------------------------------
+
+GwLineSource::GwLineSource(const char *path, unsigned long baud, gwEdgeQueue &edges, std::atomic<bool> &stop)
+  : GwSource(edges, stop), baud(baud), fd(-1), now(1000000), clk(true)
+  {
+    snprintf(this->path, sizeof(this->path), "%s", path);
+  }
+
+GwLineSource::~GwLineSource()
+  {
+    if (fd >= 0) close(fd);
+  }
+
+static speed_t baudConstant(unsigned long baud)
+  {
+    switch (baud) {
+      case 9600: return B9600;
+      case 19200: return B19200;
+      case 38400: return B38400;
+      case 57600: return B57600;
+      case 230400: return B230400;
+      case 460800: return B460800;
+      case 921600: return B921600;
+      default: return B115200;
+    }
+  }
+
+int GwLineSource::open()
+  {
+    fd = ::open(path, baud ? O_RDONLY | O_NOCTTY : O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "dscgw: cannot open %s: %s\n", path, strerror(errno));
+      return 0;                               // return failure
+    }
+    if (baud) {
+      // Raw 8N1, lines are split here rather than by the tty
+      struct termios tio;
+      if (tcgetattr(fd, &tio)) {
+        fprintf(stderr, "dscgw: %s is not a serial port\n", path);
+        return 0;                             // return failure
+      }
+      cfmakeraw(&tio);
+      cfsetispeed(&tio, baudConstant(baud));
+      cfsetospeed(&tio, baudConstant(baud));
+      tio.c_cflag |= CLOCAL | CREAD;
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+    return 1;
+  }
+
+void GwLineSource::edge(unsigned long us, bool clk, bool data)
+  {
+    gwEdge_t e = {us, clk, data, 0};
+    push(e, true);                            // Waits for the decode thread, nothing is lost
+    now = us;
+    this->clk = clk;
+  }
+
+void GwLineSource::line(char *s)
+  {
+    while (*s == ' ' || *s == '\t') s++;
+    if (!*s || *s == '#' || *s == '\r') return;
+
+    if (s[0] == 'F' && s[1] == ' ') {
+      // A word after a new word gap: falling edge (keypad bit), rising edge (panel bit)
+      char *panel = s + 2;
+      while (*panel == ' ') panel++;
+      char *keypad = panel + strspn(panel, "01");
+      size_t pBits = keypad - panel;
+      while (*keypad == ' ') keypad++;
+      size_t kBits = strspn(keypad, "01");
+      if (!pBits) {
+        badLines++;
+        return;
+      }
+      if (!clk) edge(now + GW_HALF_BIT, true, true);    // The clock idles high
+      now += GW_GAP;
+      for (size_t i=0;i<pBits;i++) {
+        edge(now + GW_HALF_BIT, false, i < kBits ? keypad[i] == '1' : true);
+        edge(now + GW_HALF_BIT, true, panel[i] == '1');
+      }
+      return;
+    }
+
+    unsigned long us;
+    unsigned int c, d;
+    if (s[0] == 'E' && sscanf(s + 1, "%lu %u %u", &us, &c, &d) == 3) {
+      edge(us, c, d);
+      return;
+    }
+    badLines++;
+  }
+
+void GwLineSource::run()
+  {
+    char buf[4096];
+    size_t len = 0;
+    while (!stop) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      if (baud && poll(&pfd, 1, 100) == 0) continue;   // Nothing yet, look at "stop" again
+      ssize_t r = read(fd, buf + len, sizeof(buf) - len);
+      if (r < 0 && errno == EINTR) continue;
+      if (r <= 0) break;                      // End of the file, or the port went away
+      len += r;
+
+      // Each complete line, the rest is kept for the next read
+      char *start = buf, *nl;
+      while ((nl = (char *)memchr(start, '\n', buf + len - start))) {
+        *nl = 0;
+        line(start);
+        start = nl + 1;
+      }
+      len = buf + len - start;
+      memmove(buf, start, len);
+      if (len == sizeof(buf)) len = 0;        // A line longer than the buffer, dropped
+    }
+    if (len && !stop) {
+      buf[len] = 0;                           // A last line without a newline
+      line(buf);
+    }
+
+    // A gap and the falling edge after it close a last word of unknown length
+    if (clk) edge(now + GW_GAP, false, true);
+    end();
+  }
+
+// ------------------------------------------------------------------
+// --------------------- GPIO character device ----------------------
+// ------------------------------------------------------------------
+
+GwGpioSource::GwGpioSource(const char *chip, unsigned int clkLine, unsigned int dataLine, gwEdgeQueue &edges, std::atomic<bool> &stop)
+  : GwSource(edges, stop), clkLine(clkLine), dataLine(dataLine), fd(-1)
+  {
+    snprintf(this->chip, sizeof(this->chip), "%s", chip);
+  }
+
+GwGpioSource::~GwGpioSource()
+  {
+    if (fd >= 0) close(fd);
+  }
+
+int GwGpioSource::open()
+  {
+    int chipFd = ::open(chip, O_RDONLY);
+    if (chipFd < 0) {
+      fprintf(stderr, "dscgw: cannot open %s: %s\n", chip, strerror(errno));
+      return 0;                               // return failure
+    }
+
+    // Both lines as inputs, with edge events on the clock line (offset 0) only
+    struct gpio_v2_line_request req;
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = clkLine;
+    req.offsets[1] = dataLine;
+    req.num_lines = 2;
+    snprintf(req.consumer, sizeof(req.consumer), "dscgw");
+    req.event_buffer_size = 256;
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT;
+    req.config.num_attrs = 1;
+    req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+    req.config.attrs[0].attr.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    req.config.attrs[0].mask = 1;
+    int r = ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(chipFd);
+    if (r < 0) {
+      fprintf(stderr, "dscgw: cannot request lines %u,%u of %s: %s\n", clkLine, dataLine, chip, strerror(errno));
+      return 0;                               // return failure
+    }
+    fd = req.fd;
+    return 1;
+  }
+
+void GwGpioSource::run()
+  {
+    // The data line is read as each event is picked up, so it is only the level
+    // at the edge while this thread keeps within a few hundred us of the bus;
+    // the kernel's timestamps keep the word gaps exact even when it does not
+    struct gpio_v2_line_event events[16];
+    while (!stop) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      if (poll(&pfd, 1, 100) <= 0) continue;
+      ssize_t r = read(fd, events, sizeof(events));
+      if (r < 0 && errno == EINTR) continue;
+      if (r <= 0) break;
+      for (size_t i=0;i<r / sizeof(events[0]);i++) {
+        struct gpio_v2_line_values v = {0, 1 << 1};
+        ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &v);
+        gwEdge_t e = {(unsigned long)(events[i].timestamp_ns / 1000),
+                      events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE,
+                      (uint8_t)((v.bits >> 1) & 1), 0};
+        push(e, false);                       // A live bus does not wait
+      }
+    }
+    end();
+  }
@@ -0,0 +1,115 @@
+/*
+  GwSource.h - Keybus sources of dscgw: each reads the clock edges of one
+  bus (from a capture file, a serial port or a GPIO character device) on a
+  thread of its own, and passes them to the bus's decode thread through a
+  single producer/single consumer queue (DSC_Queue.h)
+
+  Capture files and serial ports carry text lines:
+
+    F <panel bits> [<keypad bits>]   a whole word, sent after a new word gap
+                                     with the keybus timing (500 us per edge)
+    E <micros> <clock> <data>        one clock edge: time, clock level after
+                                     it and the data line level read for it
+    # ...                            a comment
+
+  e.g. "F 00100111000000000..." for a 0x27 word, the keypad holding the
+  data line high. A GPIO character device gives the edges themselves.
+
+  Released into the public domain.
+
+*/
+
+#ifndef GwSource_h
+#define GwSource_h
+
+#include <DSC.h>
+#include <atomic>
+
+// One clock edge, as the decode thread replays it on the bus's pins
+typedef struct
+{
+  unsigned long us;                   // micros() of the edge
+  uint8_t clk;                        // Clock level after the edge
+  uint8_t data;                       // Data line level read for it
+  uint8_t end;                        // Last item: the source ended or was stopped
+}
+gwEdge_t;
+
+#define GW_EDGES 255                  // Edge queue slots per bus (a quarter of a word)
+typedef DSCQueue<gwEdge_t, GW_EDGES> gwEdgeQueue;
+
+class GwSource
+{
+  public:
+
+    // In general, functions will return the following:
+    //    If failure, return int 0
+    //    If success, return int 1
+
+    // Returns the source described by "spec" (file:PATH, serial:PATH[@BAUD] or
+    // gpio:CHIP:CLK:DATA), or NULL if it is not one. "stop" ends run()
+    static GwSource *make(const char *spec, gwEdgeQueue &edges, std::atomic<bool> &stop);
+
+    virtual ~GwSource() {}
+
+    // Opens the file or device, prints why it failed on stderr
+    virtual int open() = 0;
+
+    // Body of the reader thread: pushes edges until the source ends or "stop"
+    // is set, then pushes an item with "end" set
+    virtual void run() = 0;
+
+    unsigned long edges;              // Edges passed to the decode thread
+    unsigned long overruns;           // Edges dropped, the decode thread was behind
+    unsigned long badLines;           // Lines that are not F/E/# lines
+
+  protected:
+    GwSource(gwEdgeQueue &edges, std::atomic<bool> &stop);
+
+    // Queues "e". A capture waits for room ("wait"), a live bus drops the edge
+    int push(const gwEdge_t &e, bool wait);
+    void end();
+
+    gwEdgeQueue &queue;
+    std::atomic<bool> &stop;
+};
+
+// Text lines from a capture file or a serial port (see above)
+class GwLineSource : public GwSource
+{
+  public:
+    GwLineSource(const char *path, unsigned long baud, gwEdgeQueue &edges, std::atomic<bool> &stop);
+    ~GwLineSource();
+
+    virtual int open();
+    virtual void run();
+
+  private:
+    void line(char *s);
+    void edge(unsigned long us, bool clk, bool data);
+
+    char path[128];
+    unsigned long baud;               // 0 for a plain file
+    int fd;
+    unsigned long now;                // Time of the last edge, us
+    bool clk;                         // Clock level after it
+};
+
+// Edges of a GPIO character device (Linux GPIO uAPI v2): the clock line with
+// edge events, stamped by the kernel, and the data line read for each one
+class GwGpioSource : public GwSource
+{
+  public:
+    GwGpioSource(const char *chip, unsigned int clkLine, unsigned int dataLine, gwEdgeQueue &edges, std::atomic<bool> &stop);
+    ~GwGpioSource();
+
+    virtual int open();
+    virtual void run();
+
+  private:
+    char chip[128];
+    unsigned int clkLine, dataLine;
+    int fd;                           // Line request of both lines
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "MqttClient.h"
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+// ----- Packet types (MQTT 3.1.1, section 2.2.1) -----
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_PINGREQ 0xc0
+#define MQTT_DISCONNECT 0xe0
+
+static unsigned long seconds()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+  }
+
+// Appends a length-prefixed string (MQTT 3.1.1, section 1.5.3) at "p"
+static uint8_t *putString(uint8_t *p, const char *s, size_t len)
+  {
+    *p++ = len >> 8;
+    *p++ = len & 0xff;
+    memcpy(p, s, len);
+    return p + len;
+  }
+
+MqttClient::MqttClient()
+  : publishes(0), connects(0), fd(-1), keepAlive(30), lastSend(0)
+  {
+  }
+
+MqttClient::~MqttClient()
+  {
+    close();
+  }
+
+void MqttClient::close()
+  {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+  }
+
+int MqttClient::send(uint8_t type, const uint8_t *body, size_t len)
+  {
+    if (fd < 0) return 0;
+    uint8_t head[5];
+    size_t n = 0;
+    head[n++] = type;
+    size_t left = len;
+    do {                                      // Remaining length, 7 bits per byte
+      uint8_t b = left & 0x7f;
+      left >>= 7;
+      head[n++] = left ? b | 0x80 : b;
+    } while (left && n < sizeof(head));
+
+    struct iovec parts[2] = {{head, n}, {(void *)body, len}};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = parts;
+    msg.msg_iovlen = len ? 2 : 1;
+    while (msg.msg_iovlen) {
+      ssize_t w = sendmsg(fd, &msg, MSG_NOSIGNAL);
+      if (w < 0 && errno == EINTR) continue;
+      if (w <= 0) {
+        close();
+        return 0;                             // return failure, the connection is gone
+      }
+      while (msg.msg_iovlen && (size_t)w >= msg.msg_iov->iov_len) {   // Skip what was sent
+        w -= msg.msg_iov->iov_len;
+        msg.msg_iov++;
+        msg.msg_iovlen--;
+      }
+      if (msg.msg_iovlen) {
+        msg.msg_iov->iov_base = (uint8_t *)msg.msg_iov->iov_base + w;
+        msg.msg_iov->iov_len -= w;
+      }
+    }
+    lastSend = seconds();
+    return 1;
+  }
+
+int MqttClient::connect(const char *host, uint16_t port, const char *clientId, uint16_t keepAlive)
+  {
+    close();
+    this->keepAlive = keepAlive;
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &res)) return 0;
+    for (struct addrinfo *a=res;a && fd<0;a=a->ai_next) {
+      fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+      if (fd < 0) continue;
+      if (::connect(fd, a->ai_addr, a->ai_addrlen)) close();
+    }
+    freeaddrinfo(res);
+    if (fd < 0) return 0;                     // return failure
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // Protocol name and level, clean session, keep-alive, then the client id
+    size_t idLen = strlen(clientId);
+    uint8_t body[10 + 2 + 64], *p = body;
+    if (idLen > 64) idLen = 64;
+    p = putString(p, "MQTT", 4);
+    *p++ = 4;                                 // Protocol level 4, MQTT 3.1.1
+    *p++ = 0x02;                              // Clean session
+    *p++ = keepAlive >> 8;
+    *p++ = keepAlive & 0xff;
+    p = putString(p, clientId, idLen);
+    if (!send(MQTT_CONNECT, body, p - body)) return 0;
+
+    // The CONNACK is 4 bytes, return code 0 is accepted
+    uint8_t ack[4];
+    size_t got = 0;
+    while (got < sizeof(ack)) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      if (poll(&pfd, 1, 5000) <= 0) break;
+      ssize_t r = recv(fd, ack + got, sizeof(ack) - got, 0);
+      if (r <= 0) break;
+      got += r;
+    }
+    if (got < sizeof(ack) || ack[0] != MQTT_CONNACK || ack[3] != 0) {
+      close();
+      return 0;                               // return failure, refused or no answer
+    }
+    connects++;
+    return 1;
+  }
+
+int MqttClient::publish(const char *topic, const char *payload, bool retain)
+  {
+    if (fd < 0) return 0;
+    size_t topicLen = strlen(topic), len = strlen(payload);
+    uint8_t body[2 + 256 + 1024];
+    if (topicLen > 256 || len > 1024) return 0;   // return failure, too long for this client
+    uint8_t *p = putString(body, topic, topicLen);
+    memcpy(p, payload, len);
+    if (!send(MQTT_PUBLISH | (retain ? 1 : 0), body, p - body + len)) return 0;
+    publishes++;
+    return 1;
+  }
+
+int MqttClient::loop()
+  {
+    if (fd < 0) return 0;
+
+    // Whatever the broker sent (PINGRESP), or the end of the connection
+    uint8_t buf[64];
+    for (;;) {
+      ssize_t r = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+      if (r > 0) continue;
+      if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        close();
+        return 0;                             // return failure, the broker closed it
+      }
+      break;
+    }
+    if (keepAlive && seconds() - lastSend >= keepAlive / 2u) return send(MQTT_PINGREQ, NULL, 0);
+    return 1;
+  }
+
+void MqttClient::disconnect()
+  {
+    send(MQTT_DISCONNECT, NULL, 0);
+    close();
+  }
@@ -0,0 +1,56 @@
+/*
+  MqttClient.h - Minimal MQTT 3.1.1 client for dscgw: a blocking TCP
+  connection to one broker, QoS 0 publishes and keep-alive pings
+
+  One MqttClient belongs to one thread (a publisher of the gateway's pool);
+  nothing in it is shared.
+
+  Released into the public domain.
+
+*/
+
+#ifndef MqttClient_h
+#define MqttClient_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+class MqttClient
+{
+  public:
+
+    // In general, functions will return the following:
+    //    If failure, return int 0
+    //    If success, return int 1
+
+    MqttClient();
+    ~MqttClient();
+
+    // Connects to "host":"port" with a clean session, waits for the CONNACK
+    int connect(const char *host, uint16_t port, const char *clientId, uint16_t keepAlive = 30);
+
+    // Publishes "payload" to "topic" at QoS 0. A failed send closes the connection
+    int publish(const char *topic, const char *payload, bool retain = false);
+
+    // Sends a ping once half the keep-alive has passed without a packet, and
+    // drops what the broker sent (PINGRESP). Call it regularly
+    int loop();
+
+    // Sends DISCONNECT and closes the connection
+    void disconnect();
+
+    bool connected() { return fd >= 0; }
+
+    unsigned long publishes;          // Messages sent since the client was made
+    unsigned long connects;           // Connections made, reconnects included
+
+  private:
+    int send(uint8_t type, const uint8_t *body, size_t len);
+    void close();
+
+    int fd;
+    uint16_t keepAlive;
+    unsigned long lastSend;           // Seconds (CLOCK_MONOTONIC) of the last packet sent
+};
+
+#endif
@@ -0,0 +1,273 @@
+/*
+  dscgw.cpp - Linux keybus to MQTT gateway, built on lib/DSCPanel as is
+
+    dscgw [-h host] [-p port] [-t prefix] [-i id] [-P publishers] source ...
+
+  Each source is one keybus (up to MAX_BUSES), see GwSource.h:
+
+    file:PATH                   a capture file, ends the bus at its end
+    serial:PATH[@BAUD]          a serial port carrying the same lines
+    gpio:CHIP:CLK:DATA          clock and data lines of a GPIO character
+                                device, e.g. gpio:/dev/gpiochip0:17:27
+
+  Every bus has three stages, each on a thread of its own, passing items on
+  through lock-free single producer/single consumer queues (DSC_Queue.h):
+
+    reader    reads the source and queues its clock edges
+    decoder   replays the edges on the bus's pins of the host Arduino core
+              (host/Arduino.h), so the DSC instance's clock ISR frames the
+              words exactly as on the ESP8266, then runs process() and
+              queues a message per decoded panel and keypad word. The
+              decoders are pinned to cores, bus n to core n
+    publisher one of a pool of -P threads, each with its own connection to
+              the broker, publishing the messages of the buses n where
+              n % publishers is its number
+
+  So a slow broker only fills the message queues (dropping what does not
+  fit, counted), never holding up the framing, and a capture is decoded as
+  fast as the cores allow. Messages go to <prefix>/<bus>/panel and
+  <prefix>/<bus>/keypad, with the body of the sketch's verbose messages.
+
+  dscgw ends once every source has ended (captures) or on SIGINT/SIGTERM,
+  after publishing what was decoded, and prints a line per bus.
+
+  Released into the public domain.
+
+*/
+
+#include <DSC.h>
+#include <pthread.h>
+#include <signal.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "GwSource.h"
+#include "MqttClient.h"
+
+#define GW_MSGS 128                   // Message queue slots per bus
+#define GW_PAYLOAD 512
+
+// A message as queued by a decoder for its publisher
+typedef struct
+{
+  char topic[64];
+  char payload[GW_PAYLOAD];
+}
+gwMsg_t;
+
+typedef struct
+{
+  const char *spec;
+  GwSource *source;
+  gwEdgeQueue edges;                  // reader -> decoder
+  DSC dsc;
+  DSCQueue<gwMsg_t, GW_MSGS> msgs;    // decoder -> publisher
+  std::atomic<bool> done;             // The decoder has queued its last message
+  unsigned long dropped;              // Messages dropped, the queue was full
+  std::atomic<unsigned long> published;
+}
+gwBus_t;
+
+static gwBus_t buses[MAX_BUSES];
+static int busCount = 0;
+static int publishers = 1;
+static const char *host = "localhost";
+static unsigned int port = 1883;
+static const char *prefix = "dscgw";
+static const char *clientId = "dscgw";
+static std::atomic<bool> stopping(false);
+
+// Pins of bus "n" on the host core, apart from every other bus's
+static byte clkPin(int n) { return 4 + n * 2; }
+static byte dataPin(int n) { return 5 + n * 2; }
+
+static void onSignal(int sig)
+  {
+    (void)sig;
+    stopping = true;
+  }
+
+// Appends "s" to "out" as the inside of a JSON string
+static void jsonString(String &out, const char *s)
+  {
+    for (;*s;s++) {
+      if (*s == '"' || *s == '\\') out += '\\';
+      if ((unsigned char)*s >= ' ') out += *s;
+    }
+  }
+
+static void queueMsg(gwBus_t &b, int n, const char *kind, const String &payload)
+  {
+    gwMsg_t *m = b.msgs.reserve();
+    if (!m) {
+      b.dropped++;                            // The publisher is behind
+      return;
+    }
+    snprintf(m->topic, sizeof(m->topic), "%s/%d/%s", prefix, n, kind);
+    snprintf(m->payload, sizeof(m->payload), "%s", payload.c_str());
+    b.msgs.push();
+  }
+
+// Queues the words process() just decoded
+static void queueWords(gwBus_t &b, int n)
+  {
+    DSC &dsc = b.dsc;
+    if (dsc.state.pCmd) {
+      String body = "{\"PanelRaw\":\"";
+      body += dsc.pnlRaw();
+      body += "\",\"PanelCommandHex\":\"";
+      body += String(dsc.state.pCmd, HEX);
+      body += "\",\"PanelMessage\":";
+      body += dsc.state.pMsg;
+      body += "}";
+      queueMsg(b, n, "panel", body);
+    }
+    if (dsc.state.kCmd) {
+      String body = "{\"KeypadRaw\":\"";
+      body += dsc.kpdRaw();
+      body += "\",\"KeypadCommandHex\":\"";
+      body += String(dsc.state.kCmd, HEX);
+      body += "\",\"KeypadMessage\":\"";
+      jsonString(body, dsc.state.kMsg.c_str());
+      body += "\"}";
+      queueMsg(b, n, "keypad", body);
+    }
+  }
+
+static void decodeBus(int n)
+  {
+    gwBus_t &b = buses[n];
+    int cores = std::thread::hardware_concurrency();
+    if (cores > 1) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(n % cores, &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    // micros() belongs to this thread (host/Arduino.h): it is the time of the
+    // edge being replayed, so the ISR sees the bus's own timing
+    for (;;) {
+      gwEdge_t *e = b.edges.front();
+      if (!e) {
+        usleep(200);
+        continue;
+      }
+      if (e->end) {
+        b.edges.pop();
+        break;
+      }
+      hostSetMicros(e->us);
+      hostSetPin(dataPin(n), e->data);
+      hostSetPin(clkPin(n), e->clk);          // Calls the DSC instance's clock ISR
+      b.edges.pop();
+      while (b.dsc.state.frames.front()) {
+        b.dsc.process();
+        queueWords(b, n);
+      }
+    }
+    b.done = true;
+  }
+
+static void publishBuses(int p)
+  {
+    MqttClient mqtt;
+    char id[64];
+    snprintf(id, sizeof(id), "%s-%d", clientId, p);
+    for (;;) {
+      // Finished once each of its buses is done and has nothing left queued
+      bool finished = true;
+      for (int n=p;n<busCount;n+=publishers) {
+        gwBus_t &b = buses[n];
+        bool done = b.done;                   // Before draining, so no message is missed
+        gwMsg_t *m;
+        while (mqtt.connected() && (m = b.msgs.front())) {
+          if (!mqtt.publish(m->topic, m->payload)) break;
+          b.msgs.pop();
+          b.published++;
+        }
+        if (!done || b.msgs.front()) finished = false;
+      }
+      if (finished) break;
+
+      if (!mqtt.connected()) {
+        if (stopping) break;                  // No broker to publish the rest to
+        if (!mqtt.connect(host, port, id)) {
+          if (mqtt.connects == 0) fprintf(stderr, "dscgw: cannot connect to %s:%u, retrying\n", host, port);
+          for (int i=0;i<10 && !stopping;i++) usleep(100000);
+        }
+        continue;
+      }
+      mqtt.loop();
+      usleep(500);
+    }
+    mqtt.disconnect();
+  }
+
+static int usage()
+  {
+    fprintf(stderr, "usage: dscgw [-h host] [-p port] [-t prefix] [-i id] [-P publishers] source ...\n"
+                    "  source: file:PATH, serial:PATH[@BAUD] or gpio:CHIP:CLK:DATA, up to %d\n", MAX_BUSES);
+    return 2;
+  }
+
+int main(int argc, char **argv)
+  {
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:t:i:P:")) != -1) {
+      switch (opt) {
+        case 'h': host = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 't': prefix = optarg; break;
+        case 'i': clientId = optarg; break;
+        case 'P': publishers = atoi(optarg); break;
+        default: return usage();
+      }
+    }
+    if (optind == argc || argc - optind > MAX_BUSES || publishers < 1) return usage();
+
+    for (int i=optind;i<argc;i++) {
+      int n = busCount++;
+      gwBus_t &b = buses[n];
+      b.spec = argv[i];
+      b.source = GwSource::make(argv[i], b.edges, stopping);
+      if (!b.source) {
+        fprintf(stderr, "dscgw: not a source: %s\n", argv[i]);
+        return usage();
+      }
+      if (!b.source->open()) return 1;
+      b.dsc.setCLK(clkPin(n));
+      b.dsc.setDTA_IN(dataPin(n));
+      hostSetPin(clkPin(n), HIGH);            // The clock idles high
+      if (!b.dsc.begin()) {
+        fprintf(stderr, "dscgw: cannot start bus %d\n", n);
+        return 1;
+      }
+    }
+    if (publishers > busCount) publishers = busCount;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    std::vector<std::thread> threads;
+    for (int n=0;n<busCount;n++) {
+      threads.push_back(std::thread(&GwSource::run, buses[n].source));
+      threads.push_back(std::thread(decodeBus, n));
+    }
+    for (int p=0;p<publishers;p++) threads.push_back(std::thread(publishBuses, p));
+    for (std::thread &t : threads) t.join();
+
+    for (int n=0;n<busCount;n++) {
+      gwBus_t &b = buses[n];
+      fprintf(stderr, "dscgw: bus %d (%s): %lu edges, %lu frames, %lu overruns, %lu framing errors, "
+                      "%lu published, %lu dropped, %lu edges lost, %lu bad lines\n",
+              n, b.spec, b.source->edges, b.dsc.state.frameCount, b.dsc.state.overruns,
+              b.dsc.state.framingErrors, b.published.load(), b.dropped, b.source->overruns, b.source->badLines);
+      b.dsc.end();
+      delete b.source;
+    }
+    return 0;
+  }
@@ -0,0 +1,214 @@
+/*
+  test_dscgw.cpp - dscgw end to end, against a fake MQTT broker in this
+  process: bus 0 replays a capture file, bus 1 reads a serial port (a
+  pseudo terminal written by this test), with two publishers. Every
+  decoded word must reach the broker on its bus's topic, in order, and
+  dscgw must exit cleanly on SIGTERM once the serial bus is idle
+
+    test_dscgw path/to/dscgw
+
+  Released into the public domain.
+
+*/
+
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <string>
+#include "test.h"
+#include "keybus.h"
+
+// ----- Fake broker: CONNECT, PUBLISH (QoS 0), PINGREQ, DISCONNECT -----
+struct published_t
+{
+  std::string topic, payload;
+};
+
+static std::mutex brokerLock;
+static std::vector<published_t> received;
+static int connects = 0, disconnects = 0;
+
+static bool readAll(int fd, uint8_t *p, size_t len)
+  {
+    while (len) {
+      ssize_t r = recv(fd, p, len, 0);
+      if (r <= 0) return false;
+      p += r;
+      len -= r;
+    }
+    return true;
+  }
+
+static void brokerClient(int fd)
+  {
+    for (;;) {
+      uint8_t type;
+      if (!readAll(fd, &type, 1)) break;
+      size_t len = 0;
+      for (int shift=0;;shift+=7) {           // Remaining length
+        uint8_t b;
+        if (!readAll(fd, &b, 1)) goto done;
+        len |= (size_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) break;
+      }
+      std::vector<uint8_t> body(len);
+      if (len && !readAll(fd, body.data(), len)) break;
+
+      std::lock_guard<std::mutex> lock(brokerLock);
+      switch (type & 0xf0) {
+        case 0x10: {                          // CONNECT
+          uint8_t ack[4] = {0x20, 0x02, 0x00, 0x00};
+          send(fd, ack, sizeof(ack), MSG_NOSIGNAL);
+          connects++;
+          break;
+        }
+        case 0x30: {                          // PUBLISH, QoS 0
+          size_t tl = (body[0] << 8) | body[1];
+          received.push_back({std::string((char *)&body[2], tl),
+                              std::string((char *)&body[2 + tl], len - 2 - tl)});
+          break;
+        }
+        case 0xc0: {                          // PINGREQ
+          uint8_t resp[2] = {0xd0, 0x00};
+          send(fd, resp, sizeof(resp), MSG_NOSIGNAL);
+          break;
+        }
+        case 0xe0:                            // DISCONNECT
+          disconnects++;
+          goto done;
+      }
+    }
+  done:
+    close(fd);
+  }
+
+static void broker(int listener)
+  {
+    for (;;) {
+      int fd = accept(listener, NULL, NULL);
+      if (fd < 0) break;
+      std::thread(brokerClient, fd).detach();
+    }
+  }
+
+static size_t count(const char *topic)
+  {
+    std::lock_guard<std::mutex> lock(brokerLock);
+    size_t n = 0;
+    for (const published_t &p : received) n += p.topic == topic;
+    return n;
+  }
+
+int main(int argc, char **argv)
+  {
+    if (argc < 2) {
+      fprintf(stderr, "usage: test_dscgw path/to/dscgw\n");
+      return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(bind(listener, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    socklen_t alen = sizeof(addr);
+    getsockname(listener, (struct sockaddr *)&addr, &alen);
+    listen(listener, 8);
+    std::thread(broker, listener).detach();
+    char port[8];
+    snprintf(port, sizeof(port), "%u", ntohs(addr.sin_port));
+
+    // Bus 0: a capture of zone words, each differing from the one before, and
+    // a last 0x0a word of unknown length that only the end of the file closes
+    const int ZONE_WORDS = 300;
+    char capture[] = "/tmp/test_dscgw_XXXXXX";
+    int cfd = mkstemp(capture);
+    FILE *f = fdopen(cfd, "w");
+    fprintf(f, "# test capture\n");
+    for (int i=0;i<ZONE_WORDS;i++) {
+      byte zones[5] = {0, 0, 0, 0, (byte)(i & 1 ? 0x01 : 0x80)};
+      fprintf(f, "F %s\n", panelWord(0x27, zones, 5).c_str());
+    }
+    byte lcd[4] = {0x01, 0x02, 0x03, 0x04};
+    fprintf(f, "F %s\n", panelWord(0x0a, lcd, 4).c_str());
+    fclose(f);
+
+    // Bus 1: status words over a serial port, one of them with a key press
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    CHECK(master >= 0);
+    grantpt(master);
+    unlockpt(master);
+    char serial[160];
+    snprintf(serial, sizeof(serial), "serial:%s@115200", ptsname(master));
+
+    char source0[160];
+    snprintf(source0, sizeof(source0), "file:%s", capture);
+    pid_t pid = fork();
+    if (pid == 0) {
+      execl(argv[1], argv[1], "-h", "127.0.0.1", "-p", port, "-P", "2", "-t", "test", source0, serial, (char *)NULL);
+      _exit(127);
+    }
+
+    const int STATUS_WORDS = 50;
+    usleep(200000);                           // dscgw has the port open and set raw
+    for (int i=0;i<STATUS_WORDS;i++) {
+      byte status[4] = {0x81, 0x01, 0x10, (byte)i};
+      std::string p = panelWord(0x05, status, 4, false);
+      std::string k = i == 10 ? keypadWord(0xff, 0x82, p.size()) : "";   // [Button] 1
+      std::string line = "F " + p + " " + k + "\n";
+      CHECK_EQ(write(master, line.data(), line.size()), (ssize_t)line.size());
+    }
+
+    // Every word through to the broker, then SIGTERM ends the serial bus
+    for (int i=0;i<100 && (count("test/0/panel") < ZONE_WORDS + 1 || count("test/1/panel") < STATUS_WORDS ||
+                           count("test/1/keypad") < 1);i++) usleep(100000);
+    kill(pid, SIGTERM);
+    int status = -1;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    close(master);
+    unlink(capture);
+    usleep(100000);                           // The broker threads see the DISCONNECTs
+
+    CHECK_EQ(count("test/0/panel"), ZONE_WORDS + 1);
+    CHECK_EQ(count("test/1/panel"), STATUS_WORDS);
+    CHECK_EQ(count("test/1/keypad"), 1);
+    std::lock_guard<std::mutex> lock(brokerLock);
+    CHECK_EQ(connects, 2);                    // One connection per publisher
+    CHECK_EQ(disconnects, 2);
+
+    // In order on each bus, with the decoded message in the body
+    int zone = 0, seq = 0;
+    for (const published_t &p : received) {
+      if (p.topic == "test/0/panel" && zone < ZONE_WORDS) {
+        const char *open = zone & 1 ? "\"PanelMessage\":{\"ZonesA\":[1,0,0,0,0,0,0,0]}"
+                                    : "\"PanelMessage\":{\"ZonesA\":[0,0,0,0,0,0,0,1]}";
+        if (p.payload.find(open) == std::string::npos) {
+          CHECK_STR(p.payload.c_str(), open);
+          break;
+        }
+        zone++;
+      }
+      else if (p.topic == "test/0/panel") CHECK(p.payload.find("\"PanelCommandHex\":\"a\"") != std::string::npos);
+      else if (p.topic == "test/1/panel") {
+        CHECK(p.payload.find("\"PanelCommandHex\":\"5\"") != std::string::npos);
+        seq++;
+      }
+      else if (p.topic == "test/1/keypad") {
+        CHECK(p.payload.find("\"KeypadMessage\":\"[Button] 1\"") != std::string::npos);
+        CHECK_EQ(seq, 11);                    // Right after the word it came with
+      }
+    }
+    CHECK_EQ(zone, ZONE_WORDS);
+    return testResult("test_dscgw");
+  }
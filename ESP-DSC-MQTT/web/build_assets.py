@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+"""Compresses the web UI into src/WebAssets.h as gzip PROGMEM arrays.
+
+Run after editing anything in web/, and commit the regenerated header:
+    python3 web/build_assets.py
+"""
+import gzip
+import hashlib
+import os
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+OUT = os.path.join(HERE, '..', 'src', 'WebAssets.h')
+
+# file in web/ -> C identifier prefix
+ASSETS = [
+    ('index.html', 'INDEX_HTML'),
+]
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('  ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def main():
+    out = [
+        '// Generated by web/build_assets.py from web/, do not edit',
+        '#ifndef WebAssets_h',
+        '#define WebAssets_h',
+        '',
+        '#include <Arduino.h>',
+        '',
+    ]
+    for name, ident in ASSETS:
+        with open(os.path.join(HERE, name), 'rb') as f:
+            raw = f.read()
+        # mtime=0 keeps the output (and the ETag) stable between runs
+        gz = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = hashlib.sha1(raw).hexdigest()[:16]
+        out += [
+            '// %s: %d bytes, %d gzipped' % (name, len(raw), len(gz)),
+            '#define %s_ETAG "\\"%s\\""' % (ident, etag),
+            '#define %s_GZ_LEN %d' % (ident, len(gz)),
+            'const uint8_t %s_GZ[] PROGMEM = {' % ident,
+            c_array(gz),
+            '};',
+            '',
+        ]
+    out.append('#endif')
+    with open(OUT, 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main()